@@ -0,0 +1,216 @@
+/*
+  Sixfab_Actuator.cpp
+  -
+  Non-blocking relay and LED driver for Sixfab Arduino NBIoT Shield.
+*/
+
+#include "Sixfab_Actuator.h"
+
+#if defined(__AVR__)
+  #include <avr/interrupt.h>
+  // channels are shared with tick interrupt
+  #define ACTUATOR_LOCK() uint8_t sreg = SREG; cli()
+  #define ACTUATOR_UNLOCK() SREG = sreg
+#else
+  #define ACTUATOR_LOCK() noInterrupts()
+  #define ACTUATOR_UNLOCK() interrupts()
+#endif
+
+static uint32_t read_u32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+SixfabActuator::SixfabActuator(const NBIoT_Pins &pins)
+{
+  memset(channels, 0, sizeof(channels));
+  channels[ACTUATOR_RELAY].pin = pins.relay;
+  channels[ACTUATOR_LED].pin = pins.user_led;
+
+#if defined(__AVR__)
+  for(uint8_t i = 0; i < ACTUATOR_COUNT; i++){
+    channels[i].out = portOutputRegister(digitalPinToPort(channels[i].pin));
+    channels[i].mask = digitalPinToBitMask(channels[i].pin);
+  }
+#endif
+}
+
+// set pin directions and attach to tick
+bool SixfabActuator::begin()
+{
+  for(uint8_t i = 0; i < ACTUATOR_COUNT; i++){
+    pinMode(channels[i].pin, OUTPUT);
+    digitalWrite(channels[i].pin, LOW); // also stops PWM of pin, port writes don't
+    channels[i].on = false;
+  }
+  return tickAttach(on_tick, this);
+}
+
+// turn output on or off, cancel schedule
+void SixfabActuator::set(NBIoT_Actuator id, bool on)
+{
+  start(id, MODE_IDLE, on, 0);
+}
+
+// turn output on for on_ms
+void SixfabActuator::pulse(NBIoT_Actuator id, uint32_t on_ms)
+{
+  start(id, MODE_PULSE, true, on_ms);
+}
+
+// turn output on for on_ms after wait ms
+void SixfabActuator::schedule(NBIoT_Actuator id, uint32_t wait, uint32_t on_ms)
+{
+  if(id >= ACTUATOR_COUNT)
+    return;
+
+  channels[id].on_ms = on_ms; // not used by tick until mode is set
+  start(id, MODE_DELAYED, false, wait);
+}
+
+// blink pattern
+void SixfabActuator::blink(NBIoT_Actuator id, uint16_t pattern, uint16_t step_ms, uint8_t repeats)
+{
+  if(id >= ACTUATOR_COUNT || step_ms == 0)
+    return;
+
+  ACTUATOR_LOCK();
+  Channel &ch = channels[id];
+  ch.pattern = pattern;
+  ch.step_ms = step_ms;
+  ch.step = 0;
+  ch.repeats = repeats;
+  ch.mode = MODE_BLINK;
+  ch.next = millis() + step_ms;
+  write(ch, pattern & 1);
+  ACTUATOR_UNLOCK();
+}
+
+// blink status code, "on off" pairs followed by pause
+void SixfabActuator::blinkCode(NBIoT_Actuator id, uint8_t code, uint8_t repeats)
+{
+  if(code == 0 || code > BLINK_CODE_MAX)
+    return;
+
+  blink(id, 0x5555 & ((1U << (2 * code)) - 1), BLINK_STEP, repeats);
+}
+
+// apply downlink command
+bool SixfabActuator::handleCommand(const uint8_t *command, uint16_t len)
+{
+  if(len < 2 || command[0] >= ACTUATOR_COUNT)
+    return false;
+
+  NBIoT_Actuator id = (NBIoT_Actuator)command[0];
+  const uint8_t *arg = command + 2;
+
+  switch(command[1]){
+    case ACT_OFF:
+    case ACT_ON:
+      set(id, command[1] == ACT_ON);
+      return true;
+    case ACT_PULSE:
+      if(len < 6)
+        return false;
+      pulse(id, read_u32(arg));
+      return true;
+    case ACT_BLINK:
+      if(len < 6 || arg[2] == 0)
+        return false;
+      blink(id, ((uint16_t)arg[0] << 8) | arg[1], arg[2] * 10, arg[3]);
+      return true;
+    case ACT_SCHEDULE:
+      if(len < 10)
+        return false;
+      schedule(id, read_u32(arg), read_u32(arg + 4));
+      return true;
+  }
+  return false;
+}
+
+bool SixfabActuator::isOn(NBIoT_Actuator id)
+{
+  return id < ACTUATOR_COUNT && channels[id].on;
+}
+
+bool SixfabActuator::isBusy(NBIoT_Actuator id)
+{
+  return id < ACTUATOR_COUNT && channels[id].mode != MODE_IDLE;
+}
+
+void SixfabActuator::poll()
+{
+  ACTUATOR_LOCK();
+  update();
+  ACTUATOR_UNLOCK();
+}
+
+void SixfabActuator::on_tick(void *context)
+{
+  ((SixfabActuator *)context)->update();
+}
+
+// advance pulses and blinks, called with interrupts disabled
+void SixfabActuator::update()
+{
+  uint32_t now = millis();
+
+  for(uint8_t i = 0; i < ACTUATOR_COUNT; i++){
+    Channel &ch = channels[i];
+
+    if(ch.mode == MODE_IDLE || (int32_t)(now - ch.next) < 0)
+      continue;
+
+    switch(ch.mode){
+      case MODE_DELAYED:
+        write(ch, true);
+        ch.mode = MODE_PULSE;
+        ch.next = now + ch.on_ms;
+        break;
+      case MODE_PULSE:
+        write(ch, false);
+        ch.mode = MODE_IDLE;
+        break;
+      case MODE_BLINK:
+        if(++ch.step == 16){
+          ch.step = 0;
+          if(ch.repeats && --ch.repeats == 0){
+            write(ch, false);
+            ch.mode = MODE_IDLE;
+            break;
+          }
+        }
+        write(ch, (ch.pattern >> ch.step) & 1);
+        ch.next += ch.step_ms;
+        break;
+    }
+  }
+}
+
+// write output, port register is used on AVR
+void SixfabActuator::write(Channel &ch, bool on)
+{
+#if defined(__AVR__)
+  if(on)
+    *ch.out |= ch.mask;
+  else
+    *ch.out &= ~ch.mask;
+#else
+  digitalWrite(ch.pin, on ? HIGH : LOW);
+#endif
+  ch.on = on;
+}
+
+// set mode of output, wait is ms until next change
+void SixfabActuator::start(NBIoT_Actuator id, uint8_t mode, bool on, uint32_t wait)
+{
+  if(id >= ACTUATOR_COUNT)
+    return;
+
+  ACTUATOR_LOCK();
+  Channel &ch = channels[id];
+  ch.mode = mode;
+  ch.next = millis() + wait;
+  write(ch, on);
+  ACTUATOR_UNLOCK();
+}
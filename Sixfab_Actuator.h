@@ -0,0 +1,188 @@
+/*
+  Sixfab_Actuator.h
+  -
+  Non-blocking relay and LED driver for Sixfab Arduino NBIoT Shield.
+  Pulses, delayed pulses and blink patterns are run from the shared
+  millisecond tick (see Sixfab_Tick.h), so a pulse is turned off on time
+  even while the modem command engine is blocked. Outputs are written
+  directly to port registers on AVR.
+
+  Downlink command, integers are big endian :
+    actuator(1) ACT_OFF
+    actuator(1) ACT_ON
+    actuator(1) ACT_PULSE on_ms(4)
+    actuator(1) ACT_BLINK pattern(2) step_10ms(1) repeats(1)
+    actuator(1) ACT_SCHEDULE delay_ms(4) on_ms(4)
+*/
+
+#ifndef _SIXFAB_ACTUATOR_H
+#define _SIXFAB_ACTUATOR_H
+
+#include "Sixfab_NBIoT.h"
+#include "Sixfab_Tick.h"
+
+#define BLINK_STEP 200 // ms per pattern bit of blinkCode()
+#define BLINK_CODE_MAX 7 // max blinks of a status code
+
+enum NBIoT_Actuator {
+  ACTUATOR_RELAY,
+  ACTUATOR_LED,
+  ACTUATOR_COUNT
+};
+
+// operations of downlink command
+enum NBIoT_ActuatorOp {
+  ACT_OFF,
+  ACT_ON,
+  ACT_PULSE,
+  ACT_BLINK,
+  ACT_SCHEDULE
+};
+
+class SixfabActuator
+{
+  public:
+
+    /*
+    Constructor
+
+    [no-return]
+    ---
+    [param #1] : const NBIoT_Pins& peripheral pins
+    */
+    SixfabActuator(const NBIoT_Pins & = NBIOT_DEFAULT_PINS);
+
+    /*
+    Function for setting pin directions and attaching to millisecond tick.
+
+    [return] : bool false if tick isn't available, poll() must be called from loop()
+    ---
+    [no-param]
+    */
+    bool begin();
+
+    /*
+    Function for turning output on or off. Running pulse or blink is cancelled.
+
+    [no-return]
+    ---
+    [param #1] : NBIoT_Actuator output
+    [param #2] : bool true for on
+    */
+    void set(NBIoT_Actuator, bool);
+
+    /*
+    Function for turning output on for [param #2] ms.
+
+    [no-return]
+    ---
+    [param #1] : NBIoT_Actuator output
+    [param #2] : uint32_t on time in ms
+    */
+    void pulse(NBIoT_Actuator, uint32_t);
+
+    /*
+    Function for turning output on after [param #2] ms for [param #3] ms.
+
+    [no-return]
+    ---
+    [param #1] : NBIoT_Actuator output
+    [param #2] : uint32_t delay in ms
+    [param #3] : uint32_t on time in ms
+    */
+    void schedule(NBIoT_Actuator, uint32_t, uint32_t);
+
+    /*
+    Function for blinking 16 step pattern, bit 0 is first step.
+
+    [no-return]
+    ---
+    [param #1] : NBIoT_Actuator output
+    [param #2] : uint16_t pattern, bit is 1 for on
+    [param #3] : uint16_t step length in ms
+    [param #4] : uint8_t pattern repeats, 0 for blinking until set() is called
+    */
+    void blink(NBIoT_Actuator, uint16_t, uint16_t, uint8_t = 0);
+
+    /*
+    Function for showing status code as [param #2] short blinks followed by a pause.
+
+    [no-return]
+    ---
+    [param #1] : NBIoT_Actuator output
+    [param #2] : uint8_t code, 1 to BLINK_CODE_MAX
+    [param #3] : uint8_t repeats, 0 for blinking until set() is called
+    */
+    void blinkCode(NBIoT_Actuator, uint8_t, uint8_t = 0);
+
+    /*
+    Function for applying a downlink command, see format at top of Sixfab_Actuator.h
+
+    [return] : bool false if command is malformed
+    ---
+    [param #1] : const uint8_t* command
+    [param #2] : uint16_t command length
+    */
+    bool handleCommand(const uint8_t *, uint16_t);
+
+    /*
+    Function for getting output state
+
+    [return] : bool true if output is on
+    ---
+    [param #1] : NBIoT_Actuator output
+    */
+    bool isOn(NBIoT_Actuator);
+
+    /*
+    Function for checking if a pulse or blink is running
+
+    [return] : bool true if output will change by itself
+    ---
+    [param #1] : NBIoT_Actuator output
+    */
+    bool isBusy(NBIoT_Actuator);
+
+    /*
+    Function for running pulses and blinks on boards without tick.
+    Should be called from loop() if begin() returned false.
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void poll();
+
+  private:
+    enum {
+      MODE_IDLE,
+      MODE_DELAYED, // waiting for start of pulse
+      MODE_PULSE,
+      MODE_BLINK
+    };
+
+    typedef struct {
+      uint8_t pin;
+#if defined(__AVR__)
+      volatile uint8_t *out; // output register of pin
+      uint8_t mask;
+#endif
+      uint8_t mode;
+      bool on;
+      uint8_t step;      // bit of pattern
+      uint8_t repeats;   // left, 0 for endless
+      uint16_t pattern;
+      uint16_t step_ms;
+      uint32_t on_ms;    // on time of delayed pulse
+      uint32_t next;     // millis() of next change
+    } Channel;
+
+    Channel channels[ACTUATOR_COUNT];
+
+    static void on_tick(void *context);
+    void update();
+    void write(Channel &, bool);
+    void start(NBIoT_Actuator, uint8_t mode, bool on, uint32_t wait);
+};
+
+#endif
@@ -0,0 +1,234 @@
+/*
+  Sixfab_Button.cpp
+  -
+  Interrupt driven user button driver for Sixfab Arduino NBIoT Shield.
+*/
+
+#include "Sixfab_Button.h"
+
+#if defined(__AVR__)
+  #include <avr/interrupt.h>
+  // edge queue is shared with interrupt
+  #define BUTTON_LOCK() uint8_t sreg = SREG; cli()
+  #define BUTTON_UNLOCK() SREG = sreg
+#else
+  #define BUTTON_LOCK() noInterrupts()
+  #define BUTTON_UNLOCK() interrupts()
+#endif
+
+static SixfabButton *active_button = NULL;
+
+void SixfabButton::onPinChange()
+{
+  if(active_button)
+    active_button->onEdge();
+}
+
+// overridden by SIXFAB_BUTTON_PCINT_ISR()
+__attribute__((weak)) bool SixfabButton::pinChangeLinked()
+{
+  return false;
+}
+
+SixfabButton::SixfabButton(const NBIoT_Pins &pins)
+{
+  pin = pins.user_button;
+#if defined(__AVR__)
+  in = portInputRegister(digitalPinToPort(pin));
+  mask = digitalPinToBitMask(pin);
+#endif
+  edge_head = edge_count = 0;
+  event_head = event_count = 0;
+  raw_level = !BUTTON_PRESSED_LEVEL;
+  pressed = long_sent = click_pending = false;
+  press_time = click_time = release_time = 0;
+  dropped = 0;
+}
+
+// set pin and start recording level changes
+bool SixfabButton::begin()
+{
+  pinMode(pin, INPUT);
+  raw_level = read_pin();
+  pressed = (raw_level == BUTTON_PRESSED_LEVEL);
+  active_button = this;
+
+#if defined(__AVR__)
+  // PCINT0_vect serves port B only
+  if(pinChangeLinked() && digitalPinToPCICR(pin) && digitalPinToPCICRbit(pin) == 0){
+    uint8_t sreg = SREG;
+    cli();
+    *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+    PCIFR = _BV(digitalPinToPCICRbit(pin));
+    *digitalPinToPCICR(pin) |= _BV(digitalPinToPCICRbit(pin));
+    SREG = sreg;
+    return true;
+  }
+  return tickAttach(on_tick, this);
+#else
+  if(digitalPinToInterrupt(pin) == NOT_AN_INTERRUPT)
+    return false;
+  attachInterrupt(digitalPinToInterrupt(pin), onPinChange, CHANGE);
+  return true;
+#endif
+}
+
+// get next classified event
+bool SixfabButton::read(NBIoT_ButtonEvent *event)
+{
+  process();
+
+  if(event_count == 0)
+    return false;
+
+  *event = events[event_head];
+  event_head = (event_head + 1) % BUTTON_EVENT_COUNT;
+  event_count--;
+  return true;
+}
+
+bool SixfabButton::isPressed()
+{
+  process();
+  return pressed;
+}
+
+bool SixfabButton::isBusy()
+{
+  process();
+  return pressed || click_pending || edge_count;
+}
+
+// record level change with its time
+void SixfabButton::onEdge()
+{
+  bool level = read_pin();
+
+  if(level == raw_level)
+    return;
+  raw_level = level;
+
+  uint8_t i;
+  if(edge_count < BUTTON_EDGE_COUNT){
+    i = (edge_head + edge_count) % BUTTON_EDGE_COUNT;
+    edge_count++;
+  }
+  else{
+    // queue is full of bounces, newest edge replaces last one
+    i = (edge_head + BUTTON_EDGE_COUNT - 1) % BUTTON_EDGE_COUNT;
+  }
+  edges[i].time = millis();
+  edges[i].level = level;
+}
+
+void SixfabButton::on_tick(void *context)
+{
+  ((SixfabButton *)context)->onEdge();
+}
+
+bool SixfabButton::read_pin()
+{
+#if defined(__AVR__)
+  return (*in & mask) ? HIGH : LOW;
+#else
+  return digitalRead(pin);
+#endif
+}
+
+// debounce recorded edges and classify presses
+void SixfabButton::process()
+{
+  while(true){
+    Edge edge;
+    bool last;
+    uint32_t stable_until;
+
+    {
+      BUTTON_LOCK();
+      uint8_t count = edge_count;
+      if(count){
+        edge.time = edges[edge_head].time;
+        edge.level = edges[edge_head].level;
+        last = (count == 1);
+        stable_until = last ? millis() : edges[(edge_head + 1) % BUTTON_EDGE_COUNT].time;
+      }
+      BUTTON_UNLOCK();
+      if(count == 0)
+        break;
+    }
+
+    if(last && stable_until - edge.time < BUTTON_DEBOUNCE_TIME)
+      break; // still bouncing
+
+    {
+      BUTTON_LOCK();
+      edge_head = (edge_head + 1) % BUTTON_EDGE_COUNT;
+      edge_count--;
+      BUTTON_UNLOCK();
+    }
+
+    if(stable_until - edge.time >= BUTTON_DEBOUNCE_TIME)
+      apply(edge.level == BUTTON_PRESSED_LEVEL, edge.time);
+  }
+
+  if(edge_count)
+    return; // classify after debounce
+  uint32_t now = millis();
+
+  if(pressed && !long_sent && now - press_time >= BUTTON_LONG_PRESS_TIME){
+    push(BUTTON_LONG_PRESS, press_time);
+    long_sent = true;
+    click_pending = false;
+  }
+  if(click_pending && !pressed && now - release_time > BUTTON_DOUBLE_CLICK_TIME){
+    push(BUTTON_CLICK, click_time);
+    click_pending = false;
+  }
+}
+
+// apply debounced level
+void SixfabButton::apply(bool level, uint32_t time)
+{
+  if(level == pressed)
+    return;
+  pressed = level;
+
+  if(pressed){
+    press_time = time;
+    long_sent = false;
+    push(BUTTON_PRESS, time);
+    return;
+  }
+
+  if(long_sent)
+    return; // release of reported long press
+
+  if(time - press_time >= BUTTON_LONG_PRESS_TIME){
+    push(BUTTON_LONG_PRESS, press_time); // released before read() noticed it
+    click_pending = false;
+  }
+  else if(click_pending && press_time - release_time <= BUTTON_DOUBLE_CLICK_TIME){
+    push(BUTTON_DOUBLE_CLICK, click_time);
+    click_pending = false;
+  }
+  else{
+    if(click_pending)
+      push(BUTTON_CLICK, click_time); // previous click, too late for double click
+    click_pending = true;
+    click_time = press_time;
+  }
+  release_time = time;
+}
+
+void SixfabButton::push(uint8_t type, uint32_t time)
+{
+  if(event_count == BUTTON_EVENT_COUNT){
+    dropped++;
+    return;
+  }
+
+  NBIoT_ButtonEvent &event = events[(event_head + event_count) % BUTTON_EVENT_COUNT];
+  event.type = type;
+  event.time = time;
+  event_count++;
+}
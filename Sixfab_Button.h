@@ -0,0 +1,187 @@
+/*
+  Sixfab_Button.h
+  -
+  Interrupt driven user button driver for Sixfab Arduino NBIoT Shield.
+  Level changes are recorded with their time in interrupt, so presses are
+  caught while modem command engine is blocked. Debounce and click, double
+  click and long press classification are done from read(), which should
+  be called from loop().
+
+  Edge source, chosen by begin() :
+    pin change : on AVR, if SIXFAB_BUTTON_PCINT_ISR() is in sketch. Wakes
+                 MCU from every sleep mode, power-down included. Pin must be
+                 on port B (PCINT0_vect) : USER_BUTTON is PB0 on Uno, but
+                 PH5 on Mega, which has no pin change interrupt, so Mega
+                 falls back to tick. SoftwareSerial defines all PCINT
+                 vectors, so it can't be used in same sketch, leave out
+                 SIXFAB_DEBUG_SERIAL() and pass another debug output or
+                 NULL to SixfabNBIoT.
+    tick       : on AVR otherwise, 1 ms sampling from Sixfab_Tick, needs
+                 SIXFAB_TICK_ISR() in sketch. Timer0 stops in every sleep
+                 mode but idle, so it wakes MCU only from SLEEP_MODE_IDLE.
+    other boards : attachInterrupt() on pin change.
+
+  Vectors are emitted by macros at file scope of the sketch, e.g. :
+
+    #include "Sixfab_Button.h"
+    SIXFAB_TICK_ISR()
+
+  A press can be answered at once, e.g. by submitting a PRIORITY_URGENT
+  message to SixfabUplinkScheduler on BUTTON_PRESS.
+*/
+
+#ifndef _SIXFAB_BUTTON_H
+#define _SIXFAB_BUTTON_H
+
+#include "Sixfab_NBIoT.h"
+#include "Sixfab_Tick.h"
+
+#if defined(__AVR__)
+  #include <avr/interrupt.h>
+  // emits pin change interrupt of port B, once in sketch
+  #define SIXFAB_BUTTON_PCINT_ISR() \
+    ISR(PCINT0_vect) { SixfabButton::onPinChange(); } \
+    bool SixfabButton::pinChangeLinked() { return true; }
+#else
+  #define SIXFAB_BUTTON_PCINT_ISR()
+#endif
+
+#ifndef BUTTON_PRESSED_LEVEL
+  #define BUTTON_PRESSED_LEVEL LOW // pin level while button is pressed
+#endif
+#define BUTTON_DEBOUNCE_TIME 30 // ms a level must be stable
+#define BUTTON_DOUBLE_CLICK_TIME 300 // ms between release and next press of double click
+#define BUTTON_LONG_PRESS_TIME 800 // ms of press for long press
+#define BUTTON_EDGE_COUNT 8 // level changes waiting for debounce
+#define BUTTON_EVENT_COUNT 4 // events waiting for read()
+
+enum NBIoT_ButtonEventType {
+  BUTTON_PRESS,        // debounced press, before classification
+  BUTTON_CLICK,
+  BUTTON_DOUBLE_CLICK,
+  BUTTON_LONG_PRESS    // given once while button is still held
+};
+
+typedef struct {
+  uint8_t type;  // NBIoT_ButtonEventType
+  uint32_t time; // millis() of press
+} NBIoT_ButtonEvent;
+
+class SixfabButton
+{
+  public:
+
+    /*
+    Constructor
+
+    [no-return]
+    ---
+    [param #1] : const NBIoT_Pins& peripheral pins
+    */
+    SixfabButton(const NBIoT_Pins & = NBIOT_DEFAULT_PINS);
+
+    /*
+    Function for setting pin direction and enabling edge source.
+    Only one button can be active.
+
+    [return] : bool false if no edge source is available
+    ---
+    [no-param]
+    */
+    bool begin();
+
+    /*
+    Function for getting next button event. Waiting level changes are
+    debounced and classified first.
+
+    [return] : bool false if no event is waiting
+    ---
+    [param #1] : NBIoT_ButtonEvent* output
+    */
+    bool read(NBIoT_ButtonEvent *);
+
+    /*
+    Function for getting debounced button state
+
+    [return] : bool true if button is pressed
+    ---
+    [no-param]
+    */
+    bool isPressed();
+
+    /*
+    Function for checking if events are still to come, MCU shouldn't
+    sleep while button is busy.
+
+    [return] : bool true if button is pressed, bouncing or waiting for double click
+    ---
+    [no-param]
+    */
+    bool isBusy();
+
+    /*
+    Function for recording level change, called from pin interrupt.
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void onEdge();
+
+    /*
+    Function for recording level change of active button, called from
+    SIXFAB_BUTTON_PCINT_ISR().
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    static void onPinChange();
+
+    /*
+    Function for checking if SIXFAB_BUTTON_PCINT_ISR() is in sketch. Defined
+    weak by library, the macro overrides it.
+
+    [return] : bool true if pin change interrupt is linked
+    ---
+    [no-param]
+    */
+    static bool pinChangeLinked();
+
+    uint16_t dropped; // events lost because queue was full
+
+  private:
+    typedef struct {
+      uint32_t time;
+      bool level;
+    } Edge;
+
+    uint8_t pin;
+#if defined(__AVR__)
+    volatile uint8_t *in; // input register of pin
+    uint8_t mask;
+#endif
+    volatile Edge edges[BUTTON_EDGE_COUNT];
+    volatile uint8_t edge_head;
+    volatile uint8_t edge_count;
+    volatile bool raw_level; // last recorded level
+
+    NBIoT_ButtonEvent events[BUTTON_EVENT_COUNT];
+    uint8_t event_head;
+    uint8_t event_count;
+
+    bool pressed;
+    bool long_sent;
+    bool click_pending;
+    uint32_t press_time;
+    uint32_t click_time;   // press time of pending click
+    uint32_t release_time;
+
+    static void on_tick(void *context);
+    bool read_pin();
+    void process();
+    void apply(bool level, uint32_t time);
+    void push(uint8_t type, uint32_t time);
+};
+
+#endif
@@ -0,0 +1,216 @@
+/*
+  Sixfab_Commands.cpp
+  -
+  Downlink command dispatcher for Sixfab Arduino NBIoT Shield.
+*/
+
+#include "Sixfab_Commands.h"
+
+#if defined(__AVR__)
+  #include <avr/wdt.h>
+  #include <avr/interrupt.h>
+#endif
+
+#define ACTUATOR_COMMAND_LEN 10 // longest actuator command, ACT_SCHEDULE
+
+static uint32_t read_u32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+const NBIoT_CommandEntry SixfabCommands::builtin[] PROGMEM = {
+  {OP_SWITCH, 2, on_switch},
+  {OP_ACTUATOR, ACTUATOR_COMMAND_LEN, on_actuator},
+  {OP_SAMPLE_PERIOD, 4, on_sample_period},
+  {OP_PSM, 8, on_psm},
+  {OP_REBOOT, 0, on_reboot}
+};
+
+SixfabCommands::SixfabCommands(SixfabNBIoT &nbiot, SixfabActuator *actuators)
+  : node(nbiot)
+{
+  actuator = actuators;
+  table = NULL;
+  table_len = 0;
+  context = NULL;
+  state.magic = 0;
+  state.sequence = 0;
+  state.sample_period = COMMAND_SAMPLE_PERIOD;
+  reboot = false;
+  ack_count = 0;
+  dropped = 0;
+}
+
+void SixfabCommands::begin()
+{
+  NBIoT_CommandState stored;
+
+  storageGet(EEPROM_COMMAND_STATE, stored);
+  if(stored.magic == COMMAND_MAGIC)
+    state = stored;
+}
+
+void SixfabCommands::setHandlers(const NBIoT_CommandEntry *entries, uint8_t count, void *handler_context)
+{
+  table = entries;
+  table_len = count;
+  context = handler_context;
+}
+
+uint8_t SixfabCommands::dispatch(const uint8_t *data, uint16_t len)
+{
+  NBIoT_CommandState old = state;
+  uint16_t pos = 0;
+  uint8_t count = 0;
+
+  while(pos + 2 <= len){
+    uint8_t sequence = data[pos];
+    uint8_t opcode = data[pos + 1];
+    NBIoT_CommandEntry entry;
+    void *handler_context = context;
+
+    pos += 2;
+    if(!find(table, table_len, opcode, &entry)){
+      handler_context = this;
+      if(!find(builtin, sizeof(builtin) / sizeof(builtin[0]), opcode, &entry)){
+        acknowledge(sequence, ACK_UNKNOWN); // length of arguments is unknown
+        break;
+      }
+    }
+    if(len - pos < entry.arg_len){
+      acknowledge(sequence, ACK_BAD_ARGS);
+      break;
+    }
+
+    const uint8_t *args = data + pos;
+    pos += entry.arg_len;
+
+    if(state.magic == COMMAND_MAGIC && (int8_t)(sequence - state.sequence) <= 0){
+      acknowledge(sequence, ACK_DUPLICATE);
+      continue;
+    }
+
+    acknowledge(sequence, entry.handler(args, handler_context));
+    state.magic = COMMAND_MAGIC;
+    state.sequence = sequence;
+    count++;
+  }
+
+  if(old.magic != state.magic || old.sequence != state.sequence || old.sample_period != state.sample_period)
+    storagePut(EEPROM_COMMAND_STATE, state);
+  return count;
+}
+
+uint8_t SixfabCommands::pack(uint8_t *buffer, uint8_t size)
+{
+  uint8_t packed = 0;
+  uint8_t len = 0;
+
+  while(packed < ack_count && len + COMMAND_ACK_LEN <= size){
+    memcpy(buffer + len, acks[packed++], COMMAND_ACK_LEN);
+    len += COMMAND_ACK_LEN;
+  }
+  ack_count -= packed;
+  memmove(acks, acks[packed], ack_count * COMMAND_ACK_LEN);
+  return len;
+}
+
+void SixfabCommands::poll()
+{
+  if(!reboot || ack_count)
+    return;
+
+  LOG_WARN("COMMANDS", "reboot");
+  sixfabLog.flush();
+#if defined(__AVR__)
+  cli();
+  wdt_enable(WDTO_15MS);
+  for(;;);
+#endif
+}
+
+uint32_t SixfabCommands::getSamplePeriod()
+{
+  return state.sample_period;
+}
+
+// look up opcode in flash table
+bool SixfabCommands::find(const NBIoT_CommandEntry *entries, uint8_t count, uint8_t opcode, NBIoT_CommandEntry *entry)
+{
+  for(uint8_t i = 0; i < count; i++){
+    memcpy_P(entry, &entries[i], sizeof(NBIoT_CommandEntry));
+    if(entry->opcode == opcode)
+      return true;
+  }
+  return false;
+}
+
+void SixfabCommands::acknowledge(uint8_t sequence, uint8_t status)
+{
+  if(ack_count == COMMAND_ACK_COUNT){
+    dropped++;
+    return;
+  }
+  acks[ack_count][0] = sequence;
+  acks[ack_count][1] = status;
+  ack_count++;
+}
+
+// actuator(1) on(1)
+uint8_t SixfabCommands::on_switch(const uint8_t *args, void *context)
+{
+  SixfabCommands *commands = (SixfabCommands *)context;
+
+  if(commands->actuator == NULL)
+    return ACK_FAILED;
+  if(args[0] >= ACTUATOR_COUNT || args[1] > 1)
+    return ACK_BAD_ARGS;
+  commands->actuator->set((NBIoT_Actuator)args[0], args[1]);
+  return ACK_OK;
+}
+
+// actuator command, see Sixfab_Actuator.h
+uint8_t SixfabCommands::on_actuator(const uint8_t *args, void *context)
+{
+  SixfabCommands *commands = (SixfabCommands *)context;
+
+  if(commands->actuator == NULL)
+    return ACK_FAILED;
+  return commands->actuator->handleCommand(args, ACTUATOR_COMMAND_LEN) ? ACK_OK : ACK_BAD_ARGS;
+}
+
+// period_s(4)
+uint8_t SixfabCommands::on_sample_period(const uint8_t *args, void *context)
+{
+  SixfabCommands *commands = (SixfabCommands *)context;
+  uint32_t period = read_u32(args);
+
+  if(period == 0)
+    return ACK_BAD_ARGS;
+  commands->state.sample_period = period;
+  return ACK_OK;
+}
+
+// tau_s(4) active_s(4)
+uint8_t SixfabCommands::on_psm(const uint8_t *args, void *context)
+{
+  SixfabCommands *commands = (SixfabCommands *)context;
+
+  return commands->node.setPSM(read_u32(args), read_u32(args + 4)) ? ACK_OK : ACK_FAILED;
+}
+
+uint8_t SixfabCommands::on_reboot(const uint8_t *args, void *context)
+{
+  SixfabCommands *commands = (SixfabCommands *)context;
+
+  (void)args;
+  if(!storageAvailable())
+    return ACK_FAILED; // sequence would be lost and command run again after reset
+#if defined(__AVR__)
+  commands->reboot = true;
+  return ACK_OK;
+#else
+  (void)commands;
+  return ACK_FAILED; // no portable reset
+#endif
+}
@@ -0,0 +1,168 @@
+/*
+  Sixfab_Commands.h
+  -
+  Downlink command dispatcher for Sixfab Arduino NBIoT Shield.
+  A downlink carries one or more commands, integers are big endian :
+
+    [sequence(1)][opcode(1)][arguments, fixed length of opcode]...
+
+  Opcodes and their argument lengths are kept in flash tables. Sketch
+  handlers are looked up before built-in ones. Each command gets an
+  acknowledge of sequence and NBIoT_AckStatus, that is sent by pack() in
+  next uplink. Last executed sequence is stored in EEPROM, so a command
+  that is received again, e.g. reboot after reboot, is acknowledged with
+  ACK_DUPLICATE and not run. Sequence is compared modulo 256.
+
+  Built-in commands :
+    OP_SWITCH        actuator(1) on(1)
+    OP_ACTUATOR      actuator command of Sixfab_Actuator.h, zero padded to 10 bytes
+    OP_SAMPLE_PERIOD period_s(4)
+    OP_PSM           tau_s(4) active_s(4), see SixfabNBIoT::setPSM()
+    OP_REBOOT        MCU is reset by poll() after acknowledge is packed
+*/
+
+#ifndef _SIXFAB_COMMANDS_H
+#define _SIXFAB_COMMANDS_H
+
+#include "Sixfab_NBIoT.h"
+#include "Sixfab_Actuator.h"
+
+#define COMMAND_ACK_COUNT 8 // acknowledges waiting for pack()
+#define COMMAND_ACK_LEN 2 // bytes of a packed acknowledge
+#define COMMAND_SAMPLE_PERIOD 300 // s, sampling period until changed by downlink
+#define COMMAND_MAGIC 0xC3
+
+// built-in opcodes
+#define OP_SWITCH 0x01
+#define OP_ACTUATOR 0x02
+#define OP_SAMPLE_PERIOD 0x10
+#define OP_PSM 0x11
+#define OP_REBOOT 0x20
+
+enum NBIoT_AckStatus {
+  ACK_OK,
+  ACK_UNKNOWN,   // opcode not in tables, rest of downlink is skipped
+  ACK_BAD_ARGS,  // arguments truncated or out of range
+  ACK_FAILED,    // handler couldn't run command
+  ACK_DUPLICATE  // sequence already executed
+};
+
+// command handler, returns NBIoT_AckStatus
+typedef uint8_t (*NBIoT_CommandHandler)(const uint8_t *args, void *context);
+
+// entry of opcode table, tables are kept in flash
+typedef struct {
+  uint8_t opcode;
+  uint8_t arg_len; // fixed argument bytes
+  NBIoT_CommandHandler handler;
+} NBIoT_CommandEntry;
+
+// dispatcher state, stored in EEPROM
+typedef struct {
+  uint8_t magic;          // COMMAND_MAGIC if valid
+  uint8_t sequence;       // last executed sequence
+  uint32_t sample_period; // s
+} NBIoT_CommandState;
+
+class SixfabCommands
+{
+  public:
+
+    /*
+    Constructor
+
+    [no-return]
+    ---
+    [param #1] : SixfabNBIoT& node, for PSM commands
+    [param #2] : SixfabActuator* relay and LED driver, NULL if not used
+    */
+    SixfabCommands(SixfabNBIoT &, SixfabActuator * = NULL);
+
+    /*
+    Function for loading last sequence and sampling period from EEPROM
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void begin();
+
+    /*
+    Function for setting opcode table of sketch. Its opcodes override
+    built-in ones.
+
+    [no-return]
+    ---
+    [param #1] : const NBIoT_CommandEntry* table in flash (PROGMEM)
+    [param #2] : uint8_t number of entries
+    [param #3] : void* context that passed to handlers
+    */
+    void setHandlers(const NBIoT_CommandEntry *, uint8_t, void *);
+
+    /*
+    Function for running commands of a downlink, e.g. payload returned
+    by receiveDataUDP() or SixfabSecure::open().
+
+    [return] : uint8_t number of commands run
+    ---
+    [param #1] : const uint8_t* downlink
+    [param #2] : uint16_t downlink length
+    */
+    uint8_t dispatch(const uint8_t *, uint16_t);
+
+    /*
+    Function for moving waiting acknowledges into uplink records. Each
+    record is sequence and NBIoT_AckStatus.
+
+    [return] : uint8_t bytes written, a multiple of COMMAND_ACK_LEN
+    ---
+    [param #1] : uint8_t* output
+    [param #2] : uint8_t size of output
+    */
+    uint8_t pack(uint8_t *, uint8_t);
+
+    /*
+    Function for resetting MCU when a reboot command is acknowledged.
+    Should be called from loop() after uplink is sent.
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void poll();
+
+    /*
+    Function for getting sampling period set by downlink
+
+    [return] : uint32_t period in s
+    ---
+    [no-param]
+    */
+    uint32_t getSamplePeriod();
+
+    uint16_t dropped; // acknowledges lost because queue was full
+
+  private:
+    SixfabNBIoT &node;
+    SixfabActuator *actuator;
+    const NBIoT_CommandEntry *table; // sketch handlers in flash
+    uint8_t table_len;
+    void *context;
+    NBIoT_CommandState state;
+    bool reboot; // reset after acknowledge is packed
+    uint8_t acks[COMMAND_ACK_COUNT][COMMAND_ACK_LEN];
+    uint8_t ack_count;
+
+    static const NBIoT_CommandEntry builtin[]; // in flash
+
+    static uint8_t on_switch(const uint8_t *args, void *context);
+    static uint8_t on_actuator(const uint8_t *args, void *context);
+    static uint8_t on_sample_period(const uint8_t *args, void *context);
+    static uint8_t on_psm(const uint8_t *args, void *context);
+    static uint8_t on_reboot(const uint8_t *args, void *context);
+
+    bool find(const NBIoT_CommandEntry *table, uint8_t len, uint8_t opcode, NBIoT_CommandEntry *entry);
+    void acknowledge(uint8_t sequence, uint8_t status);
+};
+
+#endif
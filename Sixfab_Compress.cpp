@@ -0,0 +1,100 @@
+/*
+  Sixfab_Compress.cpp
+  -
+  Streaming compressor of batched telemetry for Sixfab NBIoT library.
+*/
+
+#include "Sixfab_Compress.h"
+
+// differences are taken modulo 2^32, so any int32_t step can be coded
+static uint32_t zigzag(uint32_t delta)
+{
+  return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+}
+
+static uint32_t unzigzag(uint32_t value)
+{
+  return (value >> 1) ^ (uint32_t)-(int32_t)(value & 1);
+}
+
+SixfabDeltaEncoder::SixfabDeltaEncoder(uint8_t *out, uint16_t out_size, uint8_t sample_channels)
+{
+  buffer = out;
+  size = out_size;
+  channels = (sample_channels < COMPRESS_CHANNELS) ? sample_channels : COMPRESS_CHANNELS;
+  reset();
+}
+
+void SixfabDeltaEncoder::reset()
+{
+  len = 0;
+  count = 0;
+  for(uint8_t i = 0; i < COMPRESS_CHANNELS; i++)
+    previous[i] = 0;
+}
+
+// code sample after last one, previous values change only if it fits
+bool SixfabDeltaEncoder::add(const int32_t *values)
+{
+  uint16_t end = len;
+
+  for(uint8_t i = 0; i < channels; i++){
+    uint32_t value = zigzag((uint32_t)values[i] - (uint32_t)previous[i]);
+
+    do{
+      if(end == size)
+        return false;
+      buffer[end++] = (value > 0x7F) ? (value & 0x7F) | 0x80 : value;
+      value >>= 7;
+    } while(value);
+  }
+
+  for(uint8_t i = 0; i < channels; i++)
+    previous[i] = values[i];
+  len = end;
+  count++;
+  return true;
+}
+
+uint16_t SixfabDeltaEncoder::length()
+{
+  return len;
+}
+
+uint16_t SixfabDeltaEncoder::samples()
+{
+  return count;
+}
+
+// decode whole samples until data or output ends
+uint16_t deltaDecode(const uint8_t *data, uint16_t len, uint8_t channels, int32_t *values, uint16_t max_samples)
+{
+  uint16_t pos = 0;
+  uint16_t count = 0;
+
+  if(channels == 0)
+    return 0;
+
+  while(count < max_samples && pos < len){
+    int32_t *sample = values + (uint32_t)count * channels;
+
+    for(uint8_t i = 0; i < channels; i++){
+      uint32_t value = 0;
+      uint8_t shift = 0;
+      uint8_t c;
+
+      do{
+        if(pos == len || shift == 7 * COMPRESS_VARINT_LEN)
+          return count; // truncated or too long
+        c = data[pos++];
+        value |= (uint32_t)(c & 0x7F) << shift;
+        shift += 7;
+      } while(c & 0x80);
+
+      int32_t last = count ? sample[i - (int16_t)channels] : 0;
+      sample[i] = (int32_t)((uint32_t)last + unzigzag(value));
+    }
+    count++;
+  }
+  return count;
+}
@@ -0,0 +1,98 @@
+/*
+  Sixfab_Compress.h
+  -
+  Streaming compressor of batched telemetry for Sixfab NBIoT library.
+  Each sample is a fixed number of integer channels (e.g. temperature,
+  humidity, x, y, z). A channel is coded as difference to its previous
+  value, zigzag mapped so small negative differences stay small, and
+  written as a varint of 7 bit groups. Slowly varying channels take one
+  byte per sample instead of two or four.
+  -
+  Encoder and decoder don't allocate and don't depend on Arduino core, so
+  server side decoders and tests can use this file on host.
+*/
+
+#ifndef _SIXFAB_COMPRESS_H
+#define _SIXFAB_COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define COMPRESS_CHANNELS 8 // max channels of a sample
+#define COMPRESS_VARINT_LEN 5 // max bytes of a coded value
+
+class SixfabDeltaEncoder
+{
+  public:
+
+    /*
+    Constructor
+
+    [no-return]
+    ---
+    [param #1] : uint8_t* output buffer, e.g. uplink datagram
+    [param #2] : uint16_t size of buffer
+    [param #3] : uint8_t channels of each sample, max COMPRESS_CHANNELS
+    */
+    SixfabDeltaEncoder(uint8_t *, uint16_t, uint8_t);
+
+    /*
+    Function for starting a new batch, first sample is coded against 0.
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void reset();
+
+    /*
+    Function for appending a sample. Sample is either added completely or
+    not at all.
+
+    [return] : bool false if sample doesn't fit in buffer
+    ---
+    [param #1] : const int32_t* one value per channel
+    */
+    bool add(const int32_t *);
+
+    /*
+    Function for getting coded bytes of batch
+
+    [return] : uint16_t bytes written to buffer
+    ---
+    [no-param]
+    */
+    uint16_t length();
+
+    /*
+    Function for getting number of samples in batch
+
+    [return] : uint16_t samples
+    ---
+    [no-param]
+    */
+    uint16_t samples();
+
+  private:
+    uint8_t *buffer;
+    uint16_t size;
+    uint16_t len;
+    uint16_t count;
+    uint8_t channels;
+    int32_t previous[COMPRESS_CHANNELS];
+};
+
+/*
+Function for decoding a batch of SixfabDeltaEncoder
+
+[return] : uint16_t decoded samples, stops at first truncated or malformed sample
+---
+[param #1] : const uint8_t* coded batch
+[param #2] : uint16_t length of batch
+[param #3] : uint8_t channels of each sample
+[param #4] : int32_t* output, channels values per sample
+[param #5] : uint16_t max samples of output
+*/
+uint16_t deltaDecode(const uint8_t *, uint16_t, uint8_t, int32_t *, uint16_t);
+
+#endif
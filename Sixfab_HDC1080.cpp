@@ -3,20 +3,25 @@
 #include "Sixfab_HDC1080.h"
 
 Sixfab_HDC1080::Sixfab_HDC1080(){
-
+	_both = false;
 }
 
 void Sixfab_HDC1080::begin(uint8_t address){
+	begin(address, sixfabI2C);
+}
+
+void Sixfab_HDC1080::begin(uint8_t address, SixfabI2CBus &bus){
 	_address = address;
-	Wire.begin();
+	_bus = &bus;
+	_bus->begin();
 
 	setResolution(SIXFAB_HDC1080_RESOLUTION_14BIT, SIXFAB_HDC1080_RESOLUTION_14BIT);
 }
 
 void Sixfab_HDC1080::setResolution(HDC1080_MeasurementResolution humidity, HDC1080_MeasurementResolution temperature) {
 	HDC1080_Registers reg;
-	reg.HumidityMeasurementResolution = 0;
-	reg.TemperatureMeasurementResolution = 0;
+	reg.rawData = 0;
+	reg.ModeOfAcquisition = _both;
 
 	if (temperature == SIXFAB_HDC1080_RESOLUTION_11BIT)
 		reg.TemperatureMeasurementResolution = 0x01;
@@ -51,14 +56,34 @@ HDC1080_Registers Sixfab_HDC1080::readRegister() {
 }
 
 void Sixfab_HDC1080::writeRegister(HDC1080_Registers reg) {
-	Wire.beginTransmission(_address);
-	Wire.write(HDC1080_CONFIGURATION);
-	Wire.write(reg.rawData);
-	Wire.write(0x00);
-	Wire.endTransmission();
+	uint8_t data[2] = {reg.rawData, 0x00};
+	_bus->writeRegisters(_address, HDC1080_CONFIGURATION, data, 2);
+	_both = reg.ModeOfAcquisition;
 	delay(10);
 }
 
+void Sixfab_HDC1080::setAcquisition(bool both) {
+	if (_both == both)
+		return;
+	HDC1080_Registers reg = readRegister();
+	reg.ModeOfAcquisition = both;
+	writeRegister(reg);
+}
+
+bool Sixfab_HDC1080::startConversion() {
+	setAcquisition(true);
+	return _bus->writeRegisters(_address, HDC1080_TEMPERATURE, NULL, 0) == I2C_OK;
+}
+
+bool Sixfab_HDC1080::readConversion(uint16_t *rawT, uint16_t *rawH) {
+	uint8_t buf[4];
+	if (_bus->readBytes(_address, buf, 4) != I2C_OK)
+		return false; // device doesn't acknowledge until conversion ends
+	*rawT = buf[0] << 8 | buf[1];
+	*rawH = buf[2] << 8 | buf[3];
+	return true;
+}
+
 void Sixfab_HDC1080::heatUp(uint8_t seconds) {
 	HDC1080_Registers reg = readRegister();
 	reg.Heater = 1;
@@ -67,12 +92,7 @@ void Sixfab_HDC1080::heatUp(uint8_t seconds) {
 
 	uint8_t buf[4];
 	for (int i = 1; i < (seconds*66); i++) {
-		Wire.beginTransmission(_address);
-		Wire.write(0x00);
-		Wire.endTransmission();
-		delay(20);
-		Wire.requestFrom(_address, (uint8_t)4);
-		Wire.readBytes(buf, (size_t)4);
+		_bus->readRegisters(_address, HDC1080_TEMPERATURE, buf, 4, 20);
 	}
 	reg.Heater = 0;
 	reg.ModeOfAcquisition = 0;
@@ -86,6 +106,7 @@ double Sixfab_HDC1080::readT() {
 }
 
 double Sixfab_HDC1080::readTemperature() {
+	setAcquisition(false);
 	uint16_t rawT = readData(HDC1080_TEMPERATURE);
 	return (rawT / pow(2, 16)) * 165.0 - 40.0;
 }
@@ -95,6 +116,7 @@ double Sixfab_HDC1080::readH() {
 }
 
 double Sixfab_HDC1080::readHumidity() {
+	setAcquisition(false);
 	uint16_t rawH = readData(HDC1080_HUMIDITY);
 	return (rawH / pow(2, 16)) * 100.0;
 }
@@ -108,15 +130,9 @@ uint16_t Sixfab_HDC1080::readDeviceId() {
 }
 
 uint16_t Sixfab_HDC1080::readData(uint8_t pointer) {
-	Wire.beginTransmission(_address);
-	Wire.write(pointer);
-	Wire.endTransmission();
-	
-	delay(9);
-	Wire.requestFrom(_address, (uint8_t)2);
-
-	byte msb = Wire.read();
-	byte lsb = Wire.read();
+	// failed read gives 0xFFFF, like empty buffer of Wire
+	uint8_t buf[2] = {0xFF, 0xFF};
+	_bus->readRegisters(_address, pointer, buf, 2, 9);
 
-	return msb << 8 | lsb;
+	return buf[0] << 8 | buf[1];
 }
\ No newline at end of file
@@ -2,6 +2,10 @@
 #define _SIXFAB_HDC1080_h
 
 #include <Arduino.h>
+#include <Wire.h>
+#include "Sixfab_I2CBus.h"
+
+#define HDC1080_CONVERSION_TIME 15 // ms, 14 bit temperature and humidity in sequence
 
 typedef enum {
 	SIXFAB_HDC1080_RESOLUTION_8BIT,
@@ -47,6 +51,7 @@ public:
 	Sixfab_HDC1080();
 
 	void begin(uint8_t address);
+	void begin(uint8_t address, SixfabI2CBus &bus);
 	uint16_t readManufacturerId(); // 0x5449 ID of Texas Instruments
 	uint16_t readDeviceId(); // 0x1050 ID of the device
 
@@ -65,9 +70,15 @@ public:
 	double readT(); // short-cut for readTemperature
 	double readH(); // short-cut for readHumidity
 
+	bool startConversion(); // temperature and humidity in one conversion, non-blocking
+	bool readConversion(uint16_t *rawT, uint16_t *rawH); // HDC1080_CONVERSION_TIME after start, false if not ready
+
 private:
 	uint8_t _address;
+	SixfabI2CBus *_bus;
+	bool _both; // ModeOfAcquisition set, a conversion measures both
 	uint16_t readData(uint8_t pointer);
+	void setAcquisition(bool both);
 	
 };
 
@@ -0,0 +1,227 @@
+/*
+  Sixfab_I2CBus.cpp
+  -
+  Shared I2C bus of sensors of Sixfab Arduino NBIoT Shield.
+*/
+
+#include "Sixfab_I2CBus.h"
+
+#define I2C_HALF_PERIOD 5 // us, recovery is clocked at 100 kHz
+
+SixfabI2CBus sixfabI2C;
+
+// open drain output, pin is pulled up when released
+static void drive_low(uint8_t pin)
+{
+  digitalWrite(pin, LOW);
+  pinMode(pin, OUTPUT);
+}
+
+static void release(uint8_t pin)
+{
+  pinMode(pin, INPUT_PULLUP);
+}
+
+SixfabI2CBus::SixfabI2CBus(TwoWire &port, uint8_t sda_pin, uint8_t scl_pin)
+{
+  wire = &port;
+  sda = sda_pin;
+  scl = scl_pin;
+  clock = I2C_CLOCK;
+  timeout = I2C_TRANSACTION_TIMEOUT;
+  started = false;
+  errors = 0;
+  recoveries = 0;
+}
+
+void SixfabI2CBus::begin(uint32_t scl_clock)
+{
+  if(started)
+    return;
+
+  clock = scl_clock;
+  start_port();
+
+  // a slave may still hold SDA from a read cut by MCU reset
+  if(digitalRead(sda) == LOW)
+    recover();
+}
+
+// read with one retry after bus recovery
+uint8_t SixfabI2CBus::readRegisters(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t len, uint16_t wait)
+{
+  begin(clock);
+
+  uint8_t status = read_once(address, reg, buffer, len, wait);
+  if(status == I2C_TIMEOUT || status == I2C_BUS_ERROR){
+    recover();
+    status = read_once(address, reg, buffer, len, wait);
+  }
+  if(status != I2C_OK)
+    errors++;
+  return status;
+}
+
+// read without pointer write, with one retry after bus recovery
+uint8_t SixfabI2CBus::readBytes(uint8_t address, uint8_t *buffer, uint8_t len)
+{
+  begin(clock);
+
+  uint8_t status = request_once(address, buffer, len);
+  if(status == I2C_TIMEOUT || status == I2C_BUS_ERROR){
+    recover();
+    status = request_once(address, buffer, len);
+  }
+  if(status != I2C_OK)
+    errors++;
+  return status;
+}
+
+// write with one retry after bus recovery
+uint8_t SixfabI2CBus::writeRegisters(uint8_t address, uint8_t reg, const uint8_t *buffer, uint8_t len)
+{
+  begin(clock);
+
+  uint8_t status = write_once(address, reg, buffer, len);
+  if(status == I2C_TIMEOUT || status == I2C_BUS_ERROR){
+    recover();
+    status = write_once(address, reg, buffer, len);
+  }
+  if(status != I2C_OK)
+    errors++;
+  return status;
+}
+
+// clock out byte held by slave, then generate stop
+bool SixfabI2CBus::recover()
+{
+  wire->end();
+  release(sda);
+  release(scl);
+  delayMicroseconds(I2C_HALF_PERIOD);
+
+  for(uint8_t i = 0; i < I2C_RECOVERY_CLOCKS && digitalRead(sda) == LOW; i++){
+    drive_low(scl);
+    delayMicroseconds(I2C_HALF_PERIOD);
+    release(scl);
+    delayMicroseconds(I2C_HALF_PERIOD);
+  }
+
+  // stop : SDA rises while SCL is high
+  drive_low(sda);
+  delayMicroseconds(I2C_HALF_PERIOD);
+  release(sda);
+  delayMicroseconds(I2C_HALF_PERIOD);
+
+  bool idle = (digitalRead(sda) == HIGH && digitalRead(scl) == HIGH);
+  recoveries++;
+  start_port();
+  return idle;
+}
+
+// move to another port, started again on next transaction
+void SixfabI2CBus::setWire(TwoWire &port, uint8_t sda_pin, uint8_t scl_pin)
+{
+  if(&port == wire)
+    return;
+  wire = &port;
+  sda = sda_pin;
+  scl = scl_pin;
+  started = false;
+}
+
+void SixfabI2CBus::setTimeout(uint16_t ms)
+{
+  timeout = ms;
+  if(started)
+    start_port();
+}
+
+TwoWire &SixfabI2CBus::getWire()
+{
+  return *wire;
+}
+
+uint8_t SixfabI2CBus::read_once(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t len, uint16_t wait)
+{
+  wire->beginTransmission(address);
+  wire->write(reg);
+  uint8_t status = end_transmission(wait != 0);
+  if(status != I2C_OK)
+    return status;
+
+  if(wait)
+    delay(wait);
+
+  return request_once(address, buffer, len);
+}
+
+uint8_t SixfabI2CBus::request_once(uint8_t address, uint8_t *buffer, uint8_t len)
+{
+  uint8_t count = wire->requestFrom(address, len);
+#if defined(WIRE_HAS_TIMEOUT)
+  if(wire->getWireTimeoutFlag()){
+    wire->clearWireTimeoutFlag();
+    return I2C_TIMEOUT;
+  }
+#endif
+  if(count == 0)
+    return I2C_NACK;
+
+  // some cores fill receive buffer after requestFrom() returns
+  uint32_t start = millis();
+  while(wire->available() < len){
+    if(millis() - start >= timeout){
+      while(wire->available())
+        wire->read();
+      return I2C_BUS_ERROR;
+    }
+  }
+
+  for(uint8_t i = 0; i < len; i++)
+    buffer[i] = wire->read();
+  return I2C_OK;
+}
+
+uint8_t SixfabI2CBus::write_once(uint8_t address, uint8_t reg, const uint8_t *buffer, uint8_t len)
+{
+  wire->beginTransmission(address);
+  wire->write(reg);
+  if(len)
+    wire->write(buffer, len);
+  return end_transmission(true);
+}
+
+// map status of endTransmission()
+uint8_t SixfabI2CBus::end_transmission(bool stop)
+{
+  uint8_t status = wire->endTransmission(stop);
+
+#if defined(WIRE_HAS_TIMEOUT)
+  if(wire->getWireTimeoutFlag()){
+    wire->clearWireTimeoutFlag();
+    return I2C_TIMEOUT;
+  }
+#endif
+
+  switch(status){
+    case 0:
+      return I2C_OK;
+    case 2: // address
+    case 3: // data
+      return I2C_NACK;
+    case 5:
+      return I2C_TIMEOUT;
+  }
+  return I2C_BUS_ERROR;
+}
+
+void SixfabI2CBus::start_port()
+{
+  wire->begin();
+  wire->setClock(clock);
+#if defined(WIRE_HAS_TIMEOUT)
+  wire->setWireTimeout((uint32_t)timeout * 1000, true); // TWI is reset on timeout
+#endif
+  started = true;
+}
@@ -0,0 +1,165 @@
+/*
+  Sixfab_I2CBus.h
+  -
+  Shared I2C bus of HDC1080 and MMA8452Q sensors of Sixfab Arduino NBIoT Shield.
+  Bus is started once for both sensors, in 400 kHz fast mode that both
+  devices support. Every register access is a single transaction. With a
+  Wire that has setWireTimeout() (WIRE_HAS_TIMEOUT, AVR core 1.8.2 and
+  later) it is bounded, so a glitched bus returns an error instead of
+  hanging the node. Other cores bound only the wait for read data, a
+  transaction itself can block as long as their Wire does. After a
+  timeout, a slave holding SDA low is released by toggling SCL and the
+  transaction is tried once more.
+
+  sixfabI2C is the one manager of the sketch. Sensors created without a
+  bus and SixfabNBIoT use it, so they share error counters, clock,
+  timeout and recovery. SixfabNBIoT moves it to its own port in init().
+
+  Transfers are done by interrupt driven TWI of Wire. Wire has a single
+  transfer buffer and blocks until its transaction ends, so transactions
+  are run one after another rather than queued.
+*/
+
+#ifndef _SIXFAB_I2CBUS_H
+#define _SIXFAB_I2CBUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define I2C_CLOCK 400000 // fast mode, max of HDC1080 and MMA8452Q
+#define I2C_TRANSACTION_TIMEOUT 25 // ms per transaction
+#define I2C_RECOVERY_CLOCKS 9 // SCL pulses to finish a byte held by slave
+
+enum NBIoT_I2CStatus {
+  I2C_OK,
+  I2C_NACK,      // device didn't acknowledge address or data
+  I2C_TIMEOUT,   // transaction didn't end in time
+  I2C_BUS_ERROR  // arbitration lost, short read or SDA stuck low
+};
+
+class SixfabI2CBus
+{
+  public:
+
+    /*
+    Constructor
+
+    [no-return]
+    ---
+    [param #1] : TwoWire& I2C port
+    [param #2] : uint8_t SDA pin of port, used for recovery
+    [param #3] : uint8_t SCL pin of port, used for recovery
+    */
+    SixfabI2CBus(TwoWire & = Wire, uint8_t = SDA, uint8_t = SCL);
+
+    /*
+    Function for starting bus, only first call starts the port.
+
+    [no-return]
+    ---
+    [param #1] : uint32_t SCL clock in Hz
+    */
+    void begin(uint32_t = I2C_CLOCK);
+
+    /*
+    Function for reading consecutive registers in one transaction.
+    Register pointer is written with repeated start, or with stop followed
+    by [param #5] ms wait for devices converting on pointer write (HDC1080).
+
+    [return] : uint8_t NBIoT_I2CStatus
+    ---
+    [param #1] : uint8_t 7 bit device address
+    [param #2] : uint8_t first register
+    [param #3] : uint8_t* output
+    [param #4] : uint8_t number of registers
+    [param #5] : uint16_t ms between pointer write and read, 0 for repeated start
+    */
+    uint8_t readRegisters(uint8_t, uint8_t, uint8_t *, uint8_t, uint16_t = 0);
+
+    /*
+    Function for reading bytes without writing register pointer, e.g. result
+    of a conversion started by writeRegisters() with no data (HDC1080).
+
+    [return] : uint8_t NBIoT_I2CStatus
+    ---
+    [param #1] : uint8_t 7 bit device address
+    [param #2] : uint8_t* output
+    [param #3] : uint8_t number of bytes
+    */
+    uint8_t readBytes(uint8_t, uint8_t *, uint8_t);
+
+    /*
+    Function for writing consecutive registers in one transaction. With no
+    data only register pointer is written.
+
+    [return] : uint8_t NBIoT_I2CStatus
+    ---
+    [param #1] : uint8_t 7 bit device address
+    [param #2] : uint8_t first register
+    [param #3] : const uint8_t* data
+    [param #4] : uint8_t number of registers
+    */
+    uint8_t writeRegisters(uint8_t, uint8_t, const uint8_t *, uint8_t);
+
+    /*
+    Function for releasing a slave that holds SDA low, e.g. after MCU was
+    reset in the middle of a read. SCL is clocked until SDA is released,
+    then a stop condition is generated and port is started again.
+
+    [return] : bool true if bus is idle
+    ---
+    [no-param]
+    */
+    bool recover();
+
+    /*
+    Function for moving bus to another port. Port is started on next 
+    transaction.
+
+    [no-return]
+    ---
+    [param #1] : TwoWire& I2C port
+    [param #2] : uint8_t SDA pin of port, used for recovery
+    [param #3] : uint8_t SCL pin of port, used for recovery
+    */
+    void setWire(TwoWire &, uint8_t = SDA, uint8_t = SCL);
+
+    /*
+    Function for setting transaction timeout
+
+    [no-return]
+    ---
+    [param #1] : uint16_t timeout in ms
+    */
+    void setTimeout(uint16_t);
+
+    /*
+    Function for getting I2C port of bus
+
+    [return] : TwoWire& port
+    ---
+    [no-param]
+    */
+    TwoWire &getWire();
+
+    uint16_t errors;     // failed transactions
+    uint16_t recoveries; // bus recoveries
+
+  private:
+    TwoWire *wire;
+    uint8_t sda;
+    uint8_t scl;
+    uint32_t clock;
+    uint16_t timeout;
+    bool started;
+
+    uint8_t read_once(uint8_t address, uint8_t reg, uint8_t *buffer, uint8_t len, uint16_t wait);
+    uint8_t request_once(uint8_t address, uint8_t *buffer, uint8_t len);
+    uint8_t write_once(uint8_t address, uint8_t reg, const uint8_t *buffer, uint8_t len);
+    uint8_t end_transmission(bool stop);
+    void start_port();
+};
+
+extern SixfabI2CBus sixfabI2C; // bus of sensors and SixfabNBIoT, on Wire until moved
+
+#endif
@@ -0,0 +1,227 @@
+/*
+  Sixfab_Light.cpp
+  -
+  Ambient light driver for ALS-PT19 of Sixfab Arduino NBIoT Shield.
+*/
+
+#include "Sixfab_Light.h"
+
+#if defined(SIXFAB_HAS_ADC_ISR)
+  #include <avr/sleep.h>
+
+// smallest prescaler that keeps ADC clock at most 200 kHz for full resolution,
+// 128 (125 kHz) at 16 MHz as set by Arduino core, 64 (125 kHz) at 8 MHz
+#if F_CPU / 64 > 200000L
+  #define ADC_PRESCALER (_BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0))
+#elif F_CPU / 32 > 200000L
+  #define ADC_PRESCALER (_BV(ADPS2) | _BV(ADPS1))
+#elif F_CPU / 16 > 200000L
+  #define ADC_PRESCALER (_BV(ADPS2) | _BV(ADPS0))
+#elif F_CPU / 8 > 200000L
+  #define ADC_PRESCALER (_BV(ADPS2))
+#else
+  #define ADC_PRESCALER (_BV(ADPS1) | _BV(ADPS0))
+#endif
+
+static volatile uint32_t adc_sum;
+static volatile uint16_t adc_left;
+#endif
+
+void SixfabLight::onConversion()
+{
+#if defined(SIXFAB_HAS_ADC_ISR)
+  adc_sum += ADC;
+  if(--adc_left == 0)
+    ADCSRA &= ~(_BV(ADATE) | _BV(ADIE)); // batch complete, stop free running
+#endif
+}
+
+// overridden by SIXFAB_LIGHT_ISR()
+__attribute__((weak)) bool SixfabLight::conversionLinked()
+{
+  return false;
+}
+
+SixfabLight::SixfabLight(const NBIoT_Pins &pins)
+{
+  pin = pins.als;
+  bits = LIGHT_EXTRA_BITS;
+  noise_reduction = false;
+  running = false;
+  vref_mv = LIGHT_VREF_MV;
+  curve_len = 0;
+  setSensor(LIGHT_LOAD_OHM, LIGHT_SENSITIVITY_NA);
+}
+
+void SixfabLight::setOversampling(uint8_t extra_bits)
+{
+  bits = (extra_bits < LIGHT_MAX_EXTRA_BITS) ? extra_bits : LIGHT_MAX_EXTRA_BITS;
+}
+
+uint8_t SixfabLight::getOversampling()
+{
+  return bits;
+}
+
+void SixfabLight::setNoiseReduction(bool enabled)
+{
+  noise_reduction = enabled;
+}
+
+void SixfabLight::setReference(uint16_t millivolts)
+{
+  vref_mv = millivolts;
+}
+
+// lux = V / (R * S)
+void SixfabLight::setSensor(float load_ohm, float na_per_lux)
+{
+  lux_per_mv = 1e6 / (load_ohm * na_per_lux);
+}
+
+void SixfabLight::setCurve(const NBIoT_LuxPoint *points, uint8_t count)
+{
+  curve_len = (points == NULL) ? 0 : (count < LIGHT_CURVE_LEN) ? count : LIGHT_CURVE_LEN;
+  if(curve_len)
+    memcpy(curve, points, curve_len * sizeof(NBIoT_LuxPoint));
+}
+
+// start free running batch
+bool SixfabLight::start()
+{
+  if(running && !available())
+    return false;
+
+  begin_batch(true);
+  return true;
+}
+
+bool SixfabLight::available()
+{
+#if defined(SIXFAB_HAS_ADC_ISR)
+  if(conversionLinked())
+    return running && adc_left == 0;
+#endif
+  return running;
+}
+
+bool SixfabLight::isBusy()
+{
+  return running && !available();
+}
+
+// decimated result of batch
+uint16_t SixfabLight::readRaw()
+{
+  if(!running){
+    begin_batch(!noise_reduction);
+  }
+  return wait_batch() >> bits;
+}
+
+float SixfabLight::readLux()
+{
+  return toLux(readRaw());
+}
+
+// convert to voltage, then to lux with curve or sensor model
+float SixfabLight::toLux(uint16_t raw)
+{
+  float mv = (float)raw * vref_mv / ((uint32_t)1024 << bits);
+
+  if(curve_len == 0)
+    return mv * lux_per_mv;
+  if(curve_len == 1 || mv <= curve[0].millivolts)
+    return (float)curve[0].lux * mv / (curve[0].millivolts ? curve[0].millivolts : 1);
+
+  uint8_t i = 1;
+  while(i < curve_len - 1 && mv > curve[i].millivolts)
+    i++;
+
+  // linear between points, last segment is extended
+  const NBIoT_LuxPoint &a = curve[i - 1];
+  const NBIoT_LuxPoint &b = curve[i];
+  if(b.millivolts == a.millivolts)
+    return b.lux;
+  return a.lux + ((float)b.lux - a.lux) * (mv - a.millivolts) / (b.millivolts - a.millivolts);
+}
+
+// configure ADC and start batch
+void SixfabLight::begin_batch(bool free_running)
+{
+  running = true;
+
+#if defined(SIXFAB_HAS_ADC_ISR)
+  if(!conversionLinked())
+    return; // analogRead() by wait_batch()
+
+  uint8_t channel = (pin >= A0) ? pin - A0 : pin;
+  #if defined(analogPinToChannel)
+  channel = analogPinToChannel(channel);
+  #endif
+
+  uint8_t sreg = SREG;
+  cli();
+  adc_sum = 0;
+  adc_left = (uint16_t)1 << (2 * bits);
+
+  ADMUX = _BV(REFS0) | (channel & 0x07); // AVCC reference
+  #if defined(MUX5)
+  ADCSRB = (channel & 0x08) ? _BV(MUX5) : 0; // free running trigger
+  #else
+  ADCSRB = 0; // free running trigger
+  #endif
+  #if defined(DIDR0)
+  if(channel < 8)
+    DIDR0 |= _BV(channel); // digital input buffer adds noise and current
+  #endif
+
+  if(free_running)
+    ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIF) | _BV(ADIE) | ADC_PRESCALER;
+  else
+    ADCSRA = _BV(ADEN) | _BV(ADIF) | _BV(ADIE) | ADC_PRESCALER; // started by sleep
+  SREG = sreg;
+#endif
+  (void)free_running;
+}
+
+// wait until batch is complete, return sum of conversions
+uint32_t SixfabLight::wait_batch()
+{
+  uint32_t sum = 0;
+
+#if defined(SIXFAB_HAS_ADC_ISR)
+  if(conversionLinked()){
+    if(ADCSRA & _BV(ADATE)){
+      while(adc_left)
+        ;
+    }
+    else{
+      // one conversion per noise reduction sleep, sleep is entered again
+      // if MCU is woken by another interrupt (e.g. UART) before batch completes
+      set_sleep_mode(SLEEP_MODE_ADC);
+      while(adc_left){
+        cli();
+        if(adc_left){
+          sleep_enable();
+          sei();
+          sleep_cpu();
+          sleep_disable();
+        }
+        sei();
+      }
+    }
+    uint8_t sreg = SREG;
+    cli();
+    sum = adc_sum;
+    SREG = sreg;
+    running = false;
+    return sum;
+  }
+#endif
+  for(uint16_t i = (uint16_t)1 << (2 * bits); i; i--)
+    sum += analogRead(pin);
+
+  running = false;
+  return sum;
+}
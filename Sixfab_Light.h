@@ -0,0 +1,213 @@
+/*
+  Sixfab_Light.h
+  -
+  Ambient light driver for ALS-PT19 of Sixfab Arduino NBIoT Shield.
+  Batches of 4^n conversions are summed and decimated for n extra bits of
+  resolution. On AVR, batches run in free running ADC mode from the ADC
+  interrupt, or one conversion per ADC noise reduction sleep. Voltage on
+  the load resistor is converted to lux with photocurrent sensitivity of
+  the sensor, or with a measured calibration curve.
+
+  ADC interrupt isn't linked from the library, so ADC_vect stays free for
+  other users. To run batches in background, put SIXFAB_LIGHT_ISR() once at
+  file scope of the sketch :
+
+    #include "Sixfab_Light.h"
+    SIXFAB_LIGHT_ISR()
+
+  ADC is then owned by SixfabLight while a batch runs, analogRead() and
+  other ADC_vect users must not be used meanwhile, see isBusy(). Without
+  the macro, and on other boards, blocking reads sum analogRead() values,
+  10 bit resolution is assumed.
+*/
+
+#ifndef _SIXFAB_LIGHT_H
+#define _SIXFAB_LIGHT_H
+
+#include "Sixfab_NBIoT.h"
+
+#if defined(__AVR__) && defined(ADCSRA)
+  #define SIXFAB_HAS_ADC_ISR
+  #include <avr/interrupt.h>
+  // emits ADC interrupt, once in sketch
+  #define SIXFAB_LIGHT_ISR() \
+    ISR(ADC_vect) { SixfabLight::onConversion(); } \
+    bool SixfabLight::conversionLinked() { return true; }
+#else
+  #define SIXFAB_LIGHT_ISR()
+#endif
+
+#define LIGHT_EXTRA_BITS 2 // default oversampling, 16 conversions for 12 bit result
+#define LIGHT_MAX_EXTRA_BITS 6 // 4096 conversions
+#define LIGHT_VREF_MV 5000 // AVCC reference of ADC
+#define LIGHT_LOAD_OHM 10000 // load resistor of ALS-PT19
+#define LIGHT_SENSITIVITY_NA 50 // photocurrent of ALS-PT19 per lux, nA
+#define LIGHT_CURVE_LEN 8 // max calibration points
+
+// calibration point, curve is sorted by millivolts
+typedef struct {
+  uint16_t millivolts; // voltage on load resistor
+  uint16_t lux;        // reference illuminance at that voltage
+} NBIoT_LuxPoint;
+
+class SixfabLight
+{
+  public:
+
+    /*
+    Constructor
+
+    [no-return]
+    ---
+    [param #1] : const NBIoT_Pins& peripheral pins
+    */
+    SixfabLight(const NBIoT_Pins & = NBIOT_DEFAULT_PINS);
+
+    /*
+    Function for setting oversampling, batch is 4^[param #1] conversions.
+
+    [no-return]
+    ---
+    [param #1] : uint8_t extra bits of resolution, max LIGHT_MAX_EXTRA_BITS
+    */
+    void setOversampling(uint8_t);
+
+    /*
+    Function for getting oversampling
+
+    [return] : uint8_t extra bits of resolution
+    ---
+    [no-param]
+    */
+    uint8_t getOversampling();
+
+    /*
+    Function for running blocking reads in ADC noise reduction sleep. Timer0 
+    is halted in this mode, millis() doesn't advance during conversions. 
+    Needs SIXFAB_LIGHT_ISR().
+
+    [no-return]
+    ---
+    [param #1] : bool true for noise reduction
+    */
+    void setNoiseReduction(bool);
+
+    /*
+    Function for checking if a background batch owns ADC
+
+    [return] : bool true if batch of start() is running or unread
+    ---
+    [no-param]
+    */
+    bool isBusy();
+
+    /*
+    Function for setting ADC reference voltage.
+
+    [no-return]
+    ---
+    [param #1] : uint16_t reference in mV
+    */
+    void setReference(uint16_t);
+
+    /*
+    Function for setting lux conversion of sensor model.
+
+    [no-return]
+    ---
+    [param #1] : float load resistor in ohm
+    [param #2] : float photocurrent per lux in nA
+    */
+    void setSensor(float, float);
+
+    /*
+    Function for setting measured calibration curve, used instead of sensor model.
+    Points are copied.
+
+    [no-return]
+    ---
+    [param #1] : const NBIoT_LuxPoint* points sorted by millivolts, NULL to use sensor model
+    [param #2] : uint8_t number of points, max LIGHT_CURVE_LEN
+    */
+    void setCurve(const NBIoT_LuxPoint *, uint8_t);
+
+    /*
+    Function for starting a batch in background.
+
+    [return] : bool false if a batch is already running
+    ---
+    [no-param]
+    */
+    bool start();
+
+    /*
+    Function for checking if batch of start() is finished
+
+    [return] : bool true if result is ready
+    ---
+    [no-param]
+    */
+    bool available();
+
+    /*
+    Function for getting decimated result of finished batch, starting and
+    waiting for a batch if none is running.
+
+    [return] : uint16_t ADC value with 10 + extra bits of resolution
+    ---
+    [no-param]
+    */
+    uint16_t readRaw();
+
+    /*
+    Function for reading illuminance
+
+    [return] : float lux
+    ---
+    [no-param]
+    */
+    float readLux();
+
+    /*
+    Function for converting decimated ADC value to lux
+
+    [return] : float lux
+    ---
+    [param #1] : uint16_t ADC value of readRaw()
+    */
+    float toLux(uint16_t);
+
+    /*
+    Function for adding a conversion to batch, called from SIXFAB_LIGHT_ISR()
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    static void onConversion();
+
+    /*
+    Function for checking if SIXFAB_LIGHT_ISR() is in sketch. Defined weak
+    by library, the macro overrides it.
+
+    [return] : bool true if ADC interrupt is linked
+    ---
+    [no-param]
+    */
+    static bool conversionLinked();
+
+  private:
+    uint8_t pin;
+    uint8_t bits;
+    bool noise_reduction;
+    bool running;
+    uint16_t vref_mv;
+    float lux_per_mv;
+    NBIoT_LuxPoint curve[LIGHT_CURVE_LEN];
+    uint8_t curve_len;
+
+    void begin_batch(bool free_running);
+    uint32_t wait_batch();
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*
+  Sixfab_Log.cpp
+  -
+  Leveled debug logging of Sixfab NBIoT library.
+*/
+
+#include "Sixfab_Log.h"
+
+SixfabLog sixfabLog;
+
+static const char level_chars[] PROGMEM = "-EWIDT";
+
+SixfabLog::SixfabLog()
+{
+  sink = NULL;
+  level = SIXFAB_LOG_LEVEL;
+  head = tail = 0;
+  dropped = 0;
+}
+
+// set debug output
+void SixfabLog::begin(Print &output)
+{
+  sink = &output;
+}
+
+// set run time log level
+void SixfabLog::setLevel(uint8_t new_level)
+{
+  level = (new_level < SIXFAB_LOG_LEVEL) ? new_level : SIXFAB_LOG_LEVEL;
+}
+
+uint8_t SixfabLog::getLevel()
+{
+  return level;
+}
+
+// format "[L] TAG: message\r\n" into buffer
+void SixfabLog::write(uint8_t message_level, const __FlashStringHelper *tag, const __FlashStringHelper *format, ...)
+{
+  char line[LOG_LINE_LEN];
+  uint8_t len;
+  va_list args;
+
+  if(sink == NULL || message_level > level)
+    return;
+
+  line[0] = '[';
+  line[1] = pgm_read_byte(&level_chars[message_level <= LOG_LEVEL_TRACE ? message_level : 0]);
+  line[2] = ']';
+  line[3] = ' ';
+  len = 4;
+
+  strncpy_P(line + len, (PGM_P)tag, sizeof(line) - len - 1);
+  line[sizeof(line) - 1] = '\0';
+  len = strlen(line);
+  if(len < sizeof(line) - 3){
+    line[len++] = ':';
+    line[len++] = ' ';
+  }
+
+  va_start(args, format);
+#if defined(__AVR__)
+  vsnprintf_P(line + len, sizeof(line) - len, (PGM_P)format, args);
+#else
+  vsnprintf(line + len, sizeof(line) - len, (const char *)format, args);
+#endif
+  va_end(args);
+  len = strlen(line);
+
+  if(room() < len + 2u){
+    dropped += len + 2;
+    return;
+  }
+  for(uint8_t i = 0; i < len; i++)
+    push(line[i]);
+  push('\r');
+  push('\n');
+}
+
+// put raw byte into buffer at trace level
+void SixfabLog::put(char c)
+{
+  if(sink == NULL || level < LOG_LEVEL_TRACE)
+    return;
+  push(c);
+}
+
+// put byte into ring buffer
+void SixfabLog::push(char c)
+{
+  if(room() == 0){
+    dropped++;
+    return;
+  }
+  buffer[head] = c;
+  head = (head + 1) % LOG_BUFFER_LEN;
+}
+
+// write buffered bytes to debug output
+void SixfabLog::drain(uint16_t max)
+{
+  if(sink == NULL)
+    return;
+
+  // outputs with a transmit buffer report free space. others (e.g. SoftwareSerial) 
+  // report 0 and block with interrupts off on every byte, so only a few 
+  // bytes are written per call, rest is left to flush() while idle
+  int space = sink->availableForWrite();
+  if(space <= 0)
+    space = LOG_UNBUFFERED_LEN;
+
+  while(max-- && space-- && tail != head){
+    sink->write((uint8_t)buffer[tail]);
+    tail = (tail + 1) % LOG_BUFFER_LEN;
+  }
+}
+
+// write all buffered bytes, blocks until done
+void SixfabLog::flush()
+{
+  if(sink == NULL)
+    return;
+
+  while(tail != head){
+    sink->write((uint8_t)buffer[tail]);
+    tail = (tail + 1) % LOG_BUFFER_LEN;
+  }
+}
+
+// number of buffered bytes
+uint16_t SixfabLog::pending()
+{
+  return (head + LOG_BUFFER_LEN - tail) % LOG_BUFFER_LEN;
+}
+
+// free space in ring buffer, one slot is kept empty
+uint16_t SixfabLog::room()
+{
+  return LOG_BUFFER_LEN - 1 - pending();
+}
@@ -0,0 +1,176 @@
+/*
+  Sixfab_Log.h
+  -
+  Leveled debug logging of Sixfab NBIoT library.
+  -
+  Messages above SIXFAB_LOG_LEVEL are removed at compile time, level of 
+  remaining ones can be lowered at run time with setLevel(). Library 
+  sources don't see defines of the sketch, so SIXFAB_LOG_LEVEL must be 
+  given as a build flag, e.g. with arduino-cli :
+
+    --build-property "compiler.cpp.extra_flags=-DSIXFAB_LOG_LEVEL=4"
+
+  Format strings and tags are kept in flash. Formatted lines are put in a 
+  small ring buffer and written to the debug output only when drain() is 
+  called, so buffered outputs don't block while modem is talking. With an 
+  unbuffered output like SoftwareSerial, sketch should call flush() while 
+  idle, library writes only a few bytes per command.
+*/
+
+#ifndef _SIXFAB_LOG_H
+#define _SIXFAB_LOG_H
+
+#include <Arduino.h>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_TRACE 5 // raw modem output
+
+// compile time log level, -DSIXFAB_LOG_LEVEL=<level> build flag
+#ifndef SIXFAB_LOG_LEVEL
+  #define SIXFAB_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_BUFFER_LEN
+  #define LOG_BUFFER_LEN 128 // ring buffer size, power of 2
+#endif
+#define LOG_LINE_LEN 64 // max length of a formatted line
+#ifndef LOG_UNBUFFERED_LEN
+  #define LOG_UNBUFFERED_LEN 8 // bytes per drain() to outputs without transmit buffer, ~8 ms at 9600 baud
+#endif
+
+class SixfabLog
+{
+  public:
+    SixfabLog();
+
+    /*
+    Function for setting debug output that buffer is drained to.
+
+    [no-return]
+    ---
+    [param #1] : Print& debug output
+    */
+    void begin(Print &);
+
+    /*
+    Function for setting run time log level. Messages above it are dropped, 
+    it can't raise level above SIXFAB_LOG_LEVEL.
+
+    [no-return]
+    ---
+    [param #1] : uint8_t LOG_LEVEL_* 
+    */
+    void setLevel(uint8_t);
+
+    /*
+    Function for getting run time log level.
+
+    [return] : uint8_t LOG_LEVEL_*
+    ---
+    [no-param]
+    */
+    uint8_t getLevel();
+
+    /*
+    Function for formatting a line into buffer. Whole line is dropped if 
+    there is no room. Use LOG_* macros instead of calling this directly.
+
+    [no-return]
+    ---
+    [param #1] : uint8_t LOG_LEVEL_* of message
+    [param #2] : const __FlashStringHelper* module tag in flash
+    [param #3] : const __FlashStringHelper* printf format in flash
+    */
+    void write(uint8_t, const __FlashStringHelper *, const __FlashStringHelper *, ...);
+
+    /*
+    Function for putting a raw byte into buffer, if run time level is 
+    LOG_LEVEL_TRACE.
+
+    [no-return]
+    ---
+    [param #1] : char byte
+    */
+    void put(char);
+
+    /*
+    Function for writing buffered bytes to debug output. Writes as many 
+    bytes as output has room in its transmit buffer without blocking. 
+    Outputs that report no room (e.g. SoftwareSerial, which has no transmit 
+    buffer) are written only LOG_UNBUFFERED_LEN bytes, blocking. Call 
+    flush() while idle to write the rest.
+
+    [no-return]
+    ---
+    [param #1] : uint16_t max number of bytes to write
+    */
+    void drain(uint16_t max = LOG_BUFFER_LEN);
+
+    /*
+    Function for writing all buffered bytes to debug output, blocks until done.
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void flush();
+
+    /*
+    Function for getting number of bytes waiting in buffer.
+
+    [return] : uint16_t buffered bytes
+    ---
+    [no-param]
+    */
+    uint16_t pending();
+
+    uint16_t dropped; // bytes lost because buffer was full
+
+  private:
+    Print *sink;
+    uint8_t level;
+    char buffer[LOG_BUFFER_LEN];
+    uint16_t head;
+    uint16_t tail;
+
+    uint16_t room();
+    void push(char);
+};
+
+extern SixfabLog sixfabLog;
+
+#if SIXFAB_LOG_LEVEL >= LOG_LEVEL_ERROR
+  #define LOG_ERROR(tag, format, ...) sixfabLog.write(LOG_LEVEL_ERROR, F(tag), F(format), ##__VA_ARGS__)
+#else
+  #define LOG_ERROR(tag, format, ...) do {} while(0)
+#endif
+
+#if SIXFAB_LOG_LEVEL >= LOG_LEVEL_WARN
+  #define LOG_WARN(tag, format, ...) sixfabLog.write(LOG_LEVEL_WARN, F(tag), F(format), ##__VA_ARGS__)
+#else
+  #define LOG_WARN(tag, format, ...) do {} while(0)
+#endif
+
+#if SIXFAB_LOG_LEVEL >= LOG_LEVEL_INFO
+  #define LOG_INFO(tag, format, ...) sixfabLog.write(LOG_LEVEL_INFO, F(tag), F(format), ##__VA_ARGS__)
+#else
+  #define LOG_INFO(tag, format, ...) do {} while(0)
+#endif
+
+#if SIXFAB_LOG_LEVEL >= LOG_LEVEL_DEBUG
+  #define LOG_DEBUG(tag, format, ...) sixfabLog.write(LOG_LEVEL_DEBUG, F(tag), F(format), ##__VA_ARGS__)
+#else
+  #define LOG_DEBUG(tag, format, ...) do {} while(0)
+#endif
+
+#if SIXFAB_LOG_LEVEL >= LOG_LEVEL_TRACE
+  #define LOG_RAW(c) sixfabLog.put(c)
+#else
+  #define LOG_RAW(c) do {} while(0)
+#endif
+
+#endif
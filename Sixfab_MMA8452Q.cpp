@@ -2,15 +2,16 @@
 #include <Arduino.h> 
 #include <Wire.h>
 
-MMA8452Q::MMA8452Q(byte addr)
+MMA8452Q::MMA8452Q(byte addr, SixfabI2CBus &i2c)
 {
     address = addr;
+    bus = &i2c;
 }
 
 byte MMA8452Q::init(MMA8452Q_Scale fsr, MMA8452Q_ODR odr) {
   scale = fsr; // Haul fsr into our class variable, scale
 
-  Wire.begin(); // Initialize I2C
+  bus->begin(); // Initialize I2C, once for all sensors
 
   byte c = readRegister(WHO_AM_I); // Read WHO_AM_I register
 
@@ -19,16 +20,17 @@ byte MMA8452Q::init(MMA8452Q_Scale fsr, MMA8452Q_ODR odr) {
     return 0;
   }
 
-  standby(); // Must be in standby to change registers
+  if (!loadShadow()) // Start from registers on device, unchanged ones aren't written
+    return 0;
+
   setScale(scale); // Set up accelerometer scale
   setODR(odr); // Set up output data rate
   setupPL(); // Set up portrait/landscape detection
   // Multiply parameter by 0.0625g to calculate threshold.
   setupTap(0x80, 0x80, 0x08); // Disable x, y, set z to 0.5g
+  modify(CTRL_REG1, 0x01, 0x01); // Set to active to start reading
 
-  active(); // Set to active to start reading
-
-  return 1;
+  return apply(); // Standby, write changed registers, active
 }
 
 void MMA8452Q::read() {
@@ -44,43 +46,111 @@ void MMA8452Q::read() {
   cz = (float) z / (float)(1 << 11) * (float)(scale);
 }
 
+// READ ACCELERATION IN MILLI-G
+//	Integer only, 12 bit counts are scaled by full scale range.
+byte MMA8452Q::readMilliG(int16_t *mg) {
+  byte rawData[6];
+
+  if (bus->readRegisters(address, OUT_X_MSB, rawData, 6) != I2C_OK)
+    return 0;
+
+  for (byte i = 0; i < 3; i++) {
+    int16_t counts = (int16_t)(rawData[2 * i] << 8 | rawData[2 * i + 1]) >> 4;
+    mg[i] = (int32_t)counts * scale * 1000 >> 11;
+  }
+  return 1;
+}
+
 byte MMA8452Q::available() {
   return (readRegister(STATUS) & 0x08) >> 3;
 }
 
 void MMA8452Q::setScale(MMA8452Q_Scale fsr) {
-  byte cfg = readRegister(XYZ_DATA_CFG);
-  cfg &= 0xFC;
-  cfg |= (fsr >> 2);
-  writeRegister(XYZ_DATA_CFG, cfg);
+  scale = fsr;
+  modify(XYZ_DATA_CFG, 0x03, fsr >> 2);
 }
 
 void MMA8452Q::setODR(MMA8452Q_ODR odr) {
-  byte ctrl = readRegister(CTRL_REG1);
-  ctrl &= 0xCF;
-  ctrl |= (odr << 3);
-  writeRegister(CTRL_REG1, ctrl);
+  modify(CTRL_REG1, 0x38, odr << 3);
+}
+
+// Writable runs of shadow, read-only and reserved registers are never written
+static const byte writable[][2] = {
+  {XYZ_DATA_CFG, HP_FILTER_CUTOFF},
+  {PL_CFG, PL_COUNT},
+  {FF_MT_CFG, FF_MT_CFG},
+  {FF_MT_THS, FF_MT_COUNT},
+  {TRANSIENT_CFG, TRANSIENT_CFG},
+  {TRANSIENT_THS, PULSE_CFG},
+  {PULSE_THSX, ASLP_COUNT},
+  {CTRL_REG2, OFF_Z} // CTRL_REG1 is written last
+};
+
+// APPLY CONFIGURATION
+//	Registers can only be changed in standby. Changed registers of each
+//	run are sent in one burst, registers that are already set are skipped.
+byte MMA8452Q::apply() {
+  byte target = shadow[CTRL_REG1 - MMA8452Q_SHADOW_FIRST];
+  byte ok = 1;
+  byte changed = 0;
+
+  for (byte i = 0; i < sizeof(dirty); i++)
+    changed |= dirty[i];
+  if (!changed)
+    return 1;
+
+  if (ctrl1 & 0x01) {
+    byte standby = ctrl1 & ~0x01; // Clear the active bit to go into standby
+    if (writeRegisters(CTRL_REG1, &standby, 1) != I2C_OK)
+      return 0;
+    ctrl1 = standby;
+  }
+
+  for (byte i = 0; i < sizeof(writable) / sizeof(writable[0]); i++) {
+    byte first = writable[i][0];
+    byte last = writable[i][1];
+    while (first <= last && !isDirty(first))
+      first++;
+    while (last > first && !isDirty(last))
+      last--;
+    if (first > last)
+      continue;
+
+    if (writeRegisters((MMA8452Q_Register)first, &shadow[first - MMA8452Q_SHADOW_FIRST], last - first + 1) == I2C_OK)
+      clean(first, last);
+    else
+      ok = 0; // kept dirty for next apply()
+  }
+
+  if (writeRegisters(CTRL_REG1, &target, 1) == I2C_OK) {
+    ctrl1 = target;
+    clean(CTRL_REG1, CTRL_REG1);
+  }
+  else
+    ok = 0;
+
+  return ok;
 }
 
 void MMA8452Q::setupTap(byte xThs, byte yThs, byte zThs) {
   byte temp = 0;
   if (!(xThs & 0x80)) {
     temp |= 0x3; // Enable taps on x
-    writeRegister(PULSE_THSX, xThs); // x thresh
+    modify(PULSE_THSX, 0xFF, xThs); // x thresh
   }
   if (!(yThs & 0x80)) {
     temp |= 0xC; // Enable taps on y
-    writeRegister(PULSE_THSY, yThs); // y thresh
+    modify(PULSE_THSY, 0xFF, yThs); // y thresh
   }
   if (!(zThs & 0x80)) {
     temp |= 0x30; // Enable taps on z
-    writeRegister(PULSE_THSZ, zThs); // z thresh
+    modify(PULSE_THSZ, 0xFF, zThs); // z thresh
   }
 
-  writeRegister(PULSE_CFG, temp | 0x40);
-  writeRegister(PULSE_TMLT, 0x30);
-  writeRegister(PULSE_LTCY, 0xA0);
-  writeRegister(PULSE_WIND, 0xFF);
+  modify(PULSE_CFG, 0xFF, temp | 0x40);
+  modify(PULSE_TMLT, 0xFF, 0x30);
+  modify(PULSE_LTCY, 0xFF, 0xA0);
+  modify(PULSE_WIND, 0xFF, 0xFF);
 }
 
 byte MMA8452Q::readTap() {
@@ -92,10 +162,36 @@ byte MMA8452Q::readTap() {
     return 0;
 }
 
+// SET UP FREEFALL/MOTION
+//	Freefall : all axes below threshold. Motion : any axis above threshold.
+void MMA8452Q::setupFreefall(byte ths, byte count, bool motion) {
+  modify(FF_MT_CFG, 0xFF, 0xB8 | (motion ? 0x40 : 0)); // ELE, x, y, z enabled
+  modify(FF_MT_THS, 0xFF, ths & 0x7F);
+  modify(FF_MT_COUNT, 0xFF, count);
+}
+
+// Axis flags are only set in motion mode, so EA bit is kept
+byte MMA8452Q::readFreefall() {
+  byte ffStat = readRegister(FF_MT_SRC); // Reading clears the interrupt
+  if (ffStat & 0x80) // Read EA bit to check if a interrupt was generated
+    return ffStat & 0xBF;
+  else
+    return 0;
+}
+
+void MMA8452Q::setInterrupts(byte enable, byte int1) {
+  modify(CTRL_REG4, 0xFF, enable);
+  modify(CTRL_REG5, 0xFF, int1);
+}
+
+byte MMA8452Q::readSource() {
+  return readRegister(INT_SOURCE);
+}
+
 void MMA8452Q::setupPL() {
 
-  writeRegister(PL_CFG, readRegister(PL_CFG) | 0x40);
-  writeRegister(PL_COUNT, 0x50);
+  modify(PL_CFG, 0x40, 0x40);
+  modify(PL_COUNT, 0xFF, 0x50);
 }
 
 byte MMA8452Q::readPL() {
@@ -107,16 +203,40 @@ byte MMA8452Q::readPL() {
     return (plStat & 0x6) >> 1;
 }
 
-void MMA8452Q::standby() {
-  byte c = readRegister(CTRL_REG1);
-  writeRegister(CTRL_REG1, c & ~(0x01)); //Clear the active bit to go into standby
+// LOAD SHADOW
+//	Reads configuration registers of device, in two bursts that fit Wire buffer.
+byte MMA8452Q::loadShadow() {
+  const byte half = MMA8452Q_SHADOW_LEN / 2;
+
+  memset(dirty, 0, sizeof(dirty));
+  if (bus->readRegisters(address, MMA8452Q_SHADOW_FIRST, shadow, half) != I2C_OK ||
+      bus->readRegisters(address, MMA8452Q_SHADOW_FIRST + half, shadow + half, MMA8452Q_SHADOW_LEN - half) != I2C_OK)
+    return 0;
+
+  ctrl1 = shadow[CTRL_REG1 - MMA8452Q_SHADOW_FIRST];
+  return 1;
+}
+
+// MODIFY SHADOW REGISTER
+//	Changes masked bits, register is marked for apply() only if value changes.
+void MMA8452Q::modify(MMA8452Q_Register reg, byte mask, byte value) {
+  byte i = reg - MMA8452Q_SHADOW_FIRST;
+  byte next = (shadow[i] & ~mask) | (value & mask);
+
+  if (next != shadow[i]) {
+    shadow[i] = next;
+    dirty[i >> 3] |= 1 << (i & 7);
+  }
+}
+
+bool MMA8452Q::isDirty(byte reg) {
+  byte i = reg - MMA8452Q_SHADOW_FIRST;
+  return dirty[i >> 3] & (1 << (i & 7));
 }
 
-// SET ACTIVE MODE
-//	Sets the MMA8452 to active mode. Needs to be in this mode to output data
-void MMA8452Q::active() {
-  byte c = readRegister(CTRL_REG1);
-  writeRegister(CTRL_REG1, c | 0x01); //Set the active bit to begin detection
+void MMA8452Q::clean(byte first, byte last) {
+  for (byte i = first - MMA8452Q_SHADOW_FIRST; i <= last - MMA8452Q_SHADOW_FIRST; i++)
+    dirty[i >> 3] &= ~(1 << (i & 7));
 }
 
 // WRITE A SINGLE REGISTER
@@ -125,29 +245,19 @@ void MMA8452Q::writeRegister(MMA8452Q_Register reg, byte data) {
   writeRegisters(reg, & data, 1);
 }
 
-void MMA8452Q::writeRegisters(MMA8452Q_Register reg, byte * buffer, byte len) {
-  Wire.beginTransmission(address);
-  Wire.write(reg);
-  for (int x = 0; x < len; x++)
-    Wire.write(buffer[x]);
-  Wire.endTransmission();
+byte MMA8452Q::writeRegisters(MMA8452Q_Register reg, const byte * buffer, byte len) {
+  return bus->writeRegisters(address, reg, buffer, len);
 }
 
+// failed read gives 0, WHO_AM_I check of init() fails
 byte MMA8452Q::readRegister(MMA8452Q_Register reg) {
-  Wire.beginTransmission(address);
-  Wire.write(reg);
-  Wire.endTransmission(false);
-  Wire.requestFrom(address, (byte) 1);
-  while (!Wire.available());
-  return Wire.read();
+  byte data = 0;
+  readRegisters(reg, &data, 1);
+  return data;
 }
 
+// burst read with repeated start, buffer is cleared if bus fails
 void MMA8452Q::readRegisters(MMA8452Q_Register reg, byte * buffer, byte len) {
-  Wire.beginTransmission(address);
-  Wire.write(reg);
-  Wire.endTransmission(false);
-  Wire.requestFrom(address, len);
-  while (Wire.available() < len);
-  for (int x = 0; x < len; x++)
-    buffer[x] = Wire.read();
+  if (bus->readRegisters(address, reg, buffer, len) != I2C_OK)
+    memset(buffer, 0, len);
 }
@@ -2,6 +2,8 @@
 #define SIXFAB_MMA8452Q_h
 
 #include <Arduino.h>
+#include <Wire.h>
+#include "Sixfab_I2CBus.h"
 
 enum MMA8452Q_Register {
 	STATUS = 0x00,
@@ -71,34 +73,60 @@ enum MMA8452Q_ODR {
 #define LANDSCAPE_L 3
 #define LOCKOUT 0x40
 
+// Interrupt sources, bits of INT_SOURCE, CTRL_REG4 and CTRL_REG5
+#define MMA8452Q_INT_DRDY 0x01
+#define MMA8452Q_INT_FF_MT 0x04
+#define MMA8452Q_INT_PULSE 0x08
+#define MMA8452Q_INT_LNDPRT 0x10
+#define MMA8452Q_INT_TRANS 0x20
+#define MMA8452Q_INT_ASLP 0x80
+
+// Shadowed configuration registers, XYZ_DATA_CFG to OFF_Z
+#define MMA8452Q_SHADOW_FIRST XYZ_DATA_CFG
+#define MMA8452Q_SHADOW_LEN (OFF_Z - XYZ_DATA_CFG + 1)
+
 	// MMA8452Q Class Declaration //
 
 class MMA8452Q
 {
 public:	
 	   
-	MMA8452Q(byte addr=0x1C); // Constructor
+	MMA8452Q(byte addr=0x1C, SixfabI2CBus &bus=sixfabI2C); // Constructor
 	
 	byte init(MMA8452Q_Scale fsr = SCALE_2G, MMA8452Q_ODR odr = ODR_800);
     	void read();
+	byte readMilliG(int16_t *mg); // x, y, z in mg in one burst, 0 on bus error
 	byte available();
 	byte readTap();
 	byte readPL();
+	byte readFreefall(); // FF_MT_SRC with EA bit 0x80, 0 if no event
+	byte readSource(); // MMA8452Q_INT_* flags of pending interrupts
+	
+	// Configuration is staged in shadow registers and written by apply()
+	void setScale(MMA8452Q_Scale fsr);
+	void setODR(MMA8452Q_ODR odr);
+	void setupTap(byte xThs, byte yThs, byte zThs); // 0.063g steps, bit 7 disables axis
+	void setupFreefall(byte ths, byte count, bool motion); // 0.063g steps, count in ODR periods
+	void setInterrupts(byte enable, byte int1); // MMA8452Q_INT_* flags, int1 routed to INT1 else INT2
+	byte apply(); // standby, burst write of changed registers, active
 	
     	int x, y, z;
 	float cx, cy, cz;
 private:
 	byte address;
+	SixfabI2CBus *bus;
 	MMA8452Q_Scale scale;
+	byte shadow[MMA8452Q_SHADOW_LEN]; // staged configuration registers
+	byte dirty[(MMA8452Q_SHADOW_LEN + 7) / 8]; // shadow registers not yet written
+	byte ctrl1; // CTRL_REG1 on device
 	
-	void standby();
-	void active();
 	void setupPL();
-	void setupTap(byte xThs, byte yThs, byte zThs);
-	void setScale(MMA8452Q_Scale fsr);
-	void setODR(MMA8452Q_ODR odr);
+	byte loadShadow();
+	void modify(MMA8452Q_Register reg, byte mask, byte value);
+	bool isDirty(byte reg);
+	void clean(byte first, byte last);
 	void writeRegister(MMA8452Q_Register reg, byte data);
-    	void writeRegisters(MMA8452Q_Register reg, byte *buffer, byte len);
+    	byte writeRegisters(MMA8452Q_Register reg, const byte *buffer, byte len);
 	byte readRegister(MMA8452Q_Register reg);
     	void readRegisters(MMA8452Q_Register reg, byte *buffer, byte len);
 };
@@ -0,0 +1,113 @@
+/*
+  Sixfab_Motion.cpp
+  -
+  Accelerometer events of Sixfab Arduino NBIoT Shield.
+*/
+
+#include "Sixfab_Motion.h"
+#include "Sixfab_Time.h"
+
+#define PULSE_DOUBLE 0x08 // DPE flag of PULSE_SRC
+
+SixfabMotion::SixfabMotion(MMA8452Q &mma, SixfabTime *clock)
+  : accel(mma), time(clock)
+{
+  pin = MOTION_NO_PIN;
+  motion = false;
+  event_head = event_count = 0;
+  dropped = 0;
+}
+
+// enable engines and route their interrupts to INT1
+bool SixfabMotion::begin(uint8_t int_pin, uint8_t sources, bool motion_mode)
+{
+  pin = int_pin;
+  motion = motion_mode;
+
+  if(pin != MOTION_NO_PIN)
+    pinMode(pin, INPUT); // push-pull, active low
+
+  if(sources & MMA8452Q_INT_FF_MT)
+    accel.setupFreefall(MOTION_FREEFALL_THS, MOTION_FREEFALL_COUNT, motion);
+  accel.setInterrupts(sources, sources);
+  return accel.apply();
+}
+
+// read sources of pending interrupts, reading source registers clears them
+void SixfabMotion::poll()
+{
+  if(pin != MOTION_NO_PIN && digitalRead(pin) == HIGH)
+    return; // no interrupt, bus isn't touched
+
+  uint8_t source = accel.readSource();
+  uint32_t stamp = now();
+
+  if(source & MMA8452Q_INT_PULSE){
+    uint8_t tap = accel.readTap();
+    if(tap)
+      push((tap & PULSE_DOUBLE) ? MOTION_DOUBLE_TAP : MOTION_TAP, tap, stamp);
+  }
+  if(source & MMA8452Q_INT_FF_MT){
+    uint8_t ff = accel.readFreefall();
+    if(ff)
+      push(motion ? MOTION_MOVE : MOTION_FREEFALL, ff & 0x3F, stamp);
+  }
+  if(source & MMA8452Q_INT_LNDPRT)
+    push(MOTION_ORIENTATION, accel.readPL(), stamp);
+}
+
+bool SixfabMotion::read(NBIoT_MotionEvent *event)
+{
+  if(event_count == 0)
+    return false;
+
+  *event = events[event_head];
+  event_head = (event_head + 1) % MOTION_EVENT_COUNT;
+  event_count--;
+  return true;
+}
+
+// drain events into type, detail, age records
+uint8_t SixfabMotion::pack(uint8_t *buffer, uint8_t size)
+{
+  uint32_t packed = now();
+  uint8_t len = 0;
+  NBIoT_MotionEvent event;
+
+  while(len + MOTION_RECORD_LEN <= size && read(&event)){
+    uint32_t age = (packed - event.time) / 1000;
+    if(age > 0xFFFF)
+      age = 0xFFFF;
+
+    buffer[len++] = event.type;
+    buffer[len++] = event.detail;
+    buffer[len++] = age >> 8;
+    buffer[len++] = age;
+  }
+  return len;
+}
+
+uint8_t SixfabMotion::available()
+{
+  return event_count;
+}
+
+void SixfabMotion::push(uint8_t type, uint8_t detail, uint32_t stamp)
+{
+  if(event_count == MOTION_EVENT_COUNT){
+    dropped++;
+    return;
+  }
+
+  NBIoT_MotionEvent &event = events[(event_head + event_count) % MOTION_EVENT_COUNT];
+  event.type = type;
+  event.detail = detail;
+  event.time = stamp;
+  event_count++;
+}
+
+// stamp of events, counts sleep if time service is given
+uint32_t SixfabMotion::now()
+{
+  return time ? time->monotonic() : millis();
+}
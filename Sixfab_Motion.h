@@ -0,0 +1,128 @@
+/*
+  Sixfab_Motion.h
+  -
+  Accelerometer events of Sixfab Arduino NBIoT Shield.
+  Embedded pulse, freefall/motion and portrait/landscape engines of
+  MMA8452Q detect events on the device and route them to its INT1 pin.
+  poll() reads their source registers only while an interrupt is pending,
+  turns them into timestamped events and queues them until read() or
+  pack(). A node that sends only packed event records, e.g. through
+  SixfabUplinkScheduler, doesn't have to stream samples.
+
+  If the INT1 pin of accelerometer isn't connected, pass MOTION_NO_PIN
+  and INT_SOURCE is read on every poll().
+
+  Events are stamped with SixfabTime::monotonic() if a time service is
+  given, so ages given by pack() keep counting over power down sleep
+  reported with SixfabTime::addSleep(). Without it millis() is used.
+*/
+
+#ifndef _SIXFAB_MOTION_H
+#define _SIXFAB_MOTION_H
+
+#include "Sixfab_NBIoT.h"
+
+#define MOTION_NO_PIN 0xFF
+#define MOTION_EVENT_COUNT 8 // events waiting for read() or pack()
+#define MOTION_RECORD_LEN 4 // bytes of a packed event
+#define MOTION_FREEFALL_THS 3 // 0.19 g on all axes
+#define MOTION_FREEFALL_COUNT 80 // 100 ms at ODR_800
+#define MOTION_SOURCES (MMA8452Q_INT_PULSE | MMA8452Q_INT_FF_MT | MMA8452Q_INT_LNDPRT)
+
+enum NBIoT_MotionEventType {
+  MOTION_TAP = 1,     // detail : PULSE_SRC axis and polarity flags
+  MOTION_DOUBLE_TAP,  // detail : PULSE_SRC axis and polarity flags
+  MOTION_FREEFALL,    // detail : FF_MT_SRC axis flags
+  MOTION_MOVE,        // freefall engine in motion mode, detail : FF_MT_SRC axis flags
+  MOTION_ORIENTATION  // detail : PORTRAIT_U .. LANDSCAPE_L or LOCKOUT
+};
+
+typedef struct {
+  uint8_t type;   // NBIoT_MotionEventType
+  uint8_t detail;
+  uint32_t time;  // SixfabTime::monotonic(), or millis(), of poll() that found event
+} NBIoT_MotionEvent;
+
+class SixfabMotion
+{
+  public:
+
+    /*
+    Constructor
+
+    [no-return]
+    ---
+    [param #1] : MMA8452Q& initialized accelerometer, e.g. node.getAccel()
+    [param #2] : SixfabTime* stamp source, NULL for millis()
+    */
+    SixfabMotion(MMA8452Q &, SixfabTime * = NULL);
+
+    /*
+    Function for enabling event engines and their interrupts. Pulse and
+    portrait/landscape engines are set up by MMA8452Q::init(), freefall
+    engine is set to MOTION_FREEFALL_* thresholds. Thresholds can be changed
+    with MMA8452Q::setupFreefall() and apply() afterwards, in same mode.
+
+    [return] : bool false if accelerometer isn't answering
+    ---
+    [param #1] : uint8_t pin connected to INT1 of accelerometer, MOTION_NO_PIN if none
+    [param #2] : uint8_t MMA8452Q_INT_* sources, default MOTION_SOURCES
+    [param #3] : bool true if freefall engine is in motion mode
+    */
+    bool begin(uint8_t = MOTION_NO_PIN, uint8_t = MOTION_SOURCES, bool = false);
+
+    /*
+    Function for collecting events of pending interrupts. Should be called
+    from loop().
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void poll();
+
+    /*
+    Function for getting next event
+
+    [return] : bool false if no event is waiting
+    ---
+    [param #1] : NBIoT_MotionEvent* output
+    */
+    bool read(NBIoT_MotionEvent *);
+
+    /*
+    Function for moving waiting events into uplink records. Each record is
+    type, detail and big endian uint16_t age in seconds at packing time.
+
+    [return] : uint8_t bytes written, a multiple of MOTION_RECORD_LEN
+    ---
+    [param #1] : uint8_t* output
+    [param #2] : uint8_t size of output
+    */
+    uint8_t pack(uint8_t *, uint8_t);
+
+    /*
+    Function for getting number of waiting events
+
+    [return] : uint8_t number of events
+    ---
+    [no-param]
+    */
+    uint8_t available();
+
+    uint16_t dropped; // events lost because queue was full
+
+  private:
+    MMA8452Q &accel;
+    SixfabTime *time;
+    uint8_t pin;
+    bool motion;
+    NBIoT_MotionEvent events[MOTION_EVENT_COUNT];
+    uint8_t event_head;
+    uint8_t event_count;
+
+    void push(uint8_t type, uint8_t detail, uint32_t stamp);
+    uint32_t now();
+};
+
+#endif
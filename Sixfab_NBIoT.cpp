@@ -7,16 +7,180 @@
 */
 
 #include "Sixfab_NBIoT.h"
+#include "Sixfab_Time.h"
+#include "Sixfab_Light.h"
 
-Sixfab_HDC1080 hdc1080;
-MMA8452Q accel; // I2C Address : 0x1C
+// overridden by SIXFAB_DEBUG_SERIAL()
+__attribute__((weak)) Print *debugSerial(uint32_t baud)
+{
+#if defined(DEBUG)
+  if(baud)
+    DEBUG.begin(baud);
+  return &DEBUG;
+#else
+  (void)baud;
+  return NULL; // SoftwareSerial isn't linked
+#endif
+}
+
+// AT command set, kept in flash. same order with NBIoT_Command
+static const char cmd_at[] PROGMEM = "AT";
+static const char cmd_ate1[] PROGMEM = "ATE1";
+static const char cmd_at_w[] PROGMEM = "AT&W";
+static const char cmd_cgsn[] PROGMEM = "AT+CGSN";
+static const char cmd_cgmr[] PROGMEM = "AT+CGMR";
+static const char cmd_cgmm[] PROGMEM = "AT+CGMM";
+static const char cmd_nconfig_read[] PROGMEM = "AT+NCONFIG?";
+static const char cmd_csq[] PROGMEM = "AT+CSQ";
+static const char cmd_nuestats[] PROGMEM = "AT+NUESTATS";
+static const char cmd_nuestats_cell[] PROGMEM = "AT+NUESTATS=CELL";
+static const char cmd_cereg_on[] PROGMEM = "AT+CEREG=1";
+static const char cmd_cereg_read[] PROGMEM = "AT+CEREG?";
+static const char cmd_cops_auto[] PROGMEM = "AT+COPS=0";
+static const char cmd_cops_read[] PROGMEM = "AT+COPS?";
+static const char cmd_cgatt_on[] PROGMEM = "AT+CGATT=1";
+static const char cmd_nband_read[] PROGMEM = "AT+NBAND?";
+static const char cmd_cfun_off[] PROGMEM = "AT+CFUN=0";
+static const char cmd_cfun_on[] PROGMEM = "AT+CFUN=1";
+static const char cmd_nsocl_0[] PROGMEM = "AT+NSOCL=0";
+static const char cmd_nsocr_tcp[] PROGMEM = "AT+NSOCR=STREAM,6," TCP_LOCAL_PORT ",1";
+static const char cmd_nsostf_test[] PROGMEM = "AT+NSOSTF=?";
+static const char cmd_nsocr_test[] PROGMEM = "AT+NSOCR=?";
+static const char cmd_natspeed_test[] PROGMEM = "AT+NATSPEED=?";
+static const char cmd_npsmr_test[] PROGMEM = "AT+NPSMR=?";
+static const char cmd_nrb[] PROGMEM = "AT+NRB";
+static const char cmd_cclk_read[] PROGMEM = "AT+CCLK?";
+static const char cmd_ctzr_on[] PROGMEM = "AT+CTZR=3"; // +CTZEU URC with UTC time
+
+static const char * const command_table[CMD_COUNT] PROGMEM = {
+  cmd_at,
+  cmd_ate1,
+  cmd_at_w,
+  cmd_cgsn,
+  cmd_cgmr,
+  cmd_cgmm,
+  cmd_nconfig_read,
+  cmd_csq,
+  cmd_nuestats,
+  cmd_nuestats_cell,
+  cmd_cereg_on,
+  cmd_cereg_read,
+  cmd_cops_auto,
+  cmd_cops_read,
+  cmd_cgatt_on,
+  cmd_nband_read,
+  cmd_cfun_off,
+  cmd_cfun_on,
+  cmd_nsocl_0,
+  cmd_nsocr_tcp,
+  cmd_nsostf_test,
+  cmd_nsocr_test,
+  cmd_natspeed_test,
+  cmd_npsmr_test,
+  cmd_nrb,
+  cmd_cclk_read,
+  cmd_ctzr_on
+};
+
+// expected responses, kept in flash. same order with NBIoT_Response
+static const char rsp_ok[] PROGMEM = "OK\r\n";
+static const char rsp_crlf[] PROGMEM = "\r\n";
+
+static const char * const response_table[RSP_COUNT] PROGMEM = {
+  rsp_ok,
+  rsp_crlf
+};
+
+// NCONFIG keys, same order with NBIoT_ConfigItem
+static const char key_autoconnect[] PROGMEM = "AUTOCONNECT";
+static const char key_scrambling[] PROGMEM = "CR_0354_0338_SCRAMBLING";
 
-#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
-  SoftwareSerial DEBUG(10,11); // RX, TX - 9600 baud rate
-#endif 
+static const char * const config_keys[NCONFIG_ITEM_COUNT] PROGMEM = {
+  key_autoconnect,
+  key_scrambling
+};
+
+// accepted NCONFIG values
+static const char config_true[] PROGMEM = "TRUE";
+static const char config_false[] PROGMEM = "FALSE";
+
+// candidate rates of module serial port, fastest first
+static const uint32_t baud_rates[BAUD_RATE_COUNT] PROGMEM = {
+  230400,
+  115200,
+  57600,
+  9600,
+  4800
+};
+
+#define BAUD_RATE(i) ((uint32_t)pgm_read_dword(&baud_rates[i]))
+
+// index of rate in baud_rates, -1 if rate isn't a candidate
+static int8_t baud_index(uint32_t rate)
+{
+  for(uint8_t i = 0; i < BAUD_RATE_COUNT; i++){
+    if(BAUD_RATE(i) == rate)
+      return i;
+  }
+  return -1;
+}
+
+// flash address of command / response string
+#define COMMAND_P(command) ((PGM_P)pgm_read_ptr(&command_table[command]))
+#define RESPONSE_P(response) ((PGM_P)pgm_read_ptr(&response_table[response]))
+#define CONFIG_KEY_P(item) ((PGM_P)pgm_read_ptr(&config_keys[item]))
+#define CONFIG_VALUE_P(target, item) (((target) & (1 << (item))) ? config_true : config_false)
+
+// state of AT+NCONFIG? parsing, one bit per NBIoT_ConfigItem that already matches
+struct NConfigQuery {
+  uint8_t target;
+  uint8_t in_sync;
+};
+
+// line handler for AT+NCONFIG? response. lines look like "+NCONFIG:AUTOCONNECT,TRUE"
+static void parse_nconfig_line(char *line, void *context)
+{
+  NConfigQuery *query = (NConfigQuery *)context;
+
+  if(strncmp_P(line, PSTR("+NCONFIG:"), 9) != 0)
+    return;
+
+  char *key = line + 9;
+  char *value = strchr(key, ',');
+  if(value == NULL)
+    return;
+  *value++ = '\0';
+
+  for(uint8_t i = 0; i < NCONFIG_ITEM_COUNT; i++){
+    if(strcmp_P(key, CONFIG_KEY_P(i)) == 0 && strcmp_P(value, CONFIG_VALUE_P(query->target, i)) == 0)
+      query->in_sync |= (1 << i);
+  }
+}
+
+#if defined(BC95_AT)
+// starts default serial ports of the board
+static void begin_default_ports(uint32_t baud)
+{
+  static bool debug_started = false;
+
+  BC95_AT.begin(baud);
+  if(!debug_started){
+    debugSerial(DEBUG_BAUD);
+    debug_started = true;
+  }
+}
 
 // default
 SixfabNBIoT::SixfabNBIoT()
+  : modem(BC95_AT), debug(debugSerial(0)), pins(NBIOT_DEFAULT_PINS), wire(Wire), baud_handler(begin_default_ports), accel(MMA8452Q_ADDRESS, sixfabI2C)
+{
+
+}
+#endif
+
+// bind to given serial port, I2C bus and pins
+SixfabNBIoT::SixfabNBIoT(Stream &modem_port, TwoWire &wire, Print *debug_port, const NBIoT_Pins &peripheral_pins)
+  : modem(modem_port), debug(debug_port), pins(peripheral_pins), wire(wire), accel(MMA8452Q_ADDRESS, sixfabI2C)
 {
 
 }
@@ -29,174 +193,713 @@ SixfabNBIoT::SixfabNBIoT()
 void SixfabNBIoT::init()
 {
   // setting pin directions
-  pinMode(USER_LED, OUTPUT);
-  pinMode(RELAY, OUTPUT);
-  pinMode(USER_BUTTON, INPUT);
-  pinMode(ALS_PT19_PIN, INPUT);
+  pinMode(pins.user_led, OUTPUT);
+  pinMode(pins.relay, OUTPUT);
+  pinMode(pins.user_button, INPUT);
+  pinMode(pins.als, INPUT);
   
   enable();
 
+  // module keeps rate set by AT+NATSPEED over resets
+  uint32_t stored = 0;
+  storageGet(EEPROM_MODEM_BAUD, stored);
+  if(baud_index(stored) >= 0)
+    modem_baud = stored;
+
   // setting serials
-  BC95_AT.begin(9600);
-  DEBUG.begin(9600);
+  if(baud_handler)
+    baud_handler(modem_baud);
+
+  if(debug)
+    sixfabLog.begin(*debug);
 
-  DEBUG.println("Module initializing");
+  LOG_INFO("NBIOT", "Module initializing");
   delay(500); // wait until module ready.
 
+  sixfabI2C.setWire(wire); // one bus manager for node and sensors
+
   // HDC1080 begin
-  hdc1080.begin(0x40);
+  hdc1080.begin(HDC1080_ADDRESS, sixfabI2C);
   // mma8452q init 
   accel.init();
 
-  setAutoConnectConf(AUTO_ON);
-  setScrambleConf(SCRAMBLE_ON);
+  if(baud_handler && !probe_modem(3) && !recoverBaud())
+    baud_handler(modem_baud); // module isn't answering yet, wait at last known rate
+
+  sendATComm(CMD_ATE1, RSP_OK); 
+  sendATComm(CMD_ATE1, RSP_OK);
+  sendATComm(CMD_AT, RSP_OK);
 
-  sendATComm("ATE1","OK\r\n"); 
-  sendATComm("ATE1","OK\r\n");
-  sendATComm("AT","OK\r\n");
+  initialized = true;
+  reconcileConfig();
+  probeCapabilities();
 }
 
 // power up BC95 module and all peripherals from voltage regulator 
 void SixfabNBIoT::enable()
 {
-  pinMode(BC95_ENABLE, OUTPUT);
-  digitalWrite(BC95_ENABLE,HIGH);
+  pinMode(pins.bc95_enable, OUTPUT);
+  digitalWrite(pins.bc95_enable,HIGH);
 }
 
 // power down BC95 module and all peripherals from voltage regulator 
 void SixfabNBIoT::disable()
 {
-  digitalWrite(BC95_ENABLE,LOW);
+  digitalWrite(pins.bc95_enable,LOW);
 }
 
 // send at comamand to module
 void SixfabNBIoT::sendATCommOnce(const char *comm)
 {
-  BC95_AT.print(comm);
-  BC95_AT.print("\r");
-  //DEBUG.println(comm);
+  modem.print(comm);
+  modem.write('\r');
+  LOG_DEBUG("AT", "> %s", comm);
+}
+
+// send at command from flash to module
+void SixfabNBIoT::sendATCommOnce(NBIoT_Command command)
+{
+  modem.print((const __FlashStringHelper *)COMMAND_P(command));
+  modem.write('\r');
 }
 
-// function for sending at command to BC95_AT.
+// function for sending at command to modem.
 const char* SixfabNBIoT::sendATComm(const char *command, const char *desired_reponse)
+{
+  return wait_response(command, desired_reponse, WAIT_AT);
+}
+
+// function for sending at command from flash to modem.
+const char* SixfabNBIoT::sendATComm(NBIoT_Command command, NBIoT_Response desired_reponse)
+{
+  return wait_response(COMMAND_P(command), RESPONSE_P(desired_reponse), WAIT_AT | WAIT_COMMAND_P | WAIT_RESPONSE_P);
+}
+
+// function for sending composed at command to modem, desired response from flash.
+const char* SixfabNBIoT::sendATComm(const char *command, NBIoT_Response desired_reponse)
+{
+  return wait_response(command, RESPONSE_P(desired_reponse), WAIT_AT | WAIT_RESPONSE_P);
+}
+
+// function for sending data to modem.
+const char* SixfabNBIoT::sendDataComm(const char *command, const char *desired_reponse)
+{
+  return wait_response(command, desired_reponse, 0);
+}
+
+// send command of wait_response, from flash or ram
+void SixfabNBIoT::send_command(const char *command, uint8_t flags)
+{
+  if(flags & WAIT_COMMAND_P)
+    modem.print((const __FlashStringHelper *)command);
+  else
+    modem.print(command);
+
+  if(flags & WAIT_AT)
+    modem.write('\r');
+}
+
+// function for waiting desired response, command is resent in every timeout.
+const char* SixfabNBIoT::wait_response(const char *command, const char *desired_reponse, uint8_t flags)
 {
   uint32_t timer;
-  char response[AT_RESPONSE_LEN]; // module response for AT commands. 
+  uint8_t i = 0;
+  uint16_t desired_len = (flags & WAIT_RESPONSE_P) ? strlen_P(desired_reponse) : strlen(desired_reponse);
+  uint8_t checked = 0; // response bytes that can't start a match anymore
+  bool fresh = true;
 
   memset(response, 0 , AT_RESPONSE_LEN);
-  BC95_AT.flush();
+  modem.flush();
 
-  sendATCommOnce(command);
+  send_command(command, flags);
  
   timer = millis();
-   while(true){
+  while(true){
     if(millis()-timer > timeout){
-      sendATCommOnce(command);
+      report_health(false);
+      send_command(command, flags);
       timer = millis();
     }
-    char c;
-    int i = 0; 
 
-    while(BC95_AT.available()){
-      c = BC95_AT.read();
-      DEBUG.write(c);
-      response[i++]=c;
-      delay(2);
+    while(modem.available()){
+      char c = modem.read();
+      LOG_RAW(c);
+
+      if(c == '\0')
+        continue; // would hide rest of response from search
+      if(i == AT_RESPONSE_LEN - 1){
+        // keep the latest half, desired response is at the end
+        memmove(response, response + AT_RESPONSE_LEN/2, AT_RESPONSE_LEN/2);
+        i -= AT_RESPONSE_LEN/2;
+        memset(response + i, 0, AT_RESPONSE_LEN - i);
+        checked = (checked > AT_RESPONSE_LEN/2) ? checked - AT_RESPONSE_LEN/2 : 0;
       }
-      if(strstr(response, desired_reponse)){
-        return response;
-        memset(response, 0 , strlen(response));
-        break;
-      }    
+      response[i++] = c;
+      fresh = true;
+    }
+    if(!fresh)
+      continue;
+    fresh = false;
+
+    // search only where new bytes can complete a match
+    const char *from = response + checked;
+    if((flags & WAIT_RESPONSE_P) ? strstr_P(from, desired_reponse) : strstr(from, desired_reponse)){
+      report_health(true);
+      sixfabLog.drain();
+      return response;
+    }
+    if(i >= desired_len)
+      checked = i - desired_len + 1;
   }
 }
 
-// function for sending data to BC95_AT.
-const char* SixfabNBIoT::sendDataComm(const char *command, const char *desired_reponse)
+// set function that starts modem serial port
+void SixfabNBIoT::setBaudHandler(NBIoT_BaudHandler handler)
 {
-  uint32_t timer;
-  char response[AT_RESPONSE_LEN]; // module response for AT commands. 
+  baud_handler = handler;
+}
 
-  memset(response, 0 , AT_RESPONSE_LEN);
-  BC95_AT.flush();
+// set function that is notified of transaction results
+void SixfabNBIoT::setHealthHandler(NBIoT_HealthHandler handler, void *context)
+{
+  health_handler = handler;
+  health_context = context;
+}
 
-  BC95_AT.print(command);
- 
-  timer = millis();
-   while(true){
-    if(millis()-timer > timeout){
-      BC95_AT.print(command);
-      timer = millis();
+void SixfabNBIoT::setURCHandler(NBIoT_LineHandler handler, void *context)
+{
+  urc_handler = handler;
+  urc_context = context;
+}
+
+// switch module to fastest reliable rate up to max
+uint32_t SixfabNBIoT::negotiateBaud(uint32_t max)
+{
+  for(uint8_t i = 0; i < BAUD_RATE_COUNT; i++){
+    uint32_t rate = BAUD_RATE(i);
+
+    if(rate > max || baud_errors[i] >= BAUD_ERROR_LIMIT)
+      continue;
+    if(rate == modem_baud || setModemBaud(rate))
+      break;
+  }
+  return modem_baud;
+}
+
+// switch module and host to given rate, confirmed with handshake
+bool SixfabNBIoT::setModemBaud(uint32_t rate)
+{
+  if(baud_handler == NULL || baud_index(rate) < 0 || !hasCapability(CAP_NATSPEED))
+    return false;
+  if(rate == modem_baud)
+    return true;
+
+  uint32_t old_rate = modem_baud;
+
+  sprintf_P(compose, PSTR("AT+NATSPEED=%lu,%u,1,0"), (unsigned long)rate, NATSPEED_TIMEOUT);
+  if(!queryLines(compose, NULL, NULL)){
+    count_baud_error(rate); // rate rejected by module
+    return false;
+  }
+  modem.flush(); // module changes rate after OK
+
+  baud_handler(rate);
+  uint8_t passed = 0;
+  while(passed < BAUD_HANDSHAKE_COUNT && probe_modem(2))
+    passed++;
+
+  if(passed == BAUD_HANDSHAKE_COUNT){
+    modem_baud = rate;
+    storagePut(EEPROM_MODEM_BAUD, rate);
+    LOG_INFO("BAUD", "%lu", (unsigned long)rate);
+    return true;
+  }
+
+  count_baud_error(rate);
+  LOG_WARN("BAUD", "%lu failed", (unsigned long)rate);
+
+  // module stays at new rate if any AT reached it, otherwise reverts after timeout
+  delay(NATSPEED_TIMEOUT * 1000UL);
+  baud_handler(old_rate);
+  if(!probe_modem(3))
+    recoverBaud();
+  return false;
+}
+
+// find rate of module by probing candidate rates
+uint32_t SixfabNBIoT::recoverBaud()
+{
+  if(baud_handler == NULL)
+    return 0;
+
+  count_baud_error(modem_baud); // module stopped responding at this rate
+
+  for(uint8_t i = 0; i < BAUD_RATE_COUNT; i++){
+    uint32_t rate = BAUD_RATE(i);
+
+    baud_handler(rate);
+    if(probe_modem(2)){
+      modem_baud = rate;
+      storagePut(EEPROM_MODEM_BAUD, rate);
+      LOG_INFO("BAUD", "found %lu", (unsigned long)rate);
+      return rate;
     }
-    char c;
-    int i = 0; 
+  }
+  LOG_ERROR("BAUD", "no response");
+  return 0;
+}
 
-    while(BC95_AT.available()){
-      c = BC95_AT.read();
-      DEBUG.write(c);
-      response[i++]=c;
-      delay(2);
-      }
-      if(strstr(response, desired_reponse)){
-        return response;
-        memset(response, 0 , strlen(response));
-        break;
-      }    
+// get current rate of module serial port
+uint32_t SixfabNBIoT::getModemBaud()
+{
+  return modem_baud;
+}
+
+// get error count of rate
+uint16_t SixfabNBIoT::getBaudErrors(uint32_t rate)
+{
+  int8_t i = baud_index(rate);
+  return (i < 0) ? 0 : baud_errors[i];
+}
+
+// check if module answers AT at current host rate
+bool SixfabNBIoT::probe_modem(uint8_t tries)
+{
+  char line[AT_LINE_LEN];
+
+  while(tries--){
+    while(modem.available())
+      modem.read(); // drop bytes received at wrong rate
+
+    sendATCommOnce(CMD_AT);
+    while(readLine(line, sizeof(line), BAUD_PROBE_TIMEOUT)){
+      if(strcmp_P(line, PSTR("OK")) == 0)
+        return true;
+    }
   }
+  return false;
 }
 
-// function for reset BC95_AT module
+// count error of rate, saturated
+void SixfabNBIoT::count_baud_error(uint32_t rate)
+{
+  int8_t i = baud_index(rate);
+  if(i >= 0 && baud_errors[i] < 0xFFFF)
+    baud_errors[i]++;
+}
+
+// function for reading a line from modem.
+uint8_t SixfabNBIoT::readLine(char *line, uint8_t len, uint16_t wait)
+{
+  uint8_t i = 0;
+  uint32_t timer = millis();
+
+  if(len == 0)
+    return 0;
+
+  while(millis()-timer < wait){
+    if(!modem.available())
+      continue;
+
+    char c = modem.read();
+    LOG_RAW(c);
+
+    if(c == '\r' || c == '\0')
+      continue;
+    if(c == '\n'){
+      if(i == 0)
+        continue; // skip empty lines
+      break;
+    }
+    if(i < len - 1)
+      line[i++] = c;
+  }
+  line[i] = '\0';
+  return i;
+}
+
+// function for sending at command and processing its response line by line.
+bool SixfabNBIoT::queryLines(const char *command, NBIoT_LineHandler handler, void *context)
+{
+  if(command){
+    while(modem.available())
+      modem.read(); // drop stale bytes
+
+    sendATCommOnce(command);
+  }
+  return read_result(handler, context);
+}
+
+// function for sending at command from flash and processing its response line by line.
+bool SixfabNBIoT::queryLines(NBIoT_Command command, NBIoT_LineHandler handler, void *context)
+{
+  while(modem.available())
+    modem.read(); // drop stale bytes
+
+  sendATCommOnce(command);
+  return read_result(handler, context);
+}
+
+// check if line is a final error result
+static bool is_error(const char *line)
+{
+  return strcmp_P(line, PSTR("ERROR")) == 0 || strncmp_P(line, PSTR("+CME ERROR"), 10) == 0;
+}
+
+// function for reading response lines until final result
+bool SixfabNBIoT::read_result(NBIoT_LineHandler handler, void *context)
+{
+  char line[AT_LINE_LEN];
+
+  rejected = false;
+  while(readLine(line, sizeof(line), timeout)){
+    if(strcmp_P(line, PSTR("OK")) == 0){
+      report_health(true);
+      sixfabLog.drain();
+      return true;
+    }
+    if(is_error(line)){
+      rejected = true;
+      report_health(true); // module is alive, command is rejected
+      LOG_WARN("AT", "%s", line);
+      sixfabLog.drain();
+      return false;
+    }
+    if(!handle_urc(line) && handler)
+      handler(line, context);
+  }
+  LOG_WARN("AT", "No response");
+  count_baud_error(modem_baud);
+  report_health(false);
+  return false;
+}
+
+// function for processing unsolicited result codes of sockets
+bool SixfabNBIoT::handle_urc(char *line)
+{
+  uint32_t values[3];
+
+  if(parseNumbers(line, PSTR("+NSONMI:"), values, 2) == 2){
+    // data received, <socket>,<length>
+    if(values[0] < SOCKET_COUNT)
+      rx_pending[values[0]] = (values[1] > 0xFFFF) ? 0xFFFF : values[1];
+    return true;
+  }
+  if(parseNumbers(line, PSTR("+NSOSTR:"), values, 3) == 3){
+    // send status, <socket>,<sequence>,<status>
+    if(tcp_socket >= 0 && values[0] == (uint32_t)tcp_socket){
+      if(tcp_unacked)
+        tcp_unacked--;
+      if(values[2] != 1)
+        tcp_failed = true;
+    }
+    return true;
+  }
+  if(parseNumbers(line, PSTR("+NSOCLI:"), values, 1) == 1){
+    // socket closed by module or server
+    if(tcp_socket >= 0 && values[0] == (uint32_t)tcp_socket)
+      tcp_socket = -1;
+    return true;
+  }
+  if(urc_handler)
+    urc_handler(line, urc_context);
+  return false;
+}
+
+// function for reading a byte from module in timeout
+int SixfabNBIoT::read_byte(uint16_t wait)
+{
+  uint32_t timer = millis();
+
+  while(!modem.available()){
+    if(millis()-timer >= wait)
+      return -1;
+  }
+  char c = modem.read();
+  LOG_RAW(c);
+  return c;
+}
+
+// function for waiting final result of a socket command
+bool SixfabNBIoT::wait_result()
+{
+  return read_result(NULL, NULL);
+}
+
+// function for reset BC95 module
 void SixfabNBIoT::resetModule()
 {
   saveConfigurations();
   delay(200);
 
-  digitalWrite(BC95_ENABLE,LOW);
+  digitalWrite(pins.bc95_enable,LOW);
   delay(200);
-  digitalWrite(BC95_ENABLE,HIGH);
+  digitalWrite(pins.bc95_enable,HIGH);
   delay(200);
 }
 
 // Function for save configurations that be done in current session. 
 void SixfabNBIoT::saveConfigurations()
 {
-  sendATComm("AT&W","OK\r\n");
+  sendATComm(CMD_AT_W, RSP_OK);
 }
 
 // Function for getting IMEI number
 const char* SixfabNBIoT::getIMEI()
 {
-  return sendATComm("AT+CGSN","OK\r\n");
+  return sendATComm(CMD_CGSN, RSP_OK);
 }
 
 // Function for getting firmware info
 const char* SixfabNBIoT::getFirmwareInfo()
 {
-  return sendATComm("AT+CGMR","OK\r\n");
+  return sendATComm(CMD_CGMR, RSP_OK);
 }
 
 //Function for getting hardware info
 const char* SixfabNBIoT::getHardwareInfo()
 {
-  return sendATComm("AT+CGMM","OK\r\n");
+  return sendATComm(CMD_CGMM, RSP_OK);
 }
 
 // Function for setting autoconnect feature configuration 
-void SixfabNBIoT::setAutoConnectConf(const char *autoconnect)
+bool SixfabNBIoT::setAutoConnectConf(const char *autoconnect)
 {
-  strcpy(compose, "AUTOCONNECT,");
-  strcat(compose, autoconnect);
-  sendATComm(compose,"OK\r\n");
-  clear_compose();
+  return set_config(NCONFIG_AUTOCONNECT, autoconnect);
 }
 
 // Function for setting scramble feature configuration 
-void SixfabNBIoT::setScrambleConf(const char *scramble)
+bool SixfabNBIoT::setScrambleConf(const char *scramble)
+{
+  return set_config(NCONFIG_SCRAMBLING, scramble);
+}
+
+// Function for applying only the NCONFIG items that differ from desired values
+uint8_t SixfabNBIoT::reconcileConfig()
+{
+  uint32_t hash = config_hash();
+  uint32_t stored;
+  uint8_t writes = 0;
+
+  storageGet(EEPROM_CONFIG_HASH, stored);
+  if(stored == hash)
+    return 0; // applied on a previous boot, module keeps NCONFIG over power cycles
+
+  NConfigQuery query = {config_target, 0};
+  bool applied = true;
+  queryLines(CMD_NCONFIG_READ, parse_nconfig_line, &query); // all items are written if query fails
+
+  for(uint8_t i = 0; i < NCONFIG_ITEM_COUNT; i++){
+    if(!(query.in_sync & (1 << i))){
+      if(write_config((NBIoT_ConfigItem)i))
+        writes++;
+      else
+        applied = false;
+    }
+  }
+
+  if(applied)
+    storagePut(EEPROM_CONFIG_HASH, hash);
+
+  return writes;
+}
+
+// Function for forgetting stored config hash
+void SixfabNBIoT::invalidateConfigCache()
 {
-  strcpy(compose, "AT+NCONFIG=CR_0354_0338_SCRAMBLING,");
-  strcat(compose, scramble);
-  sendATComm(compose,"OK\r\n");
+  uint32_t none = 0xFFFFFFFF;
+  storagePut(EEPROM_CONFIG_HASH, none);
+}
+
+// state of AT+CGMR / AT+CGMM parsing
+struct FirmwareQuery {
+  NBIoT_FirmwareVersion *version;
+  uint32_t key;
+};
+
+// read number that follows tag, NULL if tag doesn't match
+static const char *tag_number(const char *p, PGM_P tag, uint16_t *value)
+{
+  uint8_t len = strlen_P(tag);
+
+  if(strncmp_P(p, tag, len) != 0)
+    return NULL;
+  p += len;
+  if(*p < '0' || *p > '9')
+    return NULL;
+
+  *value = 0;
+  while(*p >= '0' && *p <= '9'){
+    if(*value < 6553)
+      *value = *value * 10 + (*p - '0');
+    p++;
+  }
+  return p;
+}
+
+// line handler for AT+CGMR and AT+CGMM. lines look like 
+// "APPLICATION,V100R100C10B657SP2" and "RADIO,BC95HB-02-STD_850"
+static void parse_firmware_line(char *line, void *context)
+{
+  FirmwareQuery *query = (FirmwareQuery *)context;
+  NBIoT_FirmwareVersion *version = query->version;
+
+  for(const char *p = line; *p; p++){
+    query->key ^= (uint8_t)*p;
+    query->key *= 16777619UL;
+  }
+
+  const char *p;
+  if(strncmp_P(line, PSTR("APPLICATION,"), 12) == 0){
+    uint16_t patch = 0;
+    NBIoT_FirmwareVersion parsed = *version;
+
+    p = line + 12;
+    if((p = tag_number(p, PSTR("V"), &parsed.version)) && (p = tag_number(p, PSTR("R"), &parsed.release)) &&
+       (p = tag_number(p, PSTR("C"), &parsed.code)) && (p = tag_number(p, PSTR("B"), &parsed.build))){
+      tag_number(p, PSTR("SP"), &patch);
+      parsed.patch = patch;
+      *version = parsed;
+    }
+  }
+  // radio variant, "_850" of "BC95HB-02-STD_850"
+  if((p = strstr_P(line, PSTR("STD_"))) != NULL)
+    tag_number(p, PSTR("STD_"), &version->band);
+}
+
+// line handler for AT+NSOCR=?, socket types are listed
+static void parse_nsocr_test_line(char *line, void *context)
+{
+  if(strstr_P(line, PSTR("STREAM")) != NULL)
+    *(bool *)context = true;
+}
+
+// detect features of module firmware, tests are skipped if firmware isn't changed
+uint8_t SixfabNBIoT::probeCapabilities()
+{
+  NBIoT_CapabilityCache cache;
+  FirmwareQuery query = {&firmware, 2166136261UL};
+
+  memset(&firmware, 0, sizeof(firmware));
+  bool known = queryLines(CMD_CGMR, parse_firmware_line, &query);
+  known = queryLines(CMD_CGMM, parse_firmware_line, &query) && known;
+  if(!known)
+    return capabilities; // keep assuming, module will be probed next time
+
+  storageGet(EEPROM_CAPABILITIES, cache);
+  if(cache.key == query.key){
+    capabilities = cache.capabilities;
+    return capabilities;
+  }
+
+  // CAP_* flags in order of test commands, cleared only on an explicit answer
+  bool answered = true;
+  capabilities = 0;
+  for(uint8_t i = 0; i < CAP_COUNT; i++){
+    NBIoT_Command test = (NBIoT_Command)(CMD_NSOSTF_TEST + i);
+    bool listed = (test != CMD_NSOCR_TEST); // AT+NSOCR=? must list STREAM
+    bool ok = queryLines(test, listed ? NULL : parse_nsocr_test_line, &listed);
+
+    if(ok ? listed : !rejected)
+      capabilities |= (1 << i);
+    if(!ok && !rejected)
+      answered = false; // timed out, can't tell
+  }
+  if(!answered){
+    LOG_WARN("NBIOT", "Capability test unanswered, caps %02X not stored", capabilities);
+    return capabilities;
+  }
+
+  cache.key = query.key;
+  cache.capabilities = capabilities;
+  storagePut(EEPROM_CAPABILITIES, cache);
+  LOG_INFO("NBIOT", "B%u SP%u caps %02X", firmware.build, firmware.patch, capabilities);
+  return capabilities;
+}
+
+// check feature of module firmware
+bool SixfabNBIoT::hasCapability(uint8_t capability)
+{
+  return (capabilities & capability) != 0;
+}
+
+// get parsed firmware version
+void SixfabNBIoT::getFirmwareVersion(NBIoT_FirmwareVersion *version)
+{
+  *version = firmware;
+}
+
+// Function for writing desired value of config item to module
+bool SixfabNBIoT::write_config(NBIoT_ConfigItem item)
+{
+  bool written;
+
+  strcpy_P(compose, PSTR("AT+NCONFIG="));
+  strcat_P(compose, CONFIG_KEY_P(item));
+  strcat_P(compose, PSTR(","));
+  strcat_P(compose, CONFIG_VALUE_P(config_target, item));
+  written = queryLines(compose, NULL, NULL);
   clear_compose();
+  return written;
+}
+
+// Function for changing desired value of config item, written at once if 
+// module is initialized, otherwise by reconcileConfig() of init()
+bool SixfabNBIoT::set_config(NBIoT_ConfigItem item, const char *value)
+{
+  uint8_t bit = 1 << item;
+  uint8_t target;
+  uint32_t stored;
+
+  // copy into accepted set, caller's string isn't kept
+  if(strcasecmp_P(value, config_true) == 0)
+    target = config_target | bit;
+  else if(strcasecmp_P(value, config_false) == 0)
+    target = config_target & ~bit;
+  else
+    return false;
+
+  if(target == config_target)
+    return true;
+
+  storageGet(EEPROM_CONFIG_HASH, stored);
+  bool in_sync = (stored == config_hash()); // module has whole desired set
+  config_target = target;
+
+  if(!initialized)
+    return true;
+  if(!write_config(item))
+    return false; // stored hash doesn't match new set, next reconcileConfig() queries module
+
+  if(in_sync)
+    storagePut(EEPROM_CONFIG_HASH, config_hash());
+  return true;
+}
+
+// FNV-1a hash over "KEY,VALUE;" pairs of desired config set
+uint32_t SixfabNBIoT::config_hash()
+{
+  uint32_t hash = 2166136261UL;
+
+  for(uint8_t i = 0; i < NCONFIG_ITEM_COUNT; i++){
+    PGM_P key = CONFIG_KEY_P(i);
+    char c;
+
+    while((c = pgm_read_byte(key++))){
+      hash ^= (uint8_t)c;
+      hash *= 16777619UL;
+    }
+    hash ^= ',';
+    hash *= 16777619UL;
+    PGM_P value = CONFIG_VALUE_P(config_target, i);
+    while((c = pgm_read_byte(value++))){
+      hash ^= (uint8_t)c;
+      hash *= 16777619UL;
+    }
+    hash ^= ';';
+    hash *= 16777619UL;
+  }
+  return hash;
 }
 
 // function for getting ip_address
@@ -255,18 +958,294 @@ void SixfabNBIoT::setTimeout(uint16_t new_timeout)
 // function for getting signal quality
 const char* SixfabNBIoT::getSignalQuality()
 {
-  return sendATComm("AT+CSQ","OK\r\n");
+  return sendATComm(CMD_CSQ, RSP_OK);
+}
+
+// state of AT+CSQ parsing
+struct CSQQuery {
+  NBIoT_SignalQuality *out;
+  bool found;
+};
+
+// line handler for AT+CSQ
+static void parse_csq_line(char *line, void *context)
+{
+  CSQQuery *query = (CSQQuery *)context;
+  if(parseSignalQuality(line, query->out))
+    query->found = true;
+}
+
+// function for reading parsed signal quality
+bool SixfabNBIoT::readSignalQuality(NBIoT_SignalQuality *quality)
+{
+  CSQQuery query = {quality, false};
+  return queryLines(CMD_CSQ, parse_csq_line, &query) && query.found;
+}
+
+// line handler for AT+NUESTATS
+static void parse_uestats_line(char *line, void *context)
+{
+  parseUEStatsLine(line, (NBIoT_UEStats *)context);
+}
+
+// function for reading radio statistics
+bool SixfabNBIoT::readUEStats(NBIoT_UEStats *stats)
+{
+  memset(stats, 0, sizeof(NBIoT_UEStats));
+  return queryLines(CMD_NUESTATS, parse_uestats_line, stats) && stats->fields;
+}
+
+// state of AT+NUESTATS=CELL parsing
+struct CellQuery {
+  NBIoT_CellStats *out;
+  uint8_t found; // 1 : any cell, 2 : primary cell
+};
+
+// line handler for AT+NUESTATS=CELL
+static void parse_cell_line(char *line, void *context)
+{
+  CellQuery *query = (CellQuery *)context;
+  NBIoT_CellStats cell;
+
+  if(query->found == 2 || !parseCellStatsLine(line, &cell))
+    return;
+
+  if(cell.primary || !query->found){
+    *query->out = cell;
+    query->found = cell.primary ? 2 : 1;
+  }
+}
+
+// function for reading serving cell statistics
+bool SixfabNBIoT::readCellStats(NBIoT_CellStats *cell)
+{
+  CellQuery query = {cell, 0};
+  return queryLines(CMD_NUESTATS_CELL, parse_cell_line, &query) && query.found;
+}
+
+// line handler for AT+NBAND?
+static void parse_nband_line(char *line, void *context)
+{
+  uint8_t *bands = (uint8_t *)context;
+  uint8_t count = parseBands(line, bands, ATTACH_BAND_COUNT);
+  if(count && count < ATTACH_BAND_COUNT)
+    bands[count] = 0;
 }
 
 // connect to base station of operator
-void SixfabNBIoT::connectToOperator()
+bool SixfabNBIoT::connectToOperator()
 {
-  DEBUG.println("\nTrying to connect base station of operator...");
-  sendATComm("AT+CGATT=1","OK\r\n");
-  delay(500);
-  sendATComm("AT+CGATT?","+CGATT:1\r\n");
+  NBIoT_AttachHint hint;
+  uint32_t started = millis();
+  uint32_t wait = attach_deadline;
+  bool hinted;
+  bool attached;
+
+  LOG_INFO("NBIOT", "Trying to connect base station of operator...");
+
+  storageGet(EEPROM_ATTACH_HINT, hint);
+  hinted = (hint.magic == ATTACH_HINT_MAGIC);
+  if(!hinted)
+    memset(&hint, 0, sizeof(hint));
+
+  sendATComm(CMD_CEREG_ON, RSP_OK); // registration URCs
+
+  if(hinted){
+    // narrow the scan to the band and operator of last successful attach
+    if(hint.bands[1] && hint.band){
+      uint8_t current[ATTACH_BAND_COUNT] = {0};
+      queryLines(CMD_NBAND_READ, parse_nband_line, current);
+      if(current[0] != hint.band || current[1])
+        set_bands(&hint.band, 1); // band list is kept by module, skip radio restart if already set
+    }
+    if(hint.plmn[0]){
+      uint16_t saved = timeout;
+
+      // module may search before answering manual selection
+      sprintf_P(compose, PSTR("AT+COPS=1,2,\"%s\""), hint.plmn);
+      timeout = COPS_TIMEOUT;
+      if(!queryLines(compose, NULL, NULL)){
+        LOG_WARN("NBIOT", "Stored operator rejected");
+        hint.plmn[0] = '\0'; // operator of next attach is stored
+      }
+      timeout = saved;
+      clear_compose();
+    }
+    if(wait == 0 || wait > ATTACH_HINT_TIMEOUT)
+      wait = ATTACH_HINT_TIMEOUT;
+  }
+
+  sendATComm(CMD_CGATT_ON, RSP_OK);
+  attached = wait_registration(wait);
+
+  if(!attached && hinted){
+    // hint didn't work, fall back to full scan in remaining time
+    LOG_WARN("NBIOT", "Stored band / operator failed, scanning all bands...");
+    sendATComm(CMD_COPS_AUTO, RSP_OK);
+    if(hint.bands[1])
+      set_bands(hint.bands, ATTACH_BAND_COUNT);
+    sendATComm(CMD_CGATT_ON, RSP_OK);
+
+    wait = 0;
+    if(attach_deadline){
+      uint32_t elapsed = millis() - started;
+      wait = (elapsed < attach_deadline) ? attach_deadline - elapsed : 1;
+    }
+    attached = wait_registration(wait);
+  }
+
+  if(!attached)
+    return false;
+
+  attach_time = millis() - started;
+  LOG_INFO("NBIOT", "Attached in %lu ms", (unsigned long)attach_time);
+  save_attach_hint(&hint);
   
   getSignalQuality(); 
+  return true;
+}
+
+// set overall attach deadline
+void SixfabNBIoT::setAttachDeadline(uint32_t deadline)
+{
+  attach_deadline = deadline;
+}
+
+// get duration of last attach
+uint32_t SixfabNBIoT::getAttachTime()
+{
+  return attach_time;
+}
+
+// forget stored band and operator
+void SixfabNBIoT::clearAttachHint()
+{
+  uint8_t none = 0xFF;
+  storagePut(EEPROM_ATTACH_HINT, none);
+}
+
+// units of GPRS timers, 3 bit code in bits 8-6 of timer, smallest unit first
+typedef struct {
+  uint32_t seconds;
+  uint8_t code;
+} PSMTimerUnit;
+
+static const PSMTimerUnit tau_units[] PROGMEM = {
+  {2, 3}, {30, 4}, {60, 5}, {600, 0}, {3600, 1}, {36000, 2}, {1152000, 6}
+};
+static const PSMTimerUnit active_units[] PROGMEM = {
+  {2, 0}, {60, 1}, {360, 2}
+};
+
+// write timer as 8 bit string, value of 5 bits in smallest unit that holds seconds
+static void psm_timer(char *out, uint32_t seconds, const PSMTimerUnit *units, uint8_t count)
+{
+  uint8_t i = 0;
+  uint32_t value;
+
+  for(;; i++){
+    uint32_t unit = pgm_read_dword(&units[i].seconds);
+    value = seconds / unit + (seconds % unit != 0);
+    if(value <= 31 || i == count - 1)
+      break;
+  }
+  if(value > 31)
+    value = 31;
+
+  uint8_t bits = (pgm_read_byte(&units[i].code) << 5) | value;
+  for(uint8_t b = 0; b < 8; b++)
+    out[b] = (bits & (0x80 >> b)) ? '1' : '0';
+  out[8] = '\0';
+}
+
+// request power saving mode timers
+bool SixfabNBIoT::setPSM(uint32_t tau, uint32_t active)
+{
+  char tau_bits[9];
+  char active_bits[9];
+
+  if(tau == 0){
+    strcpy_P(compose, PSTR("AT+CPSMS=0"));
+  }
+  else{
+    psm_timer(tau_bits, tau, tau_units, sizeof(tau_units) / sizeof(tau_units[0]));
+    psm_timer(active_bits, active, active_units, sizeof(active_units) / sizeof(active_units[0]));
+    sprintf_P(compose, PSTR("AT+CPSMS=1,,,\"%s\",\"%s\""), tau_bits, active_bits);
+  }
+
+  bool ok = queryLines(compose, NULL, NULL);
+  clear_compose();
+  return ok;
+}
+
+// line handler that picks registration status from AT+CEREG? response
+static void parse_cereg_line(char *line, void *context)
+{
+  parseRegistration(line, (uint8_t *)context);
+}
+
+// wait +CEREG URC with status home or roaming
+bool SixfabNBIoT::wait_registration(uint32_t wait)
+{
+  char line[AT_LINE_LEN];
+  uint8_t stat = CEREG_NOT_REGISTERED;
+  uint32_t timer = millis();
+
+  if(wait == 0 || wait > ATTACH_TIMEOUT_MAX)
+    wait = ATTACH_TIMEOUT_MAX;
+
+  // module may be registered before URCs are enabled
+  queryLines(CMD_CEREG_READ, parse_cereg_line, &stat);
+
+  while(stat != CEREG_HOME && stat != CEREG_ROAMING){
+    if(millis() - timer >= wait)
+      return false;
+    if(readLine(line, sizeof(line), timeout)){
+      report_health(true); // module is alive while searching network
+      parseRegistration(line, &stat);
+    }
+  }
+  return true;
+}
+
+// set band list of module, NBAND can only be changed while radio is off
+void SixfabNBIoT::set_bands(const uint8_t *bands, uint8_t len)
+{
+  strcpy_P(compose, PSTR("AT+NBAND="));
+  for(uint8_t i = 0; i < len && bands[i]; i++)
+    sprintf_P(compose + strlen(compose), i ? PSTR(",%u") : PSTR("%u"), bands[i]);
+
+  sendATComm(CMD_CFUN_OFF, RSP_OK);
+  sendATComm(compose, RSP_OK);
+  sendATComm(CMD_CFUN_ON, RSP_OK);
+  clear_compose();
+}
+
+// line handler for AT+COPS?
+static void parse_cops_line(char *line, void *context)
+{
+  parseOperator(line, (char *)context);
+}
+
+// store band and operator of current registration
+void SixfabNBIoT::save_attach_hint(NBIoT_AttachHint *hint)
+{
+  NBIoT_AttachHint stored = *hint;
+  NBIoT_UEStats stats;
+  char plmn[PLMN_LEN] = "";
+
+  // full band list is only known before narrowing it to a single band
+  if(hint->magic != ATTACH_HINT_MAGIC)
+    queryLines(CMD_NBAND_READ, parse_nband_line, hint->bands);
+
+  if(readUEStats(&stats) && (stats.fields & UESTATS_BAND))
+    hint->band = stats.band;
+  if(queryLines(CMD_COPS_READ, parse_cops_line, plmn) && plmn[0])
+    strcpy(hint->plmn, plmn);
+
+  hint->magic = ATTACH_HINT_MAGIC;
+  if(memcmp(&stored, hint, sizeof(NBIoT_AttachHint)) != 0)
+    storagePut(EEPROM_ATTACH_HINT, *hint);
 }
 
 /******************************************************************************************
@@ -276,42 +1255,303 @@ void SixfabNBIoT::connectToOperator()
 // function for connecting to server via UDP
 void SixfabNBIoT::startUDPService()
 {
-  char *port = "3005";
-
-  strcpy(compose, "AT+NSOCR=DGRAM,17,");
-  strcat(compose, port);
-  strcat(compose, ",0");
+  strcpy_P(compose, PSTR("AT+NSOCR=DGRAM,17,3005,1"));
   
-  sendATComm(compose,"OK\r\n");
+  sendATComm(compose, RSP_OK);
   clear_compose();
 }
 
 // fuction for sending data via udp.
 void SixfabNBIoT::sendDataUDP(const char *data)
 {
-  char data_len[5];
-  sprintf(data_len, "%d", strlen(data));
+  sendDataUDP((const uint8_t *)data, strlen(data));
+}
 
-  convert_data_str_to_hex(data);
+// fuction for sending binary data via udp.
+bool SixfabNBIoT::sendDataUDP(const uint8_t *data, uint16_t len)
+{
+  if(len > UDP_DATA_LEN)
+    return false;
 
-  strcpy(compose, "AT+NSOST=0,");
-  strcat(compose, ip_address);
-  strcat(compose, ",");
-  strcat(compose, port_number);
-  strcat(compose, ",");
-  strcat(compose, data_len);
-  strcat(compose, ",");
-  strcat(compose, data_hex);
+  convert_data_bin_to_hex(data, len);
+  snprintf_P(compose, sizeof(compose), PSTR("AT+NSOST=0,%s,%s,%u,%s"), ip_address, port_number, len, data_hex);
 
-  sendATComm(compose,"\r\n");
+  // wait final result, "<socket>,<length>" line left behind would be read as data by AT+NSORF
+  bool sent = queryLines(compose, NULL, NULL);
   clear_compose();
   clear_data_hex();
+  return sent;
 }
 
 // function for closing server connection
 void SixfabNBIoT::closeConnection()
 {
-  sendATComm("AT+NSOCL=0","\r\n");
+  sendATComm(CMD_NSOCL_0, RSP_CRLF);
+}
+
+// function for receiving data of udp socket
+int16_t SixfabNBIoT::receiveDataUDP(uint8_t *buffer, uint16_t size)
+{
+  return receiveData(0, buffer, size);
+}
+
+// line handler for AT+NSOCR, response is the socket id
+static void parse_socket_line(char *line, void *context)
+{
+  if(line[0] >= '0' && line[0] < '0' + SOCKET_COUNT && line[1] == '\0')
+    *(int8_t *)context = line[0] - '0';
+}
+
+// function for connecting to server via tcp
+bool SixfabNBIoT::connectTCP()
+{
+  int8_t socket = -1;
+
+  if(!hasCapability(CAP_TCP))
+    return false;
+
+  closeTCP();
+
+  if(!queryLines(CMD_NSOCR_TCP, parse_socket_line, &socket) || socket < 0)
+    return false;
+
+  sprintf_P(compose, PSTR("AT+NSOCO=%d,%s,%s"), socket, ip_address, port_number);
+  bool connected = queryLines(compose, NULL, NULL);
+  clear_compose();
+
+  if(!connected){
+    sprintf_P(compose, PSTR("AT+NSOCL=%d"), socket);
+    queryLines(compose, NULL, NULL);
+    clear_compose();
+    return false;
+  }
+
+  tcp_socket = socket;
+  tcp_unacked = 0;
+  tcp_failed = false;
+  rx_pending[socket] = 0;
+  return true;
+}
+
+// function for sending data via tcp from a data source
+bool SixfabNBIoT::sendDataTCP(NBIoT_DataSource source, void *context)
+{
+  static const char hex[] PROGMEM = "0123456789ABCDEF";
+  uint8_t chunk[TCP_CHUNK_LEN];
+  char line[AT_LINE_LEN];
+  uint16_t len;
+
+  if(tcp_socket < 0)
+    return false;
+
+  tcp_failed = false;
+
+  while((len = source(chunk, sizeof(chunk), context)) > 0){
+    // flow control, wait acknowledges while window is full
+    while(tcp_unacked >= TCP_WINDOW && !tcp_failed){
+      if(!readLine(line, sizeof(line), TCP_ACK_TIMEOUT))
+        return false;
+      handle_urc(line);
+    }
+    if(tcp_failed || tcp_socket < 0)
+      return false;
+
+    if(++tcp_sequence == 0)
+      tcp_sequence = 1;
+
+    // AT+NSOSD=<socket>,<length>,<data>,<flag>,<sequence>
+    modem.print(F("AT+NSOSD="));
+    modem.print(tcp_socket);
+    modem.write(',');
+    modem.print(len);
+    modem.write(',');
+    for(uint16_t i = 0; i < len; i++){
+      modem.write(pgm_read_byte(&hex[chunk[i] >> 4]));
+      modem.write(pgm_read_byte(&hex[chunk[i] & 0x0F]));
+    }
+    modem.print(F(",0x000,"));
+    modem.print(tcp_sequence);
+    modem.write('\r');
+
+    tcp_unacked++;
+    if(!wait_result()){
+      tcp_unacked--;
+      return false;
+    }
+  }
+  return !tcp_failed;
+}
+
+// state of buffer data source
+struct BufferSource {
+  const uint8_t *data;
+  uint16_t left;
+};
+
+// data source that reads from a buffer
+static uint16_t read_buffer(uint8_t *chunk, uint16_t max, void *context)
+{
+  BufferSource *source = (BufferSource *)context;
+  uint16_t len = (max < source->left) ? max : source->left;
+
+  memcpy(chunk, source->data, len);
+  source->data += len;
+  source->left -= len;
+  return len;
+}
+
+// function for sending buffer via tcp
+bool SixfabNBIoT::sendDataTCP(const uint8_t *data, uint16_t len)
+{
+  BufferSource source = {data, len};
+  return sendDataTCP(read_buffer, &source);
+}
+
+// function for waiting acknowledge of all sent tcp segments
+bool SixfabNBIoT::flushTCP()
+{
+  char line[AT_LINE_LEN];
+
+  while(tcp_unacked && !tcp_failed && tcp_socket >= 0){
+    if(!readLine(line, sizeof(line), TCP_ACK_TIMEOUT))
+      return false;
+    handle_urc(line);
+  }
+  return !tcp_failed && !tcp_unacked;
+}
+
+// function for receiving data of tcp socket
+int16_t SixfabNBIoT::receiveDataTCP(uint8_t *buffer, uint16_t size)
+{
+  if(tcp_socket < 0)
+    return -1;
+  return receiveData(tcp_socket, buffer, size);
+}
+
+// function for closing tcp connection
+void SixfabNBIoT::closeTCP()
+{
+  if(tcp_socket < 0)
+    return;
+
+  sprintf_P(compose, PSTR("AT+NSOCL=%d"), tcp_socket);
+  queryLines(compose, NULL, NULL);
+  clear_compose();
+  tcp_socket = -1;
+  tcp_unacked = 0;
+}
+
+// function for getting length of notified data
+uint16_t SixfabNBIoT::pendingData(uint8_t socket)
+{
+  return (socket < SOCKET_COUNT) ? rx_pending[socket] : 0;
+}
+
+// function for waiting data notification of a socket
+bool SixfabNBIoT::waitData(uint8_t socket, uint16_t wait)
+{
+  char line[AT_LINE_LEN];
+  uint32_t timer = millis();
+  uint32_t elapsed;
+
+  if(socket >= SOCKET_COUNT)
+    return false;
+
+  while(!rx_pending[socket] && (elapsed = millis() - timer) < wait){
+    if(readLine(line, sizeof(line), wait - elapsed))
+      handle_urc(line);
+  }
+  return rx_pending[socket] > 0;
+}
+
+// convert hex digit to value, -1 if not a hex digit
+static int8_t hex_value(int c)
+{
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// function for receiving data of a socket. 
+// response : <socket>,<ip_addr>,<port>,<length>,<data>,<remaining_length>
+int16_t SixfabNBIoT::receiveData(uint8_t socket, uint8_t *buffer, uint16_t size)
+{
+  char line[AT_LINE_LEN];
+  int16_t received = 0;
+  int c;
+
+  if(socket >= SOCKET_COUNT)
+    return -1;
+
+  sprintf_P(line, PSTR("AT+NSORF=%u,%u"), socket, (size < SOCKET_DATA_LEN) ? size : SOCKET_DATA_LEN);
+  sendATCommOnce(line);
+
+  while((c = read_byte(timeout)) >= 0){
+    if(c == '\r' || c == '\n')
+      continue;
+
+    if(c >= '0' && c <= '9'){
+      uint8_t commas = 0;
+      uint16_t length = 0;
+      uint16_t remaining = 0;
+
+      // skip <socket>,<ip_addr>,<port>
+      while(commas < 3){
+        if((c = read_byte(timeout)) < 0 || c == '\n')
+          return -1;
+        if(c == ',')
+          commas++;
+      }
+      // <length>
+      while((c = read_byte(timeout)) >= '0' && c <= '9'){
+        length = length * 10 + (c - '0');
+        if(length > SOCKET_DATA_LEN)
+          return -1;
+      }
+      if(c != ',')
+        return -1;
+      // <data>, decoded straight into caller buffer
+      for(uint16_t i = 0; i < length; i++){
+        int8_t high = hex_value(read_byte(timeout));
+        int8_t low = hex_value(read_byte(timeout));
+        if(high < 0 || low < 0)
+          return -1;
+        if(i < size)
+          buffer[i] = (high << 4) | low;
+      }
+      // <remaining_length>
+      if(read_byte(timeout) != ',')
+        return -1;
+      while((c = read_byte(timeout)) >= '0' && c <= '9'){
+        if(remaining < 6553)
+          remaining = remaining * 10 + (c - '0');
+      }
+
+      rx_pending[socket] = remaining;
+      received = (length < size) ? length : size;
+      continue;
+    }
+
+    // other lines, final result or URC
+    uint8_t i = 0;
+    while(c >= 0 && c != '\n'){
+      if(c != '\r' && i < sizeof(line) - 1)
+        line[i++] = c;
+      c = read_byte(timeout);
+    }
+    line[i] = '\0';
+
+    if(strcmp_P(line, PSTR("OK")) == 0){
+      report_health(true);
+      return received;
+    }
+    if(is_error(line))
+      return -1;
+    handle_urc(line);
+  }
+  report_health(false);
+  return -1;
 }
 
 /******************************************************************************************
@@ -339,39 +1579,85 @@ double SixfabNBIoT::readHum()
   return hdc1080.readHumidity();
 }
 
+// read all sensors while HDC1080 converts
+uint8_t SixfabNBIoT::sampleAll(NBIoT_Snapshot *snapshot, SixfabTime *time, SixfabLight *light)
+{
+  uint16_t raw_t, raw_h;
+  uint32_t started = millis();
+
+  memset(snapshot, 0, sizeof(NBIoT_Snapshot));
+  snapshot->stamp = time ? time->monotonic() : started;
+  bool converting = hdc1080.startConversion();
+
+  if(accel.readMilliG(snapshot->accel))
+    snapshot->valid |= SNAPSHOT_ACCEL;
+
+  // ADC may be owned by interrupt of SixfabLight, analogRead() would break its batch
+  if(light)
+    snapshot->light = light->readRaw() >> light->getOversampling();
+  else
+    snapshot->light = analogRead(pins.als);
+  snapshot->valid |= SNAPSHOT_LIGHT;
+
+  if(converting){
+    uint32_t elapsed = millis() - started;
+    if(elapsed < HDC1080_CONVERSION_TIME)
+      delay(HDC1080_CONVERSION_TIME - elapsed);
+
+    if(hdc1080.readConversion(&raw_t, &raw_h)){
+      snapshot->temperature = ((int32_t)raw_t * 16500 >> 16) - 4000;
+      snapshot->humidity = (uint32_t)raw_h * 10000 >> 16;
+      snapshot->valid |= SNAPSHOT_TEMPERATURE | SNAPSHOT_HUMIDITY;
+    }
+  }
+  return snapshot->valid;
+}
+
+//
+SixfabI2CBus &SixfabNBIoT::getI2CBus()
+{
+  return sixfabI2C;
+}
+
+//
+MMA8452Q &SixfabNBIoT::getAccel()
+{
+  return accel;
+}
+
 //
 double SixfabNBIoT::readLux()
 {
-  return analogRead(ALS_PT19_PIN);
+  return analogRead(pins.als);
 }
 
 //
 void SixfabNBIoT::turnOnRelay()
 {
-  digitalWrite(RELAY, HIGH);
+  digitalWrite(pins.relay, HIGH);
 }
 
 //
 void SixfabNBIoT::turnOffRelay()
 { 
-  digitalWrite(RELAY, LOW);
+  digitalWrite(pins.relay, LOW);
 }
 
 //
 uint8_t SixfabNBIoT::readUserButton()
 {
-  return digitalRead(USER_BUTTON);
+  return digitalRead(pins.user_button);
 }
 
 //
 void SixfabNBIoT::turnOnUserLED()
 {
-  digitalWrite(USER_LED, HIGH);
+  digitalWrite(pins.user_led, HIGH);
 }
 
 //
 void SixfabNBIoT::turnOffUserLED()
 {
-  digitalWrite(USER_LED, LOW);
+  digitalWrite(pins.user_led, LOW);
 }
 
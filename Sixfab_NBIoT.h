@@ -19,22 +19,44 @@
 #include <stdio.h>
 #include <string.h>
 #include <Wire.h>
-#include <SoftwareSerial.h>
+#include <Sixfab_Storage.h>
+#include <Sixfab_Log.h>
+#include <Sixfab_I2CBus.h>
 #include <Sixfab_HDC1080.h>
 #include <Sixfab_MMA8452Q.h>
+#include <Sixfab_RadioStats.h>
 
-// determine board type
+class SixfabTime;
+class SixfabLight;
+
+// determine board type, these are default serial ports of shield. 
+// on other boards pass the ports to constructor.
 // Arduino Geniuno / Uno or Mega
+// debug output is SoftwareSerial on pins 10 / 11 here. SoftwareSerial takes 
+// every pin change vector, so library doesn't link it. To use it, include 
+// <SoftwareSerial.h> before this header and put SIXFAB_DEBUG_SERIAL() once 
+// at file scope of the sketch.
 #if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
-  #define BC95_AT Serial // 115200 baud rate
-  extern SoftwareSerial DEBUG;
+  #define BC95_AT Serial // BC95_BAUD, changed by negotiateBaud()
+  #define DEBUG_RX_PIN 10
+  #define DEBUG_TX_PIN 11
+  #if defined(SoftwareSerial_h)
+    extern SoftwareSerial DEBUG;
+    // emits debug port, once in sketch
+    #define SIXFAB_DEBUG_SERIAL() \
+      SoftwareSerial DEBUG(DEBUG_RX_PIN, DEBUG_TX_PIN); \
+      Print *debugSerial(uint32_t baud) { if(baud) DEBUG.begin(baud); return &DEBUG; }
+  #endif
 // Tinylab, Arduino Leonardo or Micro  
 #elif defined(__AVR_ATmega32U4__) || defined(__AVR_ATmega16U4__)
-  #define BC95_AT Serial1 // 115200 baud rate
+  #define BC95_AT Serial1 // BC95_BAUD, changed by negotiateBaud()
   #define DEBUG Serial
 #endif
 
-// Peripheral Pin Definations
+#if !defined(SIXFAB_DEBUG_SERIAL)
+  #define SIXFAB_DEBUG_SERIAL()
+#endif
+
 // Peripheral Pin Definations
 #define USER_BUTTON 8
 #define USER_LED 6
@@ -42,6 +64,11 @@
 #define ALS_PT19_PIN A1
 #define RELAY 5
 
+#define BC95_BAUD 9600 // factory default rate of BC95
+#define DEBUG_BAUD 9600
+#define HDC1080_ADDRESS 0x40
+#define MMA8452Q_ADDRESS 0x1C
+
 // Constants  
 #define TIMEOUT 1000
 #define IP_ADDRESS_LEN 30
@@ -51,6 +78,57 @@
 #define AT_RESPONSE_LEN 100
 #define DATA_COMPOSE_LEN 100
 #define DATA_LEN_LEN 3  
+#define AT_LINE_LEN 64
+
+// wait_response flags
+#define WAIT_AT 0x01         // append carriage return to command
+#define WAIT_COMMAND_P 0x02  // command is in flash
+#define WAIT_RESPONSE_P 0x04 // desired response is in flash
+#define UDP_DATA_LEN 99 // max bytes of a datagram, limited by data_hex buffer
+#define SOCKET_COUNT 7 // sockets supported by BC95
+#define SOCKET_DATA_LEN 512 // max bytes of a single NSOSD / NSORF transfer
+#define TCP_CHUNK_LEN 64 // bytes taken from data source per AT+NSOSD
+#define TCP_WINDOW 4 // max AT+NSOSD segments waiting for acknowledge
+#define TCP_ACK_TIMEOUT 40000 // ms waited for a +NSOSTR, a round trip takes seconds at ECL 2
+#define TCP_LOCAL_PORT "3006"
+
+// EEPROM Layout : area reserved for library, can be moved with SIXFAB_EEPROM_BASE
+#ifndef SIXFAB_EEPROM_BASE
+  #define SIXFAB_EEPROM_BASE 0
+#endif
+#define EEPROM_CONFIG_HASH (SIXFAB_EEPROM_BASE + 0) // uint32_t, hash of last applied NCONFIG set
+#define EEPROM_ATTACH_HINT (SIXFAB_EEPROM_BASE + 4) // NBIoT_AttachHint, 16 bytes reserved
+#define EEPROM_MODEM_BAUD (SIXFAB_EEPROM_BASE + 20) // uint32_t, rate stored in module with AT+NATSPEED
+#define EEPROM_OTA_STATE (SIXFAB_EEPROM_BASE + 24) // NBIoT_OTAState, 16 bytes reserved
+#define EEPROM_CAPABILITIES (SIXFAB_EEPROM_BASE + 40) // NBIoT_CapabilityCache, 8 bytes reserved
+#define EEPROM_SECURE_STATE (SIXFAB_EEPROM_BASE + 48) // NBIoT_SecureState, 48 bytes reserved
+#define EEPROM_COMMAND_STATE (SIXFAB_EEPROM_BASE + 96) // NBIoT_CommandState, 8 bytes reserved
+
+// Baud Rate
+#ifndef BAUD_MAX
+  #define BAUD_MAX 115200 // fastest rate tried by negotiateBaud()
+#endif
+#define BAUD_RATE_COUNT 5 // candidate rates, see baud_rates in Sixfab_NBIoT.cpp
+#define NATSPEED_TIMEOUT 3 // s, module returns to old rate if no AT command is received at new rate
+#define BAUD_HANDSHAKE_COUNT 4 // AT round trips that must succeed at new rate
+#define BAUD_PROBE_TIMEOUT 300 // ms waited for OK of a probe
+#define BAUD_ERROR_LIMIT 3 // rates with more errors are skipped by negotiateBaud()
+
+// Attach
+#define ATTACH_DEADLINE 0 // ms, 0 : wait until attached, at most ATTACH_TIMEOUT_MAX
+#define ATTACH_TIMEOUT_MAX 600000UL // ms, longest wait for registration
+#define ATTACH_HINT_TIMEOUT 30000 // ms given to stored band / operator before full scan
+#define COPS_TIMEOUT 30000 // ms waited for result of manual operator selection
+#define ATTACH_BAND_COUNT 4
+#define ATTACH_HINT_MAGIC 0xA7
+
+// Firmware capabilities, probed once per firmware version
+#define CAP_NSOSTF 0x01   // AT+NSOSTF, datagrams with release assistance flags
+#define CAP_TCP 0x02      // STREAM sockets
+#define CAP_NATSPEED 0x04 // AT+NATSPEED, baud rate change
+#define CAP_PSM_URC 0x08  // AT+NPSMR, power saving mode URCs
+#define CAP_COUNT 4
+#define CAP_ALL 0xFF      // assumed until probeCapabilities() is called
 
 #define SCRAMBLE_ON "TRUE"
 #define SCRAMBLE_OFF "FALSE"
@@ -58,18 +136,157 @@
 #define AUTO_ON "TRUE"
 #define AUTO_OFF "FALSE"
 
+// NCONFIG items that are kept in sync by reconcileConfig()
+enum NBIoT_ConfigItem {
+  NCONFIG_AUTOCONNECT,
+  NCONFIG_SCRAMBLING,
+  NCONFIG_ITEM_COUNT
+};
+
+// band and operator of last successful attach, stored in EEPROM
+typedef struct {
+  uint8_t magic;                    // ATTACH_HINT_MAGIC if valid
+  uint8_t band;                     // band of last successful attach
+  uint8_t bands[ATTACH_BAND_COUNT]; // full band list of module, 0 for unused entries
+  char plmn[PLMN_LEN];              // MCC + MNC of last successful attach
+} NBIoT_AttachHint;
+
+// firmware version parsed from AT+CGMR, e.g. V100R100C10B657SP2
+typedef struct {
+  uint16_t version; // V
+  uint16_t release; // R
+  uint16_t code;    // C
+  uint16_t build;   // B
+  uint8_t patch;    // SP, 0 if none
+  uint16_t band;    // MHz of radio variant, e.g. 850 or 900, 0 if unknown
+} NBIoT_FirmwareVersion;
+
+// capabilities of firmware, stored in EEPROM
+typedef struct {
+  uint32_t key;         // FNV-1a hash of AT+CGMR and AT+CGMM output
+  uint8_t capabilities; // CAP_* flags
+} NBIoT_CapabilityCache;
+
+// AT commands kept in flash, see command_table in Sixfab_NBIoT.cpp
+enum NBIoT_Command {
+  CMD_AT,
+  CMD_ATE1,
+  CMD_AT_W,
+  CMD_CGSN,
+  CMD_CGMR,
+  CMD_CGMM,
+  CMD_NCONFIG_READ,
+  CMD_CSQ,
+  CMD_NUESTATS,
+  CMD_NUESTATS_CELL,
+  CMD_CEREG_ON,
+  CMD_CEREG_READ,
+  CMD_COPS_AUTO,
+  CMD_COPS_READ,
+  CMD_CGATT_ON,
+  CMD_NBAND_READ,
+  CMD_CFUN_OFF,
+  CMD_CFUN_ON,
+  CMD_NSOCL_0,
+  CMD_NSOCR_TCP,
+  CMD_NSOSTF_TEST,
+  CMD_NSOCR_TEST,
+  CMD_NATSPEED_TEST,
+  CMD_NPSMR_TEST,
+  CMD_NRB,
+  CMD_CCLK_READ,
+  CMD_CTZR_ON,
+  CMD_COUNT
+};
+
+// expected responses kept in flash, see response_table in Sixfab_NBIoT.cpp
+enum NBIoT_Response {
+  RSP_OK,   // "OK\r\n"
+  RSP_CRLF, // "\r\n"
+  RSP_COUNT
+};
+
+// fields of NBIoT_Snapshot
+#define SNAPSHOT_ACCEL 0x01
+#define SNAPSHOT_TEMPERATURE 0x02
+#define SNAPSHOT_HUMIDITY 0x04
+#define SNAPSHOT_LIGHT 0x08
+#define SNAPSHOT_ALL 0x0F
+
+// one reading of all sensors taken together, see sampleAll()
+typedef struct {
+  uint32_t stamp;      // SixfabTime::monotonic(), or millis(), at start of sampling
+  uint8_t valid;       // SNAPSHOT_* flags of fields that are read
+  int16_t accel[3];    // x, y, z in mg
+  int16_t temperature; // 0.01 C
+  uint16_t humidity;   // 0.01 %RH
+  uint16_t light;      // adc 0-1023
+} NBIoT_Snapshot;
+
+// pins of shield peripherals
+typedef struct {
+  uint8_t user_button;
+  uint8_t user_led;
+  uint8_t bc95_enable;
+  uint8_t als;
+  uint8_t relay;
+} NBIoT_Pins;
+
+static const NBIoT_Pins NBIOT_DEFAULT_PINS = {USER_BUTTON, USER_LED, BC95_ENABLE, ALS_PT19_PIN, RELAY};
+
+// callback type for (re)starting modem serial port at given baud rate
+typedef void (*NBIoT_BaudHandler)(uint32_t baud);
+
+// callback type for health of command engine, progress is false if module didn't respond in time
+typedef void (*NBIoT_HealthHandler)(bool progress, void *context);
+
+// callback type for streaming send, fills [buffer] with at most [max] bytes.
+// returns number of bytes written, 0 when there is no more data.
+typedef uint16_t (*NBIoT_DataSource)(uint8_t *buffer, uint16_t max, void *context);
+
+// callback type for processing lines of a multi-line AT response
+typedef void (*NBIoT_LineHandler)(char *line, void *context);
+
+/*
+Function for starting and getting default debug output of the board. 
+Defined weak by library, it gives NULL on Uno and Mega unless 
+SIXFAB_DEBUG_SERIAL() is in sketch.
+
+[return] : Print* debug output, NULL if board has none
+---
+[param #1] : uint32_t baud rate output is started at, 0 for not starting it
+*/
+Print *debugSerial(uint32_t);
+
 class SixfabNBIoT
 {
   public:
 
+#if defined(BC95_AT)
     /*
-    Default constructer with no parameter
+    Default constructer with no parameter. Uses default serial ports 
+    of the board (BC95_AT, debugSerial()), Wire and default pins.
 
     [no-return]
     ---
     [no-param]
     */
     SixfabNBIoT();
+#endif
+
+    /*
+    Constructor for binding library to any serial port, I2C bus and pins. 
+    Serial ports must be started by caller before init(), or a baud 
+    handler must be set with setBaudHandler().
+
+    [no-return]
+    ---
+    [param #1] : Stream& serial port connected to BC95
+    [param #2] : TwoWire& I2C bus of sensors
+    [param #3] : Print* debug output, NULL for no debug output
+    [param #4] : const NBIoT_Pins& peripheral pins
+    */
+    SixfabNBIoT(Stream &, TwoWire & = Wire, Print * = NULL, const NBIoT_Pins & = NBIOT_DEFAULT_PINS);
     
 /******************************************************************************************
  *** Base Functions : Set or Clear Hardwares - Status Controls - Helper AT Functions  *****
@@ -105,6 +322,90 @@ class SixfabNBIoT
     */
     void disable();
 
+    /*
+    Function for setting the function that starts modem serial port at given 
+    baud rate. init() calls it with BC95_BAUD.
+
+    [no-return]
+    ---
+    [param #1] : NBIoT_BaudHandler baud handler
+    */
+    void setBaudHandler(NBIoT_BaudHandler);
+
+    /*
+    Function for setting the function that is notified of every answered 
+    and timed out transaction, e.g. SixfabSupervisor. Handler is called 
+    inside the command engine, also while sendATComm is resending.
+
+    [no-return]
+    ---
+    [param #1] : NBIoT_HealthHandler health handler
+    [param #2] : void* context that passed to handler
+    */
+    void setHealthHandler(NBIoT_HealthHandler, void *);
+
+    /*
+    Function for setting the function that is given every line read by 
+    command engine that isn't a socket URC, e.g. NITZ time of SixfabTime. 
+    Lines of a query are also passed to its own line handler afterwards.
+
+    [no-return]
+    ---
+    [param #1] : NBIoT_LineHandler URC handler, NULL to remove
+    [param #2] : void* context that passed to handler
+    */
+    void setURCHandler(NBIoT_LineHandler, void *);
+
+    /*
+    Function for switching module to fastest candidate rate that is not faster 
+    than [param #1]. Rates that failed BAUD_ERROR_LIMIT times are skipped. 
+    Needs a baud handler.
+
+    [return] : uint32_t baud rate in use
+    ---
+    [param #1] : uint32_t max baud rate, BAUD_MAX by default
+    */
+    uint32_t negotiateBaud(uint32_t max = BAUD_MAX);
+
+    /*
+    Function for switching module and host to [param #1] with AT+NATSPEED. 
+    Switch is confirmed with BAUD_HANDSHAKE_COUNT AT round trips, both sides 
+    return to old rate if handshake fails.
+
+    [return] : bool true if module responds at new rate
+    ---
+    [param #1] : uint32_t baud rate, one of 4800, 9600, 57600, 115200, 230400
+    */
+    bool setModemBaud(uint32_t);
+
+    /*
+    Function for finding rate of module by probing candidate rates with AT.
+    init() calls it if module doesn't respond at stored rate.
+
+    [return] : uint32_t baud rate of module, 0 if module doesn't respond
+    ---
+    [no-param]
+    */
+    uint32_t recoverBaud();
+
+    /*
+    Function for getting current baud rate of module serial port
+
+    [return] : uint32_t baud rate
+    ---
+    [no-param]
+    */
+    uint32_t getModemBaud();
+
+    /*
+    Function for getting failed switches, probes and timeouts at [param #1]
+
+    [return] : uint16_t error count
+    ---
+    [param #1] : uint32_t baud rate
+    */
+    uint16_t getBaudErrors(uint32_t);
+
     /*
     Function for sending AT [param #1] command to BC95.
     
@@ -114,6 +415,15 @@ class SixfabNBIoT
     */
     void sendATCommOnce(const char *);
 
+    /*
+    Function for sending AT [param #1] command from flash command table to BC95.
+    
+    [no-return]
+    ---
+    [param #1] : NBIoT_Command AT command
+    */
+    void sendATCommOnce(NBIoT_Command);
+
     /*
     Function for sending AT [param #1] command to BC95. If the desired [param #2] 
     response isn't recevived, function resend the AT command wait a time as [timeout].
@@ -125,6 +435,28 @@ class SixfabNBIoT
     [param #3] : const char* AT response word
     */
     const char* sendATComm(const char *, const char *); 
+
+    /*
+    Function for sending AT [param #1] command from flash command table to BC95. 
+    Command is streamed from flash, it doesn't use SRAM.
+    
+    [return] : const char* response of AT command that received from BC95 modem
+    ---
+    [param #1] : NBIoT_Command AT command
+    [param #2] : NBIoT_Response desired response
+    */
+    const char* sendATComm(NBIoT_Command, NBIoT_Response); 
+
+    /*
+    Function for sending composed AT [param #1] command to BC95, desired 
+    response is taken from flash response table.
+    
+    [return] : const char* response of AT command that received from BC95 modem
+    ---
+    [param #1] : const char* AT command word
+    [param #2] : NBIoT_Response desired response
+    */
+    const char* sendATComm(const char *, NBIoT_Response); 
     
     /*
     Function for sending Data [param #1] to BC95. If the desired [param #2] 
@@ -138,6 +470,43 @@ class SixfabNBIoT
     */
     const char* sendDataComm(const char *, const char *);
 
+    /*
+    Function for reading one line of BC95 output. Empty lines are skipped 
+    and line endings are not copied. Line is truncated to [param #2] - 1 chars.
+    
+    [return] : uint8_t length of line, 0 if no line received in [param #3] ms
+    ---
+    [param #1] : char* line buffer
+    [param #2] : uint8_t size of line buffer
+    [param #3] : uint16_t timeout in ms
+    */
+    uint8_t readLine(char *, uint8_t, uint16_t);
+
+    /*
+    Function for sending AT [param #1] command and passing every line of the 
+    response to [param #2] handler until final OK or ERROR is received.
+    Socket URCs received meanwhile are processed and not passed to handler.
+    
+    [return] : bool true if response is terminated with OK
+    ---
+    [param #1] : const char* AT command word, NULL for waiting result of a sent command
+    [param #2] : NBIoT_LineHandler function called for each response line, can be NULL
+    [param #3] : void* context that passed to handler
+    */
+    bool queryLines(const char *, NBIoT_LineHandler, void *);
+
+    /*
+    Function for sending AT [param #1] command from flash command table and 
+    passing every line of the response to [param #2] handler.
+    
+    [return] : bool true if response is terminated with OK
+    ---
+    [param #1] : NBIoT_Command AT command
+    [param #2] : NBIoT_LineHandler function called for each response line, can be NULL
+    [param #3] : void* context that passed to handler
+    */
+    bool queryLines(NBIoT_Command, NBIoT_LineHandler, void *);
+
     /*
     Function for resetting BC95 module and all peripherals.
 
@@ -183,22 +552,78 @@ class SixfabNBIoT
     const char* getHardwareInfo();
 
     /*
-    Function for setting autoconnect feature configuration 
+    Function for setting autoconnect feature configuration. Can be called
+    before init(), then it is applied by reconcileConfig() of init().
+
+    [return] : bool false if value isn't accepted or module rejected it
+    ---
+    [param #1] : const char * autoconnect on / off (AUTO_ON or AUTO_OFF)
+    */
+    bool setAutoConnectConf(const char *);
+
+    /*
+    Function for setting scramble feature configuration. Can be called
+    before init(), then it is applied by reconcileConfig() of init().
+
+    [return] : bool false if value isn't accepted or module rejected it
+    ---
+    [param #1] : const char * scramble on / off (SCRAMBLE_ON or SCRAMBLE_OFF)
+    */
+    bool setScrambleConf(const char *);
+
+    /*
+    Function for applying desired NCONFIG settings (autoconnect, scramble) to BC95.
+    Current settings are read once with AT+NCONFIG? and only differing items 
+    are written. Hash of applied set is stored in EEPROM, so if desired set isn't 
+    changed since last boot, modem isn't queried at all.
+
+    [return] : uint8_t number of settings written to module
+    ---
+    [no-param]
+    */
+    uint8_t reconcileConfig();
+
+    /*
+    Function for forgetting stored config hash. Next reconcileConfig() call 
+    queries the module again. (e.g. after replacing or factory resetting module)
 
     [no-return]
     ---
-    [param #1] : const char * Scramble on / off ( '0' is on, '1' is off)
+    [no-param]
+    */
+    void invalidateConfigCache();
+
+    /*
+    Function for detecting features of module firmware. AT+CGMR and AT+CGMM 
+    are parsed, features are tested with AT test commands only if firmware 
+    is changed since the capabilities stored in EEPROM. init() calls it. 
+    A feature is cleared only if module answers its test with ERROR, if a 
+    test isn't answered the feature is kept and result isn't stored.
+
+    [return] : uint8_t CAP_* flags
+    ---
+    [no-param]
     */
-    void setAutoConnectConf(const char *);
+    uint8_t probeCapabilities();
 
     /*
-    Function for setting scramble feature configuration 
+    Function for checking if module firmware supports [param #1]. All 
+    features are assumed to be supported before probeCapabilities().
+
+    [return] : bool true if supported
+    ---
+    [param #1] : uint8_t CAP_* flag
+    */
+    bool hasCapability(uint8_t);
+
+    /*
+    Function for getting firmware version parsed by probeCapabilities()
 
     [no-return]
     ---
-    [param #1] : const char * Scramble on / off ( '0' is on, '1' is off)
+    [param #1] : NBIoT_FirmwareVersion* output
     */
-    void setScrambleConf(const char *);
+    void getFirmwareVersion(NBIoT_FirmwareVersion *);
 
     /*
     Function for getting described ip address
@@ -279,20 +704,91 @@ class SixfabNBIoT
     /*
     Function for getting signal quality
 
-    [return] : const char* signal quality
+    [return] : const char* raw response of AT+CSQ
     ---
     [no-param]
     */
     const char* getSignalQuality();
 
+    /*
+    Function for reading parsed signal quality (AT+CSQ)
+
+    [return] : bool true if a valid +CSQ line is received
+    ---
+    [param #1] : NBIoT_SignalQuality* output
+    */
+    bool readSignalQuality(NBIoT_SignalQuality *);
+
+    /*
+    Function for reading parsed radio statistics (AT+NUESTATS). 
+    Check fields member of output for parsed values.
+
+    [return] : bool true if response is terminated with OK
+    ---
+    [param #1] : NBIoT_UEStats* output
+    */
+    bool readUEStats(NBIoT_UEStats *);
+
+    /*
+    Function for reading serving cell statistics (AT+NUESTATS=CELL).
+    Primary cell is returned, first listed cell if none is marked as primary.
+
+    [return] : bool true if at least one cell is listed
+    ---
+    [param #1] : NBIoT_CellStats* output
+    */
+    bool readCellStats(NBIoT_CellStats *);
+
    /*
-    Function for connecting to base station of operator
+    Function for connecting to base station of operator.
+    Band and operator of last successful attach are tried first, full scan 
+    is started if module isn't registered in ATTACH_HINT_TIMEOUT. Registration 
+    is followed with +CEREG URCs.
+
+    [return] : bool false if attach deadline is expired
+    ---
+    [no-param]
+    */
+    bool connectToOperator();
+
+    /*
+    Function for setting overall attach deadline
 
     [no-return]
     ---
+    [param #1] : uint32_t deadline in ms, 0 for waiting until attached, at most ATTACH_TIMEOUT_MAX
+    */
+    void setAttachDeadline(uint32_t);
+
+    /*
+    Function for getting duration of last attach in this boot
+
+    [return] : uint32_t attach duration in ms, 0 if not attached yet
+    ---
     [no-param]
     */
-    void connectToOperator();
+    uint32_t getAttachTime();
+
+    /*
+    Function for forgetting stored band and operator, next attach makes full scan.
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void clearAttachHint();
+
+    /*
+    Function for requesting power saving mode timers from network with 
+    AT+CPSMS. Timers are coded in smallest unit that holds them, rounded 
+    up. Network may grant other values.
+
+    [return] : bool true if module accepted request
+    ---
+    [param #1] : uint32_t periodic TAU (T3412) in s, 0 for turning PSM off
+    [param #2] : uint32_t active time (T3324) in s
+    */
+    bool setPSM(uint32_t, uint32_t);
    
 /******************************************************************************************
  *** TCP & UDP Protocols Functions ********************************************************
@@ -316,6 +812,19 @@ class SixfabNBIoT
     */
     void sendDataUDP(const char *);
 
+    /*
+    Function for sending binary data via UDP protocol. 
+    First use setIPAddress and setPort functions before 
+    try to send data with this function.  
+
+    [return] : bool true if module accepted datagram, false if [param #2] 
+    is longer than UDP_DATA_LEN or module returned error
+    ---
+    [param #1] : const uint8_t* data
+    [param #2] : uint16_t data length
+    */
+    bool sendDataUDP(const uint8_t *, uint16_t);
+
     /* 
     Function for closing server connection
     
@@ -325,6 +834,112 @@ class SixfabNBIoT
     */
     void closeConnection();
 
+    /*
+    Function for receiving data of UDP socket. Data is decoded from module 
+    output directly into [param #1], no intermediate buffer is used.
+
+    [return] : int16_t number of bytes written to [param #1], -1 on error
+    ---
+    [param #1] : uint8_t* buffer
+    [param #2] : uint16_t size of buffer
+    */
+    int16_t receiveDataUDP(uint8_t *, uint16_t);
+
+    /*
+    Function for connecting to server via TCP. Uses address of setIPAddress 
+    and setPort. Module firmware must support TCP.
+
+    [return] : bool true if connected
+    ---
+    [no-param]
+    */
+    bool connectTCP();
+
+    /*
+    Function for sending data via TCP from a data source callback. Data is 
+    taken in TCP_CHUNK_LEN pieces and hex encoded directly to module, so 
+    whole payload is never buffered. At most TCP_WINDOW segments are left 
+    unacknowledged by server.
+
+    [return] : bool true if all data is accepted by module
+    ---
+    [param #1] : NBIoT_DataSource data source
+    [param #2] : void* context that passed to data source
+    */
+    bool sendDataTCP(NBIoT_DataSource, void *);
+
+    /*
+    Function for sending buffer via TCP. 
+
+    [return] : bool true if all data is accepted by module
+    ---
+    [param #1] : const uint8_t* data
+    [param #2] : uint16_t data length
+    */
+    bool sendDataTCP(const uint8_t *, uint16_t);
+
+    /*
+    Function for waiting acknowledge of all sent TCP segments
+
+    [return] : bool true if all segments are acknowledged, waiting at most 
+    TCP_ACK_TIMEOUT for each
+    ---
+    [no-param]
+    */
+    bool flushTCP();
+
+    /*
+    Function for receiving data of TCP socket. Data is decoded from module 
+    output directly into [param #1], no intermediate buffer is used.
+
+    [return] : int16_t number of bytes written to [param #1], -1 on error
+    ---
+    [param #1] : uint8_t* buffer
+    [param #2] : uint16_t size of buffer
+    */
+    int16_t receiveDataTCP(uint8_t *, uint16_t);
+
+    /*
+    Function for closing TCP connection
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void closeTCP();
+
+    /*
+    Function for getting length of data that module notified with +NSONMI 
+    and not read yet.
+
+    [return] : uint16_t bytes waiting in module
+    ---
+    [param #1] : uint8_t socket
+    */
+    uint16_t pendingData(uint8_t);
+
+    /*
+    Function for waiting +NSONMI of a socket for [param #2] ms. Other URCs 
+    are processed meanwhile.
+
+    [return] : bool true if data is waiting in module
+    ---
+    [param #1] : uint8_t socket
+    [param #2] : uint16_t max wait in ms
+    */
+    bool waitData(uint8_t, uint16_t);
+
+    /*
+    Function for receiving data of a socket with AT+NSORF.
+
+    [return] : int16_t number of bytes written to [param #2], -1 on error
+    ---
+    [param #1] : uint8_t socket
+    [param #2] : uint8_t* buffer
+    [param #3] : uint16_t size of buffer
+    */
+    int16_t receiveData(uint8_t, uint8_t *, uint16_t);
+
 
 /******************************************************************************************
  *** Peripheral Devices' Functions : Read sensors - Set Relay and LEDs ********************
@@ -360,7 +975,43 @@ class SixfabNBIoT
     double readHum();
 
     /* 
-    Function for reading raw adc data from light sensor.
+    Function for reading all sensors at once, in integers. HDC1080 converts 
+    temperature and humidity together while accelerometer and light sensor 
+    are read, so a snapshot takes about HDC1080_CONVERSION_TIME ms. Fields 
+    of failed sensors are 0 and their flags are cleared. If SixfabLight is 
+    used by sketch, light must be read through it, a batch that is started 
+    by sketch is waited and taken by snapshot.
+    
+    [return] : uint8_t SNAPSHOT_* flags of valid fields
+    ---
+    [param #1] : NBIoT_Snapshot* output
+    [param #2] : SixfabTime* stamp source, NULL for millis()
+    [param #3] : SixfabLight* light sensor driver, NULL for analogRead()
+    */
+    uint8_t sampleAll(NBIoT_Snapshot *, SixfabTime * = NULL, SixfabLight * = NULL);
+
+    /* 
+    Function for getting I2C bus of sensors, e.g. for error counters. 
+    It is sixfabI2C, shared with sensors created without a bus.
+    
+    [return] : SixfabI2CBus& bus
+    ---
+    [no-param]
+    */
+    SixfabI2CBus &getI2CBus();
+
+    /* 
+    Function for getting accelerometer, e.g. for SixfabMotion events.
+    
+    [return] : MMA8452Q& accelerometer
+    ---
+    [no-param]
+    */
+    MMA8452Q &getAccel();
+
+    /* 
+    Function for reading raw adc data from light sensor. 
+    See SixfabLight for oversampled readings in lux.
     
     [return] : double light adc 0-1023
     ---
@@ -414,6 +1065,19 @@ class SixfabNBIoT
     void turnOffUserLED();
 
   private:
+    Stream &modem; // serial port of BC95
+    Print *debug; // debug output, drained from log buffer
+    NBIoT_Pins pins; // peripheral pins
+    TwoWire &wire; // I2C port of sensors, sixfabI2C is moved to it in init()
+    NBIoT_BaudHandler baud_handler = NULL;
+    NBIoT_HealthHandler health_handler = NULL;
+    void *health_context = NULL;
+    NBIoT_LineHandler urc_handler = NULL;
+    void *urc_context = NULL;
+    Sixfab_HDC1080 hdc1080;
+    MMA8452Q accel;
+
+    char response[AT_RESPONSE_LEN]; // module response for AT commands. 
     char compose[300];
     char data_hex[200];
 
@@ -421,6 +1085,20 @@ class SixfabNBIoT
     char domain_name[DOMAIN_NAME_LEN]; // domain name   
     char port_number[PORT_NUMBER_LEN]; // port number 
     uint16_t timeout = TIMEOUT; // default timeout for function and methods on this library.
+    uint8_t config_target = (1 << NCONFIG_AUTOCONNECT) | (1 << NCONFIG_SCRAMBLING); // desired NCONFIG values, bit per NBIoT_ConfigItem set for TRUE
+    bool initialized = false; // init() has run
+    bool rejected = false; // last read_result() ended with ERROR or +CME ERROR, not timeout
+    uint32_t attach_deadline = ATTACH_DEADLINE; // overall attach deadline in ms
+    uint32_t attach_time = 0; // duration of last attach in ms
+    int8_t tcp_socket = -1; // socket id of TCP connection
+    uint8_t tcp_sequence = 0; // last used NSOSD sequence number
+    uint8_t tcp_unacked = 0; // segments waiting for +NSOSTR
+    bool tcp_failed = false; // a segment is reported as failed
+    uint16_t rx_pending[SOCKET_COUNT] = {0}; // lengths notified by +NSONMI
+    uint32_t modem_baud = BC95_BAUD; // current rate of module serial port
+    uint16_t baud_errors[BAUD_RATE_COUNT] = {0}; // errors per candidate rate
+    uint8_t capabilities = CAP_ALL; // CAP_* flags of module firmware
+    NBIoT_FirmwareVersion firmware = {0, 0, 0, 0, 0, 0};
 
 /******************************************************************************************
  *** Private Functions that be used in public methods, in order to ease the operations ****
@@ -437,6 +1115,19 @@ class SixfabNBIoT
         memset(compose,0,sizeof(compose));
     }
 
+    /* 
+    Function for notifying health handler of a transaction result.
+    
+    [no-return]
+    ---
+    [param #1] : bool true if module responded
+    */
+    void report_health(bool progress)
+    {
+        if(health_handler)
+            health_handler(progress, health_context);
+    }
+
     /* 
     Function for clear data_hex #private param : data_hex[200].
     
@@ -449,6 +1140,140 @@ class SixfabNBIoT
         memset(data_hex,0,sizeof(data_hex));
     }
 
+    /* 
+    Function for waiting [param #2] response. [param #1] is resent in every timeout.
+    
+    [return] : const char* response
+    ---
+    [param #1] : const char* command that resent
+    [param #2] : const char* desired response
+    [param #3] : uint8_t WAIT_* flags
+    */
+    const char* wait_response(const char *, const char *, uint8_t);
+
+    /* 
+    Function for sending command of wait_response.
+    
+    [no-return]
+    ---
+    [param #1] : const char* command
+    [param #2] : uint8_t WAIT_* flags
+    */
+    void send_command(const char *, uint8_t);
+
+    /* 
+    Function for reading response lines until final OK or ERROR.
+    
+    [return] : bool true if response is terminated with OK
+    ---
+    [param #1] : NBIoT_LineHandler function called for each response line, can be NULL
+    [param #2] : void* context that passed to handler
+    */
+    bool read_result(NBIoT_LineHandler, void *);
+
+    /* 
+    Function for processing unsolicited result codes of sockets. Other 
+    lines are given to URC handler.
+    
+    [return] : bool true if line is a known URC and consumed
+    ---
+    [param #1] : char* line
+    */
+    bool handle_urc(char *);
+
+    /* 
+    Function for checking if module responds to AT at current host rate.
+    
+    [return] : bool true if OK is received
+    ---
+    [param #1] : uint8_t max AT commands sent
+    */
+    bool probe_modem(uint8_t);
+
+    /* 
+    Function for counting an error at [param #1].
+    
+    [no-return]
+    ---
+    [param #1] : uint32_t baud rate
+    */
+    void count_baud_error(uint32_t);
+
+    /* 
+    Function for reading a byte from module in [param #1] ms.
+    
+    [return] : int byte, -1 on timeout
+    ---
+    [param #1] : uint16_t timeout in ms
+    */
+    int read_byte(uint16_t);
+
+    /* 
+    Function for waiting final result of a socket command, URCs are processed meanwhile.
+    
+    [return] : bool true if OK is received
+    ---
+    [no-param]
+    */
+    bool wait_result();
+
+    /* 
+    Function for waiting registration to home network or roaming. 
+    
+    [return] : bool true if registered
+    ---
+    [param #1] : uint32_t max wait in ms, 0 for no limit
+    */
+    bool wait_registration(uint32_t);
+
+    /* 
+    Function for setting band list of module. Radio is turned off during change.
+    
+    [no-return]
+    ---
+    [param #1] : const uint8_t* band list, 0 terminated if shorter than [param #2]
+    [param #2] : uint8_t max length of band list
+    */
+    void set_bands(const uint8_t *, uint8_t);
+
+    /* 
+    Function for storing current band and operator as attach hint.
+    
+    [no-return]
+    ---
+    [param #1] : NBIoT_AttachHint* hint loaded at boot, updated in place
+    */
+    void save_attach_hint(NBIoT_AttachHint *);
+
+    /* 
+    Function for writing desired value of NCONFIG item to module.
+    
+    [return] : bool false if module didn't answer OK
+    ---
+    [param #1] : NBIoT_ConfigItem config item
+    */
+    bool write_config(NBIoT_ConfigItem);
+
+    /* 
+    Function for changing desired value of NCONFIG item. Written to module
+    at once after init(), stored hash is updated if module had whole set.
+    
+    [return] : bool false if value isn't "TRUE" / "FALSE" or module rejected it
+    ---
+    [param #1] : NBIoT_ConfigItem config item
+    [param #2] : const char* value
+    */
+    bool set_config(NBIoT_ConfigItem, const char *);
+
+    /* 
+    Function for calculating FNV-1a hash of desired NCONFIG set.
+    
+    [return] : uint32_t hash
+    ---
+    [no-param]
+    */
+    uint32_t config_hash();
+
     /* 
     Function for convert string data to hex data
     
@@ -458,8 +1283,21 @@ class SixfabNBIoT
     */
     void convert_data_str_to_hex( const char *data )
     {
-        int i;
-        for (i = 0; i < strlen(data); i++){
+        convert_data_bin_to_hex((const uint8_t *)data, strlen(data));
+    }
+
+    /* 
+    Function for convert binary data to hex data
+    
+    [no-return]
+    ---
+    [param #1] : const uint8_t* data
+    [param #2] : uint16_t data length
+    */
+    void convert_data_bin_to_hex( const uint8_t *data, uint16_t len )
+    {
+        uint16_t i;
+        for (i = 0; i < len; i++){
             sprintf(data_hex+i*2, "%02X", data[i] );
         }
     }
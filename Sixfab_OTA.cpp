@@ -0,0 +1,283 @@
+/*
+  Sixfab_OTA.cpp
+  -
+  Firmware download client for Sixfab Arduino NBIoT Shield.
+*/
+
+#include "Sixfab_OTA.h"
+
+static void put_u16(uint8_t *p, uint16_t value)
+{
+  p[0] = value >> 8;
+  p[1] = value;
+}
+
+static void put_u32(uint8_t *p, uint32_t value)
+{
+  put_u16(p, value >> 16);
+  put_u16(p + 2, value);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+  return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+  return ((uint32_t)get_u16(p) << 16) | get_u16(p + 2);
+}
+
+// CRC-16/CCITT-FALSE of chunk data
+static uint16_t crc16(const uint8_t *data, uint16_t len)
+{
+  uint16_t crc = 0xFFFF;
+
+  while(len--){
+    crc ^= (uint16_t)*data++ << 8;
+    for(uint8_t i = 0; i < 8; i++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// CRC-32 (IEEE 802.3), continued from crc of previous data, 0 at start
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint16_t len)
+{
+  crc = ~crc;
+  while(len--){
+    crc ^= *data++;
+    for(uint8_t i = 0; i < 8; i++)
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+SixfabOTA::SixfabOTA(SixfabNBIoT &node, NBIoT_ImageWriter writer, NBIoT_ImageReader reader, void *context)
+  : node(node), writer(writer), reader(reader), context(context)
+{
+  memset(&manifest, 0, sizeof(manifest));
+  memset(&state, 0, sizeof(state));
+  chunk_timeout = OTA_CHUNK_TIMEOUT;
+  requests_sent = chunks_received = chunks_duplicate = chunks_corrupt = 0;
+}
+
+// ask server for manifest of newer image
+bool SixfabOTA::checkUpdate(uint32_t current_version)
+{
+  for(uint8_t tries = 0; tries < OTA_RETRY_LIMIT; tries++){
+    packet[0] = 'M';
+    put_u32(packet + 1, current_version);
+    node.sendDataUDP(packet, 5);
+    requests_sent++;
+
+    int16_t len;
+    while((len = receive_packet(chunk_timeout)) > 0){
+      if(len < 13 || packet[0] != 'M')
+        continue; // stale chunk of an old request
+
+      manifest.magic = OTA_STATE_ACTIVE;
+      manifest.window = 0;
+      manifest.next = 0;
+      manifest.version = get_u32(packet + 1);
+      manifest.size = get_u32(packet + 5);
+      manifest.crc = get_u32(packet + 9);
+
+      if(manifest.size == 0 || manifest.version == current_version){
+        manifest.magic = 0;
+        return false;
+      }
+      LOG_INFO("OTA", "v%lu %lu bytes", (unsigned long)manifest.version, (unsigned long)manifest.size);
+      return true;
+    }
+  }
+  return false;
+}
+
+// download image of manifest, resumed from stored state
+NBIoT_OTAStatus SixfabOTA::download()
+{
+  storageGet(EEPROM_OTA_STATE, state);
+
+  bool stored = (state.magic == OTA_STATE_ACTIVE || state.magic == OTA_STATE_DONE);
+  if(manifest.magic){
+    // stored state belongs to another image
+    if(!stored || state.version != manifest.version || state.size != manifest.size || state.crc != manifest.crc){
+      state = manifest;
+      storagePut(EEPROM_OTA_STATE, state);
+    }
+  }
+  else if(!stored){
+    return OTA_NO_UPDATE;
+  }
+
+  if(state.magic == OTA_STATE_DONE)
+    return OTA_DONE;
+
+  uint16_t count = chunk_count();
+  uint8_t retries = 0;
+
+  while(state.next < count){
+    uint16_t first = state.next;
+    uint8_t wanted = ~state.window;
+    if(count - first < OTA_WINDOW)
+      wanted &= (1 << (count - first)) - 1; // no chunks past end of image
+
+    packet[0] = 'C';
+    put_u32(packet + 1, state.version);
+    put_u16(packet + 5, first);
+    packet[7] = wanted;
+    node.sendDataUDP(packet, 8);
+    requests_sent++;
+
+    bool progress = false;
+    bool complete = false;
+    int16_t len;
+    while(!complete && (len = receive_packet(chunk_timeout)) > 0){
+      int8_t result = accept_chunk(len);
+      if(result < 0)
+        return OTA_WRITE_ERROR;
+      if(result)
+        progress = true;
+
+      complete = true;
+      for(uint8_t i = 0; i < OTA_WINDOW; i++){
+        if((wanted & (1 << i)) && !written(first + i))
+          complete = false;
+      }
+    }
+
+    if(progress){
+      retries = 0;
+    }
+    else if(++retries >= OTA_RETRY_LIMIT){
+      LOG_WARN("OTA", "interrupted at %u", state.next);
+      return OTA_INTERRUPTED;
+    }
+  }
+
+  if(!verify()){
+    LOG_ERROR("OTA", "bad image");
+    reset();
+    return OTA_BAD_IMAGE;
+  }
+
+  state.magic = OTA_STATE_DONE;
+  storagePut(EEPROM_OTA_STATE, state);
+  LOG_INFO("OTA", "done");
+  return OTA_DONE;
+}
+
+// forget stored download
+void SixfabOTA::reset()
+{
+  memset(&state, 0, sizeof(state));
+  storagePut(EEPROM_OTA_STATE, state);
+}
+
+uint32_t SixfabOTA::getVersion()
+{
+  return state.magic ? state.version : manifest.version;
+}
+
+uint32_t SixfabOTA::getSize()
+{
+  return state.magic ? state.size : manifest.size;
+}
+
+uint32_t SixfabOTA::getProgress()
+{
+  if(!state.magic)
+    return 0;
+
+  uint32_t done = (uint32_t)state.next * OTA_CHUNK_LEN;
+  return (done < state.size) ? done : state.size;
+}
+
+void SixfabOTA::setChunkTimeout(uint16_t wait)
+{
+  chunk_timeout = wait;
+}
+
+// read next datagram of server, 0 if nothing is received in wait ms
+int16_t SixfabOTA::receive_packet(uint16_t wait)
+{
+  // more datagrams can be waiting after a single +NSONMI
+  int16_t len = node.receiveDataUDP(packet, sizeof(packet));
+  if(len != 0)
+    return len;
+
+  if(!node.waitData(0, wait))
+    return 0;
+  return node.receiveDataUDP(packet, sizeof(packet));
+}
+
+// check and store received chunk. 1 if written, 0 if ignored, -1 if writer failed
+int8_t SixfabOTA::accept_chunk(int16_t len)
+{
+  if(len < OTA_HEADER_LEN || packet[0] != 'D' || get_u32(packet + 1) != state.version)
+    return 0; // manifest or chunk of another image
+
+  uint16_t index = get_u16(packet + 5);
+  uint16_t data_len = len - OTA_HEADER_LEN;
+
+  if(index >= chunk_count() || data_len != chunk_len(index)){
+    chunks_corrupt++;
+    return 0;
+  }
+  if(written(index)){
+    chunks_duplicate++;
+    return 0;
+  }
+  if(index - state.next >= OTA_WINDOW)
+    return 0; // out of window, requested again later
+
+  if(crc16(packet + OTA_HEADER_LEN, data_len) != get_u16(packet + 7)){
+    chunks_corrupt++;
+    return 0;
+  }
+  if(!writer((uint32_t)index * OTA_CHUNK_LEN, packet + OTA_HEADER_LEN, data_len, context))
+    return -1;
+
+  chunks_received++;
+  state.window |= 1 << (index - state.next);
+  while(state.window & 1){
+    state.window >>= 1;
+    state.next++;
+  }
+  storagePut(EEPROM_OTA_STATE, state);
+  return 1;
+}
+
+// check if chunk is already in storage
+bool SixfabOTA::written(uint16_t index)
+{
+  if(index < state.next)
+    return true;
+  return index - state.next < OTA_WINDOW && (state.window & (1 << (index - state.next)));
+}
+
+uint16_t SixfabOTA::chunk_count()
+{
+  return (state.size + OTA_CHUNK_LEN - 1) / OTA_CHUNK_LEN;
+}
+
+uint16_t SixfabOTA::chunk_len(uint16_t index)
+{
+  uint32_t left = state.size - (uint32_t)index * OTA_CHUNK_LEN;
+  return (left < OTA_CHUNK_LEN) ? left : OTA_CHUNK_LEN;
+}
+
+// compare CRC-32 of stored image with manifest
+bool SixfabOTA::verify()
+{
+  uint32_t crc = 0;
+
+  for(uint32_t offset = 0; offset < state.size; offset += OTA_CHUNK_LEN){
+    uint16_t len = chunk_len(offset / OTA_CHUNK_LEN);
+    if(!reader(offset, packet, len, context))
+      return false;
+    crc = crc32_update(crc, packet, len);
+  }
+  return crc == state.crc;
+}
@@ -0,0 +1,160 @@
+/*
+  Sixfab_OTA.h
+  -
+  Firmware download client for Sixfab Arduino NBIoT Shield. Image is
+  fetched over the UDP socket in chunks and passed to a writer function,
+  e.g. external SPI flash or upper flash half through the bootloader.
+  Each chunk is checked with CRC-16 and the whole image with CRC-32.
+  Download state is kept in EEPROM, an interrupted download continues
+  from the first missing chunk and completed chunks are never requested
+  again.
+
+  Datagrams, integers are big endian :
+    'M' version(4)                               : manifest request, version is running firmware
+    'M' version(4) size(4) crc32(4)              : manifest, size 0 if no update
+    'C' version(4) first(2) wanted(1)            : chunk request, bit n of wanted is chunk first + n
+    'D' version(4) index(2) crc16(2) data        : chunk, data is OTA_CHUNK_LEN bytes except last chunk
+*/
+
+#ifndef _SIXFAB_OTA_H
+#define _SIXFAB_OTA_H
+
+#include "Sixfab_NBIoT.h"
+
+#ifndef OTA_CHUNK_LEN
+  #define OTA_CHUNK_LEN 64 // image bytes per chunk, max UDP_DATA_LEN - OTA_HEADER_LEN
+#endif
+#define OTA_HEADER_LEN 9 // header bytes of chunk datagram
+#define OTA_WINDOW 8 // chunks requested at once
+#define OTA_CHUNK_TIMEOUT 5000 // ms waited for next chunk of a request
+#define OTA_RETRY_LIMIT 3 // requests without any new chunk before download() gives up
+#define OTA_STATE_ACTIVE 0xB5 // download is in progress
+#define OTA_STATE_DONE 0xB6 // image is complete and verified
+
+enum NBIoT_OTAStatus {
+  OTA_DONE,        // image is complete and verified
+  OTA_NO_UPDATE,   // no manifest, call checkUpdate() first
+  OTA_INTERRUPTED, // server stopped responding, call download() again to resume
+  OTA_BAD_IMAGE,   // image CRC-32 doesn't match, download is restarted on next call
+  OTA_WRITE_ERROR  // writer failed, download is resumed on next call
+};
+
+// download state, stored in EEPROM after each written chunk
+typedef struct {
+  uint8_t magic;    // OTA_STATE_ACTIVE or OTA_STATE_DONE if valid
+  uint8_t window;   // bit n : chunk next + n is already written
+  uint16_t next;    // first chunk that isn't written
+  uint32_t version; // version of image
+  uint32_t size;    // image size in bytes
+  uint32_t crc;     // CRC-32 of image
+} NBIoT_OTAState;
+
+// writes / reads [len] image bytes at [offset] of image storage, false on failure
+typedef bool (*NBIoT_ImageWriter)(uint32_t offset, const uint8_t *data, uint16_t len, void *context);
+typedef bool (*NBIoT_ImageReader)(uint32_t offset, uint8_t *data, uint16_t len, void *context);
+
+class SixfabOTA
+{
+  public:
+
+    /*
+    Constructor. UDP service of node must be started and server address
+    must be set with setIPAddress and setPort.
+
+    [no-return]
+    ---
+    [param #1] : SixfabNBIoT& initialized node
+    [param #2] : NBIoT_ImageWriter function that stores chunks
+    [param #3] : NBIoT_ImageReader function that reads stored image back for verification
+    [param #4] : void* context that passed to writer and reader
+    */
+    SixfabOTA(SixfabNBIoT &, NBIoT_ImageWriter, NBIoT_ImageReader, void *);
+
+    /*
+    Function for asking server if an image newer than [param #1] exists.
+
+    [return] : bool true if an update is available
+    ---
+    [param #1] : uint32_t version of running firmware
+    */
+    bool checkUpdate(uint32_t);
+
+    /*
+    Function for downloading image of last manifest. If checkUpdate() isn't
+    called in this boot, stored download is resumed.
+
+    [return] : NBIoT_OTAStatus result
+    ---
+    [no-param]
+    */
+    NBIoT_OTAStatus download();
+
+    /*
+    Function for forgetting stored download, next download starts from first chunk.
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void reset();
+
+    /*
+    Function for getting version of image being downloaded
+
+    [return] : uint32_t version, 0 if no download
+    ---
+    [no-param]
+    */
+    uint32_t getVersion();
+
+    /*
+    Function for getting size of image being downloaded
+
+    [return] : uint32_t size in bytes
+    ---
+    [no-param]
+    */
+    uint32_t getSize();
+
+    /*
+    Function for getting bytes written without a gap from start of image
+
+    [return] : uint32_t downloaded bytes
+    ---
+    [no-param]
+    */
+    uint32_t getProgress();
+
+    /*
+    Function for setting max wait for a chunk.
+
+    [no-return]
+    ---
+    [param #1] : uint16_t wait in ms
+    */
+    void setChunkTimeout(uint16_t);
+
+    uint32_t requests_sent;     // manifest and chunk requests
+    uint32_t chunks_received;   // chunks written to storage
+    uint32_t chunks_duplicate;  // chunks received again, not written
+    uint32_t chunks_corrupt;    // chunks with bad CRC-16 or length
+
+  private:
+    SixfabNBIoT &node;
+    NBIoT_ImageWriter writer;
+    NBIoT_ImageReader reader;
+    void *context;
+    NBIoT_OTAState manifest; // manifest received in this boot, magic is 0 if none
+    NBIoT_OTAState state;
+    uint16_t chunk_timeout;
+    uint8_t packet[OTA_HEADER_LEN + OTA_CHUNK_LEN];
+
+    int16_t receive_packet(uint16_t wait);
+    int8_t accept_chunk(int16_t len);
+    bool written(uint16_t index);
+    uint16_t chunk_count();
+    uint16_t chunk_len(uint16_t index);
+    bool verify();
+};
+
+#endif
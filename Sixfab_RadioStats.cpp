@@ -0,0 +1,429 @@
+/*
+  Sixfab_RadioStats.cpp
+  -
+  Parsers for BC95 radio metrics and link quality monitor.
+*/
+
+#include "Sixfab_RadioStats.h"
+#include <string.h>
+
+// NUESTATS field names, order is irrelevant
+static const char field_rsrp[] PROGMEM = "Signal power";
+static const char field_total_power[] PROGMEM = "Total power";
+static const char field_tx_power[] PROGMEM = "TX power";
+static const char field_tx_time[] PROGMEM = "TX time";
+static const char field_rx_time[] PROGMEM = "RX time";
+static const char field_cell_id[] PROGMEM = "Cell ID";
+static const char field_ecl[] PROGMEM = "ECL";
+static const char field_snr[] PROGMEM = "SNR";
+static const char field_earfcn[] PROGMEM = "EARFCN";
+static const char field_pci[] PROGMEM = "PCI";
+static const char field_rsrq[] PROGMEM = "RSRQ";
+static const char field_band[] PROGMEM = "CURRENT BAND";
+
+static const struct {
+  const char *name;
+  uint16_t flag;
+} uestats_fields[] PROGMEM = {
+  {field_rsrp, UESTATS_RSRP},
+  {field_total_power, UESTATS_TOTAL_POWER},
+  {field_tx_power, UESTATS_TX_POWER},
+  {field_tx_time, UESTATS_TX_TIME},
+  {field_rx_time, UESTATS_RX_TIME},
+  {field_cell_id, UESTATS_CELL_ID},
+  {field_ecl, UESTATS_ECL},
+  {field_snr, UESTATS_SNR},
+  {field_earfcn, UESTATS_EARFCN},
+  {field_pci, UESTATS_PCI},
+  {field_rsrq, UESTATS_RSRQ},
+  {field_band, UESTATS_BAND},
+};
+
+// parse unsigned decimal at *s and advance *s, fails on no digit or value > max
+static bool parse_uint(const char **s, uint32_t max, uint32_t *out)
+{
+  const char *p = *s;
+  uint32_t value = 0;
+
+  if(*p < '0' || *p > '9')
+    return false;
+
+  while(*p >= '0' && *p <= '9'){
+    uint32_t digit = *p++ - '0';
+    if(digit > max || value > (max - digit) / 10)
+      return false;
+    value = value * 10 + digit;
+  }
+  *s = p;
+  *out = value;
+  return true;
+}
+
+// parse signed decimal that fits int16_t at *s and advance *s
+static bool parse_int16(const char **s, int16_t *out)
+{
+  const char *p = *s;
+  bool negative = (*p == '-');
+  uint32_t value;
+
+  if(negative)
+    p++;
+  if(!parse_uint(&p, negative ? 32768UL : 32767UL, &value))
+    return false;
+
+  *out = negative ? (int16_t)(-(int32_t)value) : (int16_t)value;
+  *s = p;
+  return true;
+}
+
+// skip expected character
+static bool expect(const char **s, char c)
+{
+  if(**s != c)
+    return false;
+  (*s)++;
+  return true;
+}
+
+// skip prefix (in flash) if line starts with it
+static bool skip_prefix(const char **s, PGM_P prefix)
+{
+  size_t len = strlen_P(prefix);
+  if(strncmp_P(*s, prefix, len) != 0)
+    return false;
+  *s += len;
+  return true;
+}
+
+// parse "+CSQ:<rssi>,<ber>"
+bool parseSignalQuality(const char *line, NBIoT_SignalQuality *out)
+{
+  uint32_t rssi, ber;
+
+  if(!skip_prefix(&line, PSTR("+CSQ:")))
+    return false;
+  if(!parse_uint(&line, CSQ_UNKNOWN, &rssi) || !expect(&line, ','))
+    return false;
+  if(!parse_uint(&line, CSQ_UNKNOWN, &ber) || *line != '\0')
+    return false;
+  if((rssi > 31 && rssi != CSQ_UNKNOWN) || (ber > 7 && ber != CSQ_UNKNOWN))
+    return false;
+
+  out->rssi = rssi;
+  out->ber = ber;
+  out->rssi_dbm = (rssi == CSQ_UNKNOWN) ? 0 : -113 + 2 * (int16_t)rssi;
+  return true;
+}
+
+// parse "<Name>:<value>" (old firmware) or "NUESTATS:RADIO,<Name>,<value>" (new firmware)
+bool parseUEStatsLine(const char *line, NBIoT_UEStats *out)
+{
+  char separator = ':';
+
+  skip_prefix(&line, PSTR("+"));
+  if(skip_prefix(&line, PSTR("NUESTATS:RADIO,")))
+    separator = ',';
+
+  for(uint8_t i = 0; i < sizeof(uestats_fields) / sizeof(uestats_fields[0]); i++){
+    const char *p = line;
+    uint16_t flag = pgm_read_word(&uestats_fields[i].flag);
+    uint32_t u = 0;
+    int16_t v = 0;
+    bool ok;
+
+    if(!skip_prefix(&p, (PGM_P)pgm_read_ptr(&uestats_fields[i].name)) || !expect(&p, separator))
+      continue;
+
+    switch(flag){
+      case UESTATS_TX_TIME:
+      case UESTATS_RX_TIME:
+      case UESTATS_CELL_ID:
+      case UESTATS_EARFCN:
+        ok = parse_uint(&p, 0xFFFFFFFFUL, &u);
+        break;
+      case UESTATS_ECL:
+        ok = parse_uint(&p, 2, &u);
+        break;
+      case UESTATS_PCI:
+        ok = parse_uint(&p, 503, &u);
+        break;
+      case UESTATS_BAND:
+        ok = parse_uint(&p, 255, &u);
+        break;
+      default:
+        ok = parse_int16(&p, &v);
+        break;
+    }
+    if(!ok || *p != '\0')
+      return false;
+
+    switch(flag){
+      case UESTATS_RSRP:        out->rsrp = v; break;
+      case UESTATS_TOTAL_POWER: out->total_power = v; break;
+      case UESTATS_TX_POWER:    out->tx_power = v; break;
+      case UESTATS_TX_TIME:     out->tx_time = u; break;
+      case UESTATS_RX_TIME:     out->rx_time = u; break;
+      case UESTATS_CELL_ID:     out->cell_id = u; break;
+      case UESTATS_ECL:         out->ecl = u; break;
+      case UESTATS_SNR:         out->snr = v; break;
+      case UESTATS_EARFCN:      out->earfcn = u; break;
+      case UESTATS_PCI:         out->pci = u; break;
+      case UESTATS_RSRQ:        out->rsrq = v; break;
+      case UESTATS_BAND:        out->band = u; break;
+    }
+    out->fields |= flag;
+    return true;
+  }
+  return false;
+}
+
+// parse "NUESTATS:CELL,<earfcn>,<pci>,<primary>,<rsrp>,<rsrq>,<rssi>,<snr>"
+bool parseCellStatsLine(const char *line, NBIoT_CellStats *out)
+{
+  NBIoT_CellStats cell;
+  uint32_t u;
+
+  skip_prefix(&line, PSTR("+"));
+  if(!skip_prefix(&line, PSTR("NUESTATS:CELL,")))
+    return false;
+
+  if(!parse_uint(&line, 0xFFFFFFFFUL, &u) || !expect(&line, ','))
+    return false;
+  cell.earfcn = u;
+  if(!parse_uint(&line, 503, &u) || !expect(&line, ','))
+    return false;
+  cell.pci = u;
+  if(!parse_uint(&line, 1, &u) || !expect(&line, ','))
+    return false;
+  cell.primary = u;
+  if(!parse_int16(&line, &cell.rsrp) || !expect(&line, ','))
+    return false;
+  if(!parse_int16(&line, &cell.rsrq) || !expect(&line, ','))
+    return false;
+  if(!parse_int16(&line, &cell.rssi) || !expect(&line, ','))
+    return false;
+  if(!parse_int16(&line, &cell.snr) || *line != '\0')
+    return false;
+
+  *out = cell;
+  return true;
+}
+
+// parse "+CEREG:<n>,<stat>[,...]" (query) or "+CEREG:<stat>[,"<tac>",...]" (URC)
+bool parseRegistration(const char *line, uint8_t *stat)
+{
+  uint32_t first, second;
+
+  if(!skip_prefix(&line, PSTR("+CEREG:")))
+    return false;
+  if(!parse_uint(&line, 255, &first))
+    return false;
+
+  // query response has <n> and <stat> as numbers, URC continues with quoted <tac>
+  if(expect(&line, ',') && parse_uint(&line, 255, &second))
+    first = second;
+
+  if(first > CEREG_ROAMING)
+    return false;
+  *stat = first;
+  return true;
+}
+
+// parse '+COPS:<mode>,<format>,"<oper>"' with numeric <oper>
+bool parseOperator(const char *line, char *plmn)
+{
+  uint32_t value;
+  uint8_t i = 0;
+
+  if(!skip_prefix(&line, PSTR("+COPS:")))
+    return false;
+  if(!parse_uint(&line, 4, &value) || !expect(&line, ','))
+    return false;
+  if(!parse_uint(&line, 2, &value) || value != 2 || !expect(&line, ',') || !expect(&line, '"'))
+    return false;
+
+  while(*line >= '0' && *line <= '9'){
+    if(i == PLMN_LEN - 1)
+      return false;
+    plmn[i++] = *line++;
+  }
+  if(i < 5 || !expect(&line, '"'))
+    return false;
+
+  plmn[i] = '\0';
+  return true;
+}
+
+// parse "+NBAND:<band>[,<band>...]"
+uint8_t parseBands(const char *line, uint8_t *bands, uint8_t size)
+{
+  uint8_t count = 0;
+  uint32_t band;
+
+  if(!skip_prefix(&line, PSTR("+NBAND:")))
+    return 0;
+
+  do{
+    if(count == size || !parse_uint(&line, 255, &band))
+      return 0;
+    bands[count++] = band;
+  } while(expect(&line, ','));
+
+  return (*line == '\0') ? count : 0;
+}
+
+// days since 1970-01-01 of a civil date
+static uint32_t days_from_civil(uint32_t y, uint32_t m, uint32_t d)
+{
+  // year starts in March, so leap day is the last day of year
+  if(m <= 2)
+    y--;
+  uint32_t era = y / 400;
+  uint32_t yoe = y - era * 400;
+  uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+// parse optionally signed time zone in quarter hours
+static bool parse_zone(const char **s, int8_t *zone)
+{
+  bool negative = (**s == '-');
+  uint32_t value;
+
+  if(**s == '+' || **s == '-')
+    (*s)++;
+  if(!parse_uint(s, 96, &value))
+    return false;
+  *zone = negative ? -(int8_t)value : (int8_t)value;
+  return true;
+}
+
+// parse "+CCLK:yy/MM/dd,hh:mm:ss[+-zz]" or "+CTZEU:<tz>,<dst>,yyyy/MM/dd,hh:mm:ss"
+bool parseClock(const char *line, uint32_t *epoch, int8_t *zone)
+{
+  static const uint16_t limits[6] PROGMEM = {9999, 12, 31, 23, 59, 59};
+  static const char separators[] PROGMEM = "//,::"; // after each field but last
+  uint32_t v[6];
+  int8_t tz = 0;
+  bool nitz = false;
+
+  if(skip_prefix(&line, PSTR("+CTZEU:")))
+    nitz = true;
+  else if(!skip_prefix(&line, PSTR("+CCLK:")))
+    return false;
+  expect(&line, ' ');
+
+  if(nitz){
+    uint32_t dst;
+    bool quoted = expect(&line, '"');
+    if(!parse_zone(&line, &tz) || (quoted && !expect(&line, '"')) || !expect(&line, ','))
+      return false;
+    if(!parse_uint(&line, 2, &dst) || !expect(&line, ','))
+      return false;
+  }
+  bool quoted = expect(&line, '"');
+
+  for(uint8_t i = 0; i < 6; i++){
+    if(!parse_uint(&line, pgm_read_word(&limits[i]), &v[i]))
+      return false;
+    if(i < 5 && !expect(&line, pgm_read_byte(&separators[i])))
+      return false;
+  }
+  if(v[1] == 0 || v[2] == 0)
+    return false;
+  if(v[0] < 100)
+    v[0] += (v[0] < 70) ? 2000 : 1900; // POSIX pivot, unset clock of 70/01/01 gives 0
+  if(v[0] < 1970)
+    return false;
+
+  if(!nitz && (*line == '+' || *line == '-') && !parse_zone(&line, &tz))
+    return false;
+  if(quoted && !expect(&line, '"'))
+    return false;
+  if(*line != '\0')
+    return false;
+
+  *epoch = days_from_civil(v[0], v[1], v[2]) * 86400UL + v[3] * 3600UL + v[4] * 60 + v[5];
+  if(zone)
+    *zone = tz;
+  return true;
+}
+
+// parse "<prefix><n>[,<n>...]"
+uint8_t parseNumbers(const char *line, PGM_P prefix, uint32_t *values, uint8_t size)
+{
+  uint8_t count = 0;
+
+  if(!skip_prefix(&line, prefix))
+    return 0;
+
+  do{
+    if(count == size || !parse_uint(&line, 0xFFFFFFFFUL, &values[count]))
+      return 0;
+    count++;
+  } while(expect(&line, ','));
+
+  return (*line == '\0') ? count : 0;
+}
+
+SixfabLinkMonitor::SixfabLinkMonitor()
+{
+  reset();
+}
+
+// clear all statistics
+void SixfabLinkMonitor::reset()
+{
+  memset(&rsrp, 0, sizeof(rsrp));
+  memset(&snr, 0, sizeof(snr));
+  ecl = 0xFF;
+  cell_id = 0;
+  updates = 0;
+}
+
+// add a NUESTATS reading
+void SixfabLinkMonitor::update(const NBIoT_UEStats &stats)
+{
+  if(stats.fields & UESTATS_CELL_ID){
+    if(updates && stats.cell_id != cell_id){
+      // statistics of previous cell says nothing about the new one
+      memset(&rsrp, 0, sizeof(rsrp));
+      memset(&snr, 0, sizeof(snr));
+    }
+    cell_id = stats.cell_id;
+  }
+  if(stats.fields & UESTATS_RSRP)
+    push(&rsrp, stats.rsrp);
+  if(stats.fields & UESTATS_SNR)
+    push(&snr, stats.snr);
+  if(stats.fields & UESTATS_ECL)
+    ecl = stats.ecl;
+  updates++;
+}
+
+// check if coverage is good enough for deferrable uplinks
+bool SixfabLinkMonitor::uplinkAllowed(uint8_t max_ecl) const
+{
+  return ecl != 0xFF && ecl <= max_ecl;
+}
+
+// put sample to window and recalculate min / avg / max
+void SixfabLinkMonitor::push(NBIoT_Rolling *r, int16_t sample)
+{
+  int32_t sum = 0;
+
+  r->samples[r->head] = sample;
+  r->head = (r->head + 1) % LINK_WINDOW_LEN;
+  if(r->count < LINK_WINDOW_LEN)
+    r->count++;
+
+  r->min = r->max = sample;
+  for(uint8_t i = 0; i < r->count; i++){
+    int16_t s = r->samples[i];
+    if(s < r->min) r->min = s;
+    if(s > r->max) r->max = s;
+    sum += s;
+  }
+  r->avg = sum / r->count;
+}
@@ -0,0 +1,253 @@
+/*
+  Sixfab_RadioStats.h
+  -
+  Parsers for BC95 radio metrics (+CSQ, AT+NUESTATS, AT+NUESTATS=CELL), 
+  network time (+CCLK, +CTZEU) and link quality monitor that keeps rolling min / avg / max of them.
+  -
+  Parsers only use caller supplied structs, they don't allocate and don't 
+  depend on Arduino core, so they can be compiled and fuzzed on host.
+*/
+
+#ifndef _SIXFAB_RADIOSTATS_H
+#define _SIXFAB_RADIOSTATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// fixed strings are kept in flash on AVR, plain memory on other targets and host
+#if defined(__AVR__)
+  #include <avr/pgmspace.h>
+#else
+  #ifndef PROGMEM
+    #define PROGMEM
+  #endif
+  #ifndef PSTR
+    #define PSTR(s) (s)
+  #endif
+  #ifndef PGM_P
+    #define PGM_P const char *
+  #endif
+  #ifndef pgm_read_byte
+    #define pgm_read_byte(address) (*(const uint8_t *)(address))
+  #endif
+  #ifndef pgm_read_word
+    #define pgm_read_word(address) (*(const uint16_t *)(address))
+  #endif
+  #ifndef pgm_read_ptr
+    #define pgm_read_ptr(address) (*(const void * const *)(address))
+  #endif
+  #ifndef strlen_P
+    #define strlen_P strlen
+  #endif
+  #ifndef strncmp_P
+    #define strncmp_P strncmp
+  #endif
+#endif
+
+#define CSQ_UNKNOWN 99
+#define TX_POWER_UNKNOWN -32768
+#define LINK_WINDOW_LEN 8 // number of samples used for rolling statistics
+#define PLMN_LEN 7 // MCC + MNC (5-6 digits) + terminator
+
+// registration status of +CEREG
+#define CEREG_NOT_REGISTERED 0
+#define CEREG_HOME 1
+#define CEREG_SEARCHING 2
+#define CEREG_DENIED 3
+#define CEREG_UNKNOWN 4
+#define CEREG_ROAMING 5
+
+// field flags of NBIoT_UEStats
+#define UESTATS_RSRP        0x0001
+#define UESTATS_TOTAL_POWER 0x0002
+#define UESTATS_TX_POWER    0x0004
+#define UESTATS_TX_TIME     0x0008
+#define UESTATS_RX_TIME     0x0010
+#define UESTATS_CELL_ID     0x0020
+#define UESTATS_ECL         0x0040
+#define UESTATS_SNR         0x0080
+#define UESTATS_EARFCN      0x0100
+#define UESTATS_PCI         0x0200
+#define UESTATS_RSRQ        0x0400
+#define UESTATS_BAND        0x0800
+
+// +CSQ:<rssi>,<ber>
+typedef struct {
+  uint8_t rssi;      // 0-31, CSQ_UNKNOWN if not detectable
+  uint8_t ber;       // 0-7, CSQ_UNKNOWN if not detectable
+  int16_t rssi_dbm;  // -113 ... -51 dBm, 0 if unknown
+} NBIoT_SignalQuality;
+
+// AT+NUESTATS, powers are in 0.1 dBm and SNR in 0.1 dB as reported by module
+typedef struct {
+  uint16_t fields;     // UESTATS_* flags of parsed fields
+  int16_t rsrp;        // "Signal power"
+  int16_t total_power; // "Total power"
+  int16_t tx_power;    // "TX power", TX_POWER_UNKNOWN if no uplink yet
+  uint32_t tx_time;    // "TX time", ms since boot
+  uint32_t rx_time;    // "RX time", ms since boot
+  uint32_t cell_id;    // "Cell ID"
+  uint8_t ecl;         // "ECL", coverage enhancement level 0-2
+  int16_t snr;         // "SNR"
+  uint32_t earfcn;     // "EARFCN"
+  uint16_t pci;        // "PCI"
+  int16_t rsrq;        // "RSRQ"
+  uint8_t band;        // "CURRENT BAND"
+} NBIoT_UEStats;
+
+// NUESTATS:CELL,<earfcn>,<pci>,<primary>,<rsrp>,<rsrq>,<rssi>,<snr>
+typedef struct {
+  uint32_t earfcn;
+  uint16_t pci;
+  uint8_t primary;
+  int16_t rsrp;
+  int16_t rsrq;
+  int16_t rssi;
+  int16_t snr;
+} NBIoT_CellStats;
+
+// rolling min / avg / max of last LINK_WINDOW_LEN samples
+typedef struct {
+  int16_t samples[LINK_WINDOW_LEN];
+  uint8_t count;
+  uint8_t head;
+  int16_t min;
+  int16_t avg;
+  int16_t max;
+} NBIoT_Rolling;
+
+/*
+Function for parsing "+CSQ:<rssi>,<ber>" line.
+
+[return] : bool true if line is a valid +CSQ line
+---
+[param #1] : const char* response line
+[param #2] : NBIoT_SignalQuality* output
+*/
+bool parseSignalQuality(const char *, NBIoT_SignalQuality *);
+
+/*
+Function for parsing one "<Name>:<value>" line of AT+NUESTATS response. 
+Recognized field is stored and its flag is set in fields.
+
+[return] : bool true if line carries a known field
+---
+[param #1] : const char* response line
+[param #2] : NBIoT_UEStats* output
+*/
+bool parseUEStatsLine(const char *, NBIoT_UEStats *);
+
+/*
+Function for parsing one "NUESTATS:CELL,..." line of AT+NUESTATS=CELL response.
+
+[return] : bool true if line is a valid cell line
+---
+[param #1] : const char* response line
+[param #2] : NBIoT_CellStats* output
+*/
+bool parseCellStatsLine(const char *, NBIoT_CellStats *);
+
+/*
+Function for parsing registration status from "+CEREG:<n>,<stat>[,...]" 
+response of AT+CEREG? or "+CEREG:<stat>[,...]" URC.
+
+[return] : bool true if line is a valid +CEREG line
+---
+[param #1] : const char* response line
+[param #2] : uint8_t* registration status (CEREG_*)
+*/
+bool parseRegistration(const char *, uint8_t *);
+
+/*
+Function for parsing numeric operator from '+COPS:<mode>,2,"<oper>"' line.
+
+[return] : bool true if line carries a numeric operator
+---
+[param #1] : const char* response line
+[param #2] : char* output buffer, at least PLMN_LEN bytes
+*/
+bool parseOperator(const char *, char *);
+
+/*
+Function for parsing band list of "+NBAND:<band>[,<band>...]" line.
+
+[return] : uint8_t number of bands written to [param #2], 0 if line is invalid
+---
+[param #1] : const char* response line
+[param #2] : uint8_t* band list
+[param #3] : uint8_t size of band list
+*/
+uint8_t parseBands(const char *, uint8_t *, uint8_t);
+
+/*
+Function for parsing network time of "+CCLK:yy/MM/dd,hh:mm:ss[+-zz]" response
+or "+CTZEU:<tz>,<dst>,yyyy/MM/dd,hh:mm:ss" NITZ URC. BC95 reports time in
+UTC, time zone is given separately in quarter hours.
+
+[return] : bool true if line carries a valid time
+---
+[param #1] : const char* response line
+[param #2] : uint32_t* seconds since 1970-01-01 UTC
+[param #3] : int8_t* time zone in quarter hours, can be NULL
+*/
+bool parseClock(const char *, uint32_t *, int8_t *);
+
+/*
+Function for parsing comma separated unsigned numbers after [param #2] prefix. 
+(e.g. "+NSOSTR:1,12,1" or "+NSONMI:0,24") Prefix is in flash, use PSTR().
+
+[return] : uint8_t number of values, 0 if line doesn't fully match
+---
+[param #1] : const char* response line
+[param #2] : PGM_P prefix
+[param #3] : uint32_t* values
+[param #4] : uint8_t size of values
+*/
+uint8_t parseNumbers(const char *, PGM_P, uint32_t *, uint8_t);
+
+class SixfabLinkMonitor
+{
+  public:
+    SixfabLinkMonitor();
+
+    /*
+    Function for adding a NUESTATS reading to rolling statistics.
+
+    [no-return]
+    ---
+    [param #1] : const NBIoT_UEStats& parsed statistics
+    */
+    void update(const NBIoT_UEStats &);
+
+    /*
+    Function for clearing statistics. (e.g. after cell change)
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void reset();
+
+    /*
+    Function for checking whether coverage is good enough for bulk uplinks.
+    Each ECL step multiplies the repetitions, so TX energy grows up to 100x 
+    from ECL 0 to ECL 2.
+
+    [return] : bool true if last ECL is known and <= [param #1]
+    ---
+    [param #1] : uint8_t maximum accepted ECL
+    */
+    bool uplinkAllowed(uint8_t max_ecl = 1) const;
+
+    NBIoT_Rolling rsrp; // 0.1 dBm
+    NBIoT_Rolling snr;  // 0.1 dB
+    uint8_t ecl;        // last ECL, 0xFF if unknown
+    uint32_t cell_id;   // last serving cell
+    uint32_t updates;   // number of readings taken
+
+  private:
+    void push(NBIoT_Rolling *, int16_t);
+};
+
+#endif
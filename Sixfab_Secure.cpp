@@ -0,0 +1,340 @@
+/*
+  Sixfab_Secure.cpp
+  -
+  Authenticated encryption of UDP payloads for Sixfab NBIoT library.
+*/
+
+#include "Sixfab_Secure.h"
+
+#define SECURE_UPLINK 0
+#define SECURE_DOWNLINK 1
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define QUARTER(a, b, c, d) \
+  a += b; d ^= a; d = ROTL32(d, 16); \
+  c += d; b ^= c; b = ROTL32(b, 12); \
+  a += b; d ^= a; d = ROTL32(d, 8);  \
+  c += d; b ^= c; b = ROTL32(b, 7)
+
+// Poly1305 state, 130 bit numbers in 17 limbs of 8 bits
+typedef struct {
+  uint16_t r[17];
+  uint16_t h[17];
+  uint8_t s[16];
+} Poly1305;
+
+static uint32_t load_le32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void store_le32(uint8_t *p, uint32_t v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+// key, block counter 0 and nonce of direction and message counter
+static void chacha_init(uint32_t *input, const uint8_t *key, uint8_t direction, uint32_t counter)
+{
+  input[0] = 0x61707865; // "expand 32-byte k"
+  input[1] = 0x3320646e;
+  input[2] = 0x79622d32;
+  input[3] = 0x6b206574;
+  for(uint8_t i = 0; i < 8; i++)
+    input[4 + i] = load_le32(key + 4 * i);
+  input[12] = 0;
+  input[13] = direction;
+  input[14] = 0;
+  input[15] = counter;
+}
+
+#if !SECURE_UNROLL
+static void quarter_round(uint32_t *x, uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+  QUARTER(x[a], x[b], x[c], x[d]);
+}
+#endif
+
+static void chacha_block(const uint32_t *input, uint8_t *out)
+{
+  uint32_t x[16];
+
+  memcpy(x, input, sizeof(x));
+  for(uint8_t i = 0; i < 10; i++){
+#if SECURE_UNROLL
+    QUARTER(x[0], x[4], x[8], x[12]);
+    QUARTER(x[1], x[5], x[9], x[13]);
+    QUARTER(x[2], x[6], x[10], x[14]);
+    QUARTER(x[3], x[7], x[11], x[15]);
+    QUARTER(x[0], x[5], x[10], x[15]);
+    QUARTER(x[1], x[6], x[11], x[12]);
+    QUARTER(x[2], x[7], x[8], x[13]);
+    QUARTER(x[3], x[4], x[9], x[14]);
+#else
+    // column rounds, then diagonal rounds
+    for(uint8_t j = 0; j < 4; j++)
+      quarter_round(x, j, j + 4, j + 8, j + 12);
+    for(uint8_t j = 0; j < 4; j++)
+      quarter_round(x, j, ((j + 1) & 3) + 4, ((j + 2) & 3) + 8, ((j + 3) & 3) + 12);
+#endif
+  }
+  for(uint8_t i = 0; i < 16; i++)
+    store_le32(out + 4 * i, x[i] + input[i]);
+}
+
+// h += c, carried
+static void add1305(uint16_t *h, const uint16_t *c)
+{
+  uint16_t u = 0;
+  for(uint8_t j = 0; j < 17; j++){
+    u += h[j] + c[j];
+    h[j] = u & 255;
+    u >>= 8;
+  }
+}
+
+static void poly_init(Poly1305 *poly, const uint8_t *key)
+{
+  for(uint8_t i = 0; i < 16; i++){
+    poly->r[i] = key[i];
+    poly->h[i] = 0;
+    poly->s[i] = key[16 + i];
+  }
+  poly->r[16] = poly->h[16] = 0;
+
+  // clamp r
+  poly->r[3] &= 15;
+  poly->r[4] &= 252;
+  poly->r[7] &= 15;
+  poly->r[8] &= 252;
+  poly->r[11] &= 15;
+  poly->r[12] &= 252;
+  poly->r[15] &= 15;
+}
+
+// h = (h + block) * r mod 2^130 - 5, block is zero padded to 16 bytes
+static void poly_block(Poly1305 *poly, const uint8_t *m, uint8_t n)
+{
+  uint16_t c[17];
+  uint32_t x[17];
+  uint32_t u;
+
+  for(uint8_t j = 0; j < 16; j++)
+    c[j] = (j < n) ? m[j] : 0;
+  c[16] = 1;
+  add1305(poly->h, c);
+
+  for(uint8_t i = 0; i < 17; i++){
+    x[i] = 0;
+    for(uint8_t j = 0; j < 17; j++)
+      x[i] += (uint32_t)poly->h[j] * ((j <= i) ? poly->r[i - j] : 320 * (uint32_t)poly->r[i + 17 - j]);
+  }
+
+  u = 0;
+  for(uint8_t j = 0; j < 16; j++){
+    u += x[j];
+    x[j] = u & 255;
+    u >>= 8;
+  }
+  u += x[16];
+  x[16] = u & 3;
+  u = 5 * (u >> 2);
+  for(uint8_t j = 0; j < 16; j++){
+    u += x[j];
+    poly->h[j] = u & 255;
+    u >>= 8;
+  }
+  poly->h[16] = u + x[16];
+}
+
+// tag = (h mod 2^130 - 5) + s, in constant time
+static void poly_finish(Poly1305 *poly, uint8_t *tag)
+{
+  uint16_t g[17];
+  uint16_t c[17];
+
+  // h - p as h + 2^136 - p
+  memcpy(g, poly->h, sizeof(g));
+  memset(c, 0, sizeof(c));
+  c[0] = 5;
+  c[16] = 252;
+  add1305(poly->h, c);
+  uint16_t mask = -(poly->h[16] >> 7); // h < p
+  for(uint8_t j = 0; j < 17; j++)
+    poly->h[j] ^= mask & (g[j] ^ poly->h[j]);
+
+  for(uint8_t j = 0; j < 16; j++)
+    c[j] = poly->s[j];
+  c[16] = 0;
+  add1305(poly->h, c);
+  for(uint8_t j = 0; j < 16; j++)
+    tag[j] = poly->h[j];
+}
+
+SixfabSecure::SixfabSecure()
+{
+  memset(&state, 0, sizeof(state));
+  tx_counter = 0;
+  rejected = 0;
+}
+
+bool SixfabSecure::begin()
+{
+  if(!storageAvailable())
+    return false; // reserved counters couldn't be kept, nonces would repeat
+
+  storageGet(EEPROM_SECURE_STATE, state);
+  if(state.magic != SECURE_KEY_MAGIC)
+    return false;
+
+  tx_counter = state.tx_reserved; // counters reserved before reset may be used
+  return true;
+}
+
+bool SixfabSecure::setKey(const uint8_t *key)
+{
+  NBIoT_SecureState stored;
+
+  if(!storageAvailable())
+    return false;
+
+  storageGet(EEPROM_SECURE_STATE, stored);
+  if(stored.magic == SECURE_KEY_MAGIC){
+    if(memcmp(stored.key, key, SECURE_KEY_LEN))
+      return false; // another key is stored, only rotateKey() replaces it
+
+    // same key, e.g. provisioned on every boot, keep counters
+    state = stored;
+    tx_counter = state.tx_reserved;
+    return true;
+  }
+  return rotateKey(key);
+}
+
+bool SixfabSecure::rotateKey(const uint8_t *key)
+{
+  NBIoT_SecureState fresh;
+
+  fresh.magic = SECURE_KEY_MAGIC;
+  memcpy(fresh.key, key, SECURE_KEY_LEN);
+  fresh.tx_reserved = 0;
+  fresh.rx_counter = 0;
+  if(!storagePut(EEPROM_SECURE_STATE, fresh))
+    return false;
+
+  state = fresh;
+  tx_counter = 0;
+  return true;
+}
+
+void SixfabSecure::eraseKey()
+{
+  memset(&state, 0, sizeof(state));
+  tx_counter = 0;
+  storagePut(EEPROM_SECURE_STATE, state);
+}
+
+uint16_t SixfabSecure::seal(const uint8_t *payload, uint16_t len, uint8_t *out)
+{
+  uint8_t tag[16];
+
+  if(state.magic != SECURE_KEY_MAGIC || tx_counter == 0xFFFFFFFFUL)
+    return 0;
+
+  // reserve next block before a nonce of it is used
+  if(tx_counter >= state.tx_reserved){
+    uint32_t reserved = state.tx_reserved;
+
+    state.tx_reserved = (tx_counter > 0xFFFFFFFFUL - SECURE_COUNTER_RESERVE)
+      ? 0xFFFFFFFFUL : tx_counter + SECURE_COUNTER_RESERVE;
+    if(!storagePut(EEPROM_SECURE_STATE, state)){
+      state.tx_reserved = reserved;
+      return 0; // nonce can't be reserved, it could be used again after reset
+    }
+  }
+
+  uint32_t counter = tx_counter++;
+  out[0] = counter >> 24;
+  out[1] = counter >> 16;
+  out[2] = counter >> 8;
+  out[3] = counter;
+
+  crypt(SECURE_UPLINK, counter, out, payload, len, out + SECURE_HEADER_LEN, tag, true);
+  memcpy(out + SECURE_HEADER_LEN + len, tag, SECURE_TAG_LEN);
+  return len + SECURE_OVERHEAD;
+}
+
+int16_t SixfabSecure::open(const uint8_t *datagram, uint16_t len, uint8_t *out)
+{
+  uint8_t tag[16];
+  uint8_t diff = 0;
+
+  if(state.magic != SECURE_KEY_MAGIC || len < SECURE_OVERHEAD){
+    rejected++;
+    return -1;
+  }
+
+  uint16_t payload_len = len - SECURE_OVERHEAD;
+  uint32_t counter = ((uint32_t)datagram[0] << 24) | ((uint32_t)datagram[1] << 16) | ((uint32_t)datagram[2] << 8) | datagram[3];
+
+  crypt(SECURE_DOWNLINK, counter, datagram, datagram + SECURE_HEADER_LEN, payload_len, out, tag, false);
+
+  for(uint8_t i = 0; i < SECURE_TAG_LEN; i++)
+    diff |= tag[i] ^ datagram[SECURE_HEADER_LEN + payload_len + i];
+
+  if(diff || counter <= state.rx_counter){
+    memset(out, 0, payload_len); // don't leave unauthenticated plaintext
+    rejected++;
+    return -1;
+  }
+
+  state.rx_counter = counter;
+  storagePut(EEPROM_SECURE_STATE, state);
+  return payload_len;
+}
+
+uint32_t SixfabSecure::getCounter()
+{
+  return tx_counter;
+}
+
+// ChaCha20-Poly1305 of RFC 8439, header is additional data, tag is 16 bytes
+void SixfabSecure::crypt(uint8_t direction, uint32_t counter, const uint8_t *header, const uint8_t *in, uint16_t len, uint8_t *out, uint8_t *tag, bool encrypt)
+{
+  uint32_t input[16];
+  uint8_t block[64];
+  Poly1305 poly;
+
+  chacha_init(input, state.key, direction, counter);
+  chacha_block(input, block); // block 0 gives one time Poly1305 key
+  poly_init(&poly, block);
+  poly_block(&poly, header, SECURE_HEADER_LEN);
+
+  for(uint16_t offset = 0; offset < len; offset += 64){
+    uint8_t n = (len - offset < 64) ? len - offset : 64;
+
+    input[12]++;
+    chacha_block(input, block);
+    for(uint8_t i = 0; i < n; i++)
+      out[offset + i] = in[offset + i] ^ block[i];
+
+    const uint8_t *ciphertext = encrypt ? out + offset : in + offset;
+    for(uint8_t i = 0; i < n; i += 16)
+      poly_block(&poly, ciphertext + i, (n - i < 16) ? n - i : 16);
+  }
+
+  // 64 bit little endian lengths of additional data and ciphertext
+  memset(block, 0, 16);
+  block[0] = SECURE_HEADER_LEN;
+  block[8] = len;
+  block[9] = len >> 8;
+  poly_block(&poly, block, 16);
+  poly_finish(&poly, tag);
+
+  memset(block, 0, sizeof(block));
+  memset(input, 0, sizeof(input));
+  memset(&poly, 0, sizeof(poly));
+}
@@ -0,0 +1,136 @@
+/*
+  Sixfab_Secure.h
+  -
+  Authenticated encryption of UDP payloads for Sixfab NBIoT library.
+  Payloads are sealed with ChaCha20-Poly1305 (RFC 8439), which needs no
+  tables and runs in constant time on 8 bit MCUs. Key is per device and
+  kept in EEPROM. Each datagram carries a 32 bit message counter that is
+  the nonce and is authenticated with the payload :
+
+    [counter, 4 bytes big endian][ciphertext][tag, SECURE_TAG_LEN bytes]
+
+  Uplink and downlink use separate nonce spaces. Uplink counter is
+  reserved in EEPROM in blocks of SECURE_COUNTER_RESERVE, so a nonce is
+  never used twice across reboots. Downlinks are accepted only with a
+  counter above the last accepted one, which is stored, so replayed
+  datagrams are rejected. Server counters start at 1. Counters start from
+  0 only when a new key is stored by rotateKey(), server must reset its
+  counters of the device at the same time. Nothing is sealed or opened on
+  boards without EEPROM, see storageAvailable().
+*/
+
+#ifndef _SIXFAB_SECURE_H
+#define _SIXFAB_SECURE_H
+
+#include "Sixfab_NBIoT.h"
+
+#ifndef SECURE_TAG_LEN
+  #define SECURE_TAG_LEN 8 // bytes of Poly1305 tag sent, 4..16
+#endif
+#if SECURE_TAG_LEN < 4 || SECURE_TAG_LEN > 16
+  #error "SECURE_TAG_LEN must be 4..16"
+#endif
+#ifndef SECURE_UNROLL
+  #if defined(__AVR__)
+    #define SECURE_UNROLL 0 // ChaCha20 rounds in a loop, smaller code
+  #else
+    #define SECURE_UNROLL 1 // unrolled rounds, faster
+  #endif
+#endif
+#define SECURE_KEY_LEN 32
+#define SECURE_HEADER_LEN 4
+#define SECURE_OVERHEAD (SECURE_HEADER_LEN + SECURE_TAG_LEN) // bytes added to a payload
+#define SECURE_COUNTER_RESERVE 32 // uplink nonces reserved per EEPROM write
+#define SECURE_KEY_MAGIC 0xB7
+
+// key and counters, stored in EEPROM
+typedef struct {
+  uint8_t magic;               // SECURE_KEY_MAGIC if key is set
+  uint8_t key[SECURE_KEY_LEN];
+  uint32_t tx_reserved;        // uplink counters below are used or skipped
+  uint32_t rx_counter;         // last accepted downlink counter
+} NBIoT_SecureState;
+
+class SixfabSecure
+{
+  public:
+    SixfabSecure();
+
+    /*
+    Function for loading key and counters from EEPROM
+
+    [return] : bool false if no key is stored or storage isn't available
+    ---
+    [no-param]
+    */
+    bool begin();
+
+    /*
+    Function for provisioning device key. If same key is already stored,
+    stored counters are kept, so it can be called on every boot.
+
+    [return] : bool false if another key is stored or storage isn't available
+    ---
+    [param #1] : const uint8_t* key, SECURE_KEY_LEN bytes
+    */
+    bool setKey(const uint8_t *);
+
+    /*
+    Function for replacing stored key. Counters start again from 0.
+
+    [return] : bool false if storage isn't available
+    ---
+    [param #1] : const uint8_t* key, SECURE_KEY_LEN bytes
+    */
+    bool rotateKey(const uint8_t *);
+
+    /*
+    Function for erasing stored key and counters
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void eraseKey();
+
+    /*
+    Function for encrypting and authenticating an uplink payload
+
+    [return] : uint16_t datagram length, payload length + SECURE_OVERHEAD, 0 if no key or counter can't be reserved
+    ---
+    [param #1] : const uint8_t* payload
+    [param #2] : uint16_t payload length
+    [param #3] : uint8_t* output, payload length + SECURE_OVERHEAD bytes, can't overlap payload
+    */
+    uint16_t seal(const uint8_t *, uint16_t, uint8_t *);
+
+    /*
+    Function for checking and decrypting a downlink datagram
+
+    [return] : int16_t payload length, -1 if datagram is forged, damaged or replayed
+    ---
+    [param #1] : const uint8_t* datagram
+    [param #2] : uint16_t datagram length
+    [param #3] : uint8_t* output, datagram length - SECURE_OVERHEAD bytes, can't overlap datagram
+    */
+    int16_t open(const uint8_t *, uint16_t, uint8_t *);
+
+    /*
+    Function for getting counter of next uplink
+
+    [return] : uint32_t counter
+    ---
+    [no-param]
+    */
+    uint32_t getCounter();
+
+    uint16_t rejected; // downlinks failed authentication or replay check
+
+  private:
+    NBIoT_SecureState state;
+    uint32_t tx_counter;
+
+    void crypt(uint8_t direction, uint32_t counter, const uint8_t *header, const uint8_t *in, uint16_t len, uint8_t *out, uint8_t *tag, bool encrypt);
+};
+
+#endif
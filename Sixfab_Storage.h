@@ -0,0 +1,117 @@
+/*
+  Sixfab_Storage.h
+  -
+  Small persistent storage layer of Sixfab NBIoT library. Uses EEPROM on 
+  AVR, and emulated EEPROM on ESP8266 / ESP32. On other boards define 
+  SIXFAB_HAS_EEPROM if the core provides an AVR compatible <EEPROM.h>. 
+  Without it storageAvailable() returns false, reads return erased (0xFF) 
+  bytes and writes fail. Caches of modem settings are then rebuilt on every 
+  boot, modules that need persistence (SixfabSecure, SixfabCommands reboot) 
+  refuse to work.
+*/
+
+#ifndef _SIXFAB_STORAGE_H
+#define _SIXFAB_STORAGE_H
+
+#include <Arduino.h>
+
+#if defined(__AVR__) || defined(ESP8266) || defined(ESP32)
+  #ifndef SIXFAB_HAS_EEPROM
+    #define SIXFAB_HAS_EEPROM
+  #endif
+#endif
+
+#if defined(SIXFAB_HAS_EEPROM)
+  #include <EEPROM.h>
+#endif
+
+#ifndef SIXFAB_STORAGE_SIZE
+  #define SIXFAB_STORAGE_SIZE 512 // bytes of emulated EEPROM requested on ESP boards
+#endif
+
+#if defined(SIXFAB_HAS_EEPROM) && (defined(ESP8266) || defined(ESP32))
+  #define SIXFAB_EEPROM_EMULATED
+#endif
+
+/*
+Function for checking whether storage keeps data over resets
+
+[return] : true if EEPROM is available, false if not
+---
+[no-param]
+*/
+inline bool storageAvailable()
+{
+#if defined(SIXFAB_HAS_EEPROM)
+  return true;
+#else
+  return false;
+#endif
+}
+
+/*
+Function for reading [param #3] bytes from storage address [param #1]
+
+[no-return]
+---
+[param #1] : int storage address
+[param #2] : void* output
+[param #3] : size_t length
+*/
+inline void storageRead(int address, void *data, size_t len)
+{
+  uint8_t *out = (uint8_t *)data;
+#if defined(SIXFAB_EEPROM_EMULATED)
+  EEPROM.begin(SIXFAB_STORAGE_SIZE);
+#endif
+  for(size_t i = 0; i < len; i++){
+#if defined(SIXFAB_HAS_EEPROM)
+    out[i] = EEPROM.read(address + i);
+#else
+    out[i] = 0xFF;
+#endif
+  }
+}
+
+/*
+Function for writing [param #3] bytes to storage address [param #1]. 
+Unchanged bytes aren't rewritten to save EEPROM write cycles.
+
+[return] : true if written, false if storage isn't available
+---
+[param #1] : int storage address
+[param #2] : const void* data
+[param #3] : size_t length
+*/
+inline bool storageWrite(int address, const void *data, size_t len)
+{
+#if defined(SIXFAB_HAS_EEPROM)
+  const uint8_t *in = (const uint8_t *)data;
+  #if defined(SIXFAB_EEPROM_EMULATED)
+  EEPROM.begin(SIXFAB_STORAGE_SIZE);
+  #endif
+  for(size_t i = 0; i < len; i++){
+    if(EEPROM.read(address + i) != in[i])
+      EEPROM.write(address + i, in[i]);
+  }
+  #if defined(SIXFAB_EEPROM_EMULATED)
+  EEPROM.commit();
+  #endif
+  return true;
+#else
+  (void)address; (void)data; (void)len;
+  return false;
+#endif
+}
+
+template <typename T> inline void storageGet(int address, T &value)
+{
+  storageRead(address, &value, sizeof(T));
+}
+
+template <typename T> inline bool storagePut(int address, const T &value)
+{
+  return storageWrite(address, &value, sizeof(T));
+}
+
+#endif
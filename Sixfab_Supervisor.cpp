@@ -0,0 +1,202 @@
+/*
+  Sixfab_Supervisor.cpp
+  -
+  Watchdog supervisor for Sixfab Arduino NBIoT Shield.
+*/
+
+#include "Sixfab_Supervisor.h"
+
+static NBIoT_ResetRecord reset_record __attribute__((section(".noinit")));
+
+// set before .bss is cleared, valid only if watchdogLinked()
+uint8_t SixfabSupervisor::boot_flags __attribute__((section(".noinit")));
+
+#if defined(SIXFAB_HAS_WDT)
+static volatile uint16_t wdt_ticks;
+static uint16_t wdt_limit;
+#endif
+
+// 1 s tick in interrupt mode. if interrupt mode isn't renewed, next timeout resets MCU
+void SixfabSupervisor::onWatchdog()
+{
+#if defined(SIXFAB_HAS_WDT)
+  if(++wdt_ticks < wdt_limit){
+    WDTCSR |= _BV(WDIE);
+  }
+  else{
+    reset_record.reason = RESET_HANG;
+    reset_record.resets++;
+  }
+#endif
+}
+
+// overridden by SIXFAB_SUPERVISOR_ISR()
+__attribute__((weak)) bool SixfabSupervisor::watchdogLinked()
+{
+  return false;
+}
+
+SixfabSupervisor::SixfabSupervisor(SixfabNBIoT &node)
+  : node(node)
+{
+  reset_reason = RESET_UNKNOWN;
+  failures = 0;
+  last_progress = 0;
+  retry_count = reboot_count = power_cycle_count = 0;
+}
+
+// read reason of last reset and start watchdog
+void SixfabSupervisor::begin(uint16_t hang_timeout)
+{
+  if(reset_record.magic != SUPERVISOR_MAGIC){
+    memset(&reset_record, 0, sizeof(reset_record));
+    reset_record.magic = SUPERVISOR_MAGIC;
+    reset_reason = RESET_POWER_ON;
+  }
+  else if(reset_record.reason != RESET_UNKNOWN){
+    reset_reason = (NBIoT_ResetReason)reset_record.reason;
+  }
+#if defined(SIXFAB_HAS_WDT)
+  else if(!watchdogLinked()){
+    // reset flags weren't read
+  }
+  else if(boot_flags & _BV(PORF)){
+    reset_reason = RESET_POWER_ON;
+    reset_record.resets = 0;
+  }
+  else if(boot_flags & _BV(BORF)){
+    reset_reason = RESET_BROWN_OUT;
+  }
+  else if(boot_flags & _BV(EXTRF)){
+    reset_reason = RESET_EXTERNAL;
+  }
+  else if(boot_flags & _BV(WDRF)){
+    reset_reason = RESET_WATCHDOG;
+  }
+#endif
+  reset_record.reason = RESET_UNKNOWN;
+
+  if(reset_reason == RESET_HANG || reset_reason == RESET_UNRESPONSIVE)
+    LOG_WARN("SUPERVISOR", "reset %u after %u failures", reset_reason, reset_record.failures);
+
+  node.setHealthHandler(on_health, this);
+  last_progress = millis();
+
+#if defined(SIXFAB_HAS_WDT)
+  if(!watchdogLinked()){
+    LOG_WARN("SUPERVISOR", "no SIXFAB_SUPERVISOR_ISR(), watchdog off");
+    return; // enabled interrupt would jump to bad interrupt vector
+  }
+  wdt_limit = hang_timeout ? hang_timeout : 1;
+  wdt_ticks = 0;
+
+  uint8_t sreg = SREG;
+  cli();
+  wdt_reset();
+  WDTCSR = _BV(WDCE) | _BV(WDE);
+  WDTCSR = _BV(WDIE) | _BV(WDE) | _BV(WDP2) | _BV(WDP1); // 1 s
+  SREG = sreg;
+#else
+  (void)hang_timeout;
+#endif
+}
+
+// feed watchdog from loop while engine is healthy
+void SixfabSupervisor::poll()
+{
+  if(failures == 0)
+    feed();
+}
+
+NBIoT_ResetReason SixfabSupervisor::getResetReason()
+{
+  return reset_reason;
+}
+
+uint16_t SixfabSupervisor::getResetCount()
+{
+  return reset_record.resets;
+}
+
+uint32_t SixfabSupervisor::getIdleTime()
+{
+  return millis() - last_progress;
+}
+
+uint8_t SixfabSupervisor::getFailureCount()
+{
+  return failures;
+}
+
+// health handler of node
+void SixfabSupervisor::on_health(bool answered, void *context)
+{
+  ((SixfabSupervisor *)context)->progress(answered);
+}
+
+// escalate recovery with consecutive failures
+void SixfabSupervisor::progress(bool answered)
+{
+  if(answered){
+    failures = 0;
+    last_progress = millis();
+    feed();
+    return;
+  }
+
+  if(failures < 0xFF)
+    failures++;
+
+  if(failures < SUPERVISOR_RETRY_LIMIT){
+    retry_count++;
+  }
+  else if(failures == SUPERVISOR_RETRY_LIMIT){
+    LOG_WARN("SUPERVISOR", "AT+NRB");
+    node.sendATCommOnce(CMD_NRB);
+    reboot_count++;
+  }
+  else if(failures == SUPERVISOR_RETRY_LIMIT + SUPERVISOR_STEP_LIMIT){
+    LOG_WARN("SUPERVISOR", "power cycle");
+    node.disable();
+    delay(SUPERVISOR_POWER_OFF);
+    node.enable();
+    power_cycle_count++;
+  }
+  else if(failures >= SUPERVISOR_RETRY_LIMIT + 2 * SUPERVISOR_STEP_LIMIT){
+    reset_mcu(RESET_UNRESPONSIVE);
+  }
+}
+
+// restart hang timeout
+void SixfabSupervisor::feed()
+{
+#if defined(SIXFAB_HAS_WDT)
+  uint8_t sreg = SREG;
+  cli();
+  wdt_ticks = 0;
+  wdt_reset();
+  SREG = sreg;
+#endif
+}
+
+// record reason and reset MCU with watchdog
+void SixfabSupervisor::reset_mcu(NBIoT_ResetReason reason)
+{
+  reset_record.reason = reason;
+  reset_record.failures = failures;
+  reset_record.resets++;
+  LOG_ERROR("SUPERVISOR", "MCU reset");
+  sixfabLog.flush();
+
+#if defined(SIXFAB_HAS_WDT)
+  cli();
+  wdt_enable(WDTO_15MS);
+  for(;;);
+#elif defined(ESP8266) || defined(ESP32)
+  ESP.restart();
+#elif defined(__arm__) && defined(__NVIC_PRIO_BITS)
+  NVIC_SystemReset();
+#else
+  failures = 0; // no portable reset, start over from retries
+#endif
+}
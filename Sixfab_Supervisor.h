@@ -0,0 +1,192 @@
+/*
+  Sixfab_Supervisor.h
+  -
+  Watchdog supervisor for Sixfab Arduino NBIoT Shield. Watchdog is fed
+  only while command engine of node gets answers from module. Consecutive
+  failures are answered with escalating recovery actions : retry, AT+NRB,
+  power cycle of BC95_ENABLE and MCU reset. Reason of last reset is kept
+  in noinit RAM, so it can be reported after reboot.
+
+  On AVR, watchdog runs in interrupt and reset mode with 1 s period, hang
+  timeout is counted in the interrupt. If interrupts are disabled by the
+  hang, MCU is reset at the next period. Watchdog interrupt and the early
+  boot code that reads reset flags aren't linked from the library, put
+  SIXFAB_SUPERVISOR_ISR() once at file scope of the sketch to use them :
+
+    #include "Sixfab_Supervisor.h"
+    SIXFAB_SUPERVISOR_ISR()
+
+  Without it, or on other boards, recovery actions run without watchdog and
+  reset flags of MCU aren't reported. Optiboot clears MCUSR and passes it in
+  r2, which is read when MCUSR is 0. Bootloaders that leave through a
+  watchdog reset after an external reset (e.g. Optiboot) make it reported as
+  RESET_WATCHDOG.
+
+  MCU reset step uses watchdog on AVR, ESP.restart() on ESP8266 / ESP32 and
+  NVIC_SystemReset() on Cortex-M cores with CMSIS. Other boards leave that
+  step out and start over from retries.
+*/
+
+#ifndef _SIXFAB_SUPERVISOR_H
+#define _SIXFAB_SUPERVISOR_H
+
+#include "Sixfab_NBIoT.h"
+
+#if defined(__AVR__)
+  #define SIXFAB_HAS_WDT
+#endif
+
+#if defined(SIXFAB_HAS_WDT)
+  #include <avr/io.h>
+  #include <avr/wdt.h>
+  #include <avr/interrupt.h>
+  // emits reset flag capture before main() and watchdog interrupt, once in
+  // sketch. watchdog stays enabled with shortest period after a watchdog
+  // reset, it is turned off before sketch can be reset again.
+  #define SIXFAB_SUPERVISOR_ISR() \
+    void sixfab_boot_flags(void) __attribute__((naked, used, section(".init3"))); \
+    void sixfab_boot_flags(void) \
+    { \
+      __asm__ __volatile__ ("sts %0, r2" : "=m" (SixfabSupervisor::boot_flags)); \
+      if(MCUSR) \
+        SixfabSupervisor::boot_flags = MCUSR; \
+      MCUSR = 0; \
+      wdt_disable(); \
+    } \
+    ISR(WDT_vect) { SixfabSupervisor::onWatchdog(); } \
+    bool SixfabSupervisor::watchdogLinked() { return true; }
+#else
+  #define SIXFAB_SUPERVISOR_ISR()
+#endif
+
+#define SUPERVISOR_HANG_TIMEOUT 600 // s without progress before MCU reset
+#define SUPERVISOR_RETRY_LIMIT 3 // failed transactions left to engine retries
+#define SUPERVISOR_STEP_LIMIT 10 // failed transactions after each recovery action
+#define SUPERVISOR_POWER_OFF 1000 // ms of power cycle
+#define SUPERVISOR_MAGIC 0x5AFE
+
+enum NBIoT_ResetReason {
+  RESET_UNKNOWN,
+  RESET_POWER_ON,
+  RESET_EXTERNAL,     // reset pin
+  RESET_BROWN_OUT,
+  RESET_WATCHDOG,     // watchdog not started by supervisor
+  RESET_HANG,         // no progress in hang timeout
+  RESET_UNRESPONSIVE  // module didn't recover after power cycle
+};
+
+// kept in noinit RAM over resets
+typedef struct {
+  uint16_t magic;    // SUPERVISOR_MAGIC if valid
+  uint8_t reason;    // NBIoT_ResetReason set just before supervised reset
+  uint8_t failures;  // consecutive failures at reset
+  uint16_t resets;   // supervised resets since power on
+} NBIoT_ResetRecord;
+
+class SixfabSupervisor
+{
+  public:
+
+    /*
+    Constructor
+
+    [no-return]
+    ---
+    [param #1] : SixfabNBIoT& node that is supervised
+    */
+    SixfabSupervisor(SixfabNBIoT &);
+
+    /*
+    Function for reading reason of last reset and starting watchdog.
+    Should be called at start of setup(), before init() of node.
+
+    [no-return]
+    ---
+    [param #1] : uint16_t seconds without progress before MCU reset
+    */
+    void begin(uint16_t hang_timeout = SUPERVISOR_HANG_TIMEOUT);
+
+    /*
+    Function for feeding watchdog while command engine isn't failing.
+    Should be called from loop().
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void poll();
+
+    /*
+    Function for getting reason of last reset
+
+    [return] : NBIoT_ResetReason reason
+    ---
+    [no-param]
+    */
+    NBIoT_ResetReason getResetReason();
+
+    /*
+    Function for getting supervised resets since power on
+
+    [return] : uint16_t reset count
+    ---
+    [no-param]
+    */
+    uint16_t getResetCount();
+
+    /*
+    Function for getting time since last answered transaction
+
+    [return] : uint32_t time in ms
+    ---
+    [no-param]
+    */
+    uint32_t getIdleTime();
+
+    /*
+    Function for getting consecutive failed transactions
+
+    [return] : uint8_t failure count
+    ---
+    [no-param]
+    */
+    uint8_t getFailureCount();
+
+    uint32_t retry_count;       // failed transactions left to engine retries
+    uint32_t reboot_count;      // AT+NRB sent
+    uint32_t power_cycle_count; // BC95_ENABLE power cycles
+
+    /*
+    Function for counting hang timeout, called from SIXFAB_SUPERVISOR_ISR()
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    static void onWatchdog();
+
+    /*
+    Function for checking if SIXFAB_SUPERVISOR_ISR() is in sketch. Defined
+    weak by library, the macro overrides it.
+
+    [return] : bool true if watchdog interrupt is linked
+    ---
+    [no-param]
+    */
+    static bool watchdogLinked();
+
+    static uint8_t boot_flags; // MCUSR at reset, set by SIXFAB_SUPERVISOR_ISR()
+
+  private:
+    SixfabNBIoT &node;
+    NBIoT_ResetReason reset_reason;
+    uint8_t failures;
+    uint32_t last_progress;
+
+    static void on_health(bool progress, void *context);
+    void progress(bool);
+    void feed();
+    void reset_mcu(NBIoT_ResetReason);
+};
+
+#endif
@@ -0,0 +1,86 @@
+/*
+  Sixfab_Tick.cpp
+  -
+  Millisecond tick shared by peripheral drivers of Sixfab NBIoT library.
+*/
+
+#include "Sixfab_Tick.h"
+
+// overridden by SIXFAB_TICK_ISR()
+__attribute__((weak)) bool tickVectorLinked()
+{
+  return false;
+}
+
+#if defined(SIXFAB_HAS_TICK)
+
+static volatile NBIoT_TickHandler tick_handlers[TICK_HANDLER_COUNT];
+static void * volatile tick_contexts[TICK_HANDLER_COUNT];
+
+// fires once per Timer0 overflow period, halfway between millis() updates
+void tickInterrupt()
+{
+  for(uint8_t i = 0; i < TICK_HANDLER_COUNT; i++){
+    if(tick_handlers[i])
+      tick_handlers[i](tick_contexts[i]);
+  }
+}
+
+bool tickAttach(NBIoT_TickHandler handler, void *context)
+{
+  bool attached = false;
+
+  if(!tickVectorLinked())
+    return false; // enabled interrupt would jump to bad interrupt vector
+
+  uint8_t sreg = SREG;
+  cli();
+  for(uint8_t i = 0; i < TICK_HANDLER_COUNT; i++){
+    if(tick_handlers[i] == NULL){
+      tick_contexts[i] = context;
+      tick_handlers[i] = handler;
+      attached = true;
+      break;
+    }
+  }
+  if(attached){
+    OCR0A = 0x80;
+    TIMSK0 |= _BV(OCIE0A);
+  }
+  SREG = sreg;
+  return attached;
+}
+
+void tickDetach(NBIoT_TickHandler handler, void *context)
+{
+  uint8_t sreg = SREG;
+  bool used = false;
+
+  cli();
+  for(uint8_t i = 0; i < TICK_HANDLER_COUNT; i++){
+    if(tick_handlers[i] == handler && tick_contexts[i] == context)
+      tick_handlers[i] = NULL;
+    if(tick_handlers[i])
+      used = true;
+  }
+  if(!used)
+    TIMSK0 &= ~_BV(OCIE0A);
+  SREG = sreg;
+}
+
+#else
+
+bool tickAttach(NBIoT_TickHandler, void *)
+{
+  return false;
+}
+
+void tickInterrupt()
+{
+}
+
+void tickDetach(NBIoT_TickHandler, void *)
+{
+}
+
+#endif
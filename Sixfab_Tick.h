@@ -0,0 +1,83 @@
+/*
+  Sixfab_Tick.h
+  -
+  Millisecond tick shared by peripheral drivers of Sixfab NBIoT library.
+  On AVR, compare match A interrupt of Timer0 is used. Timer0 is already
+  running for millis(), so no timer is taken from the sketch and the
+  tick keeps running while the modem command engine is blocked. On other
+  boards tickAttach() fails and drivers must be polled from loop().
+
+  The interrupt vector isn't linked from the library, so TIMER0_COMPA_vect
+  stays free for sketches that don't use the tick. To use it, put
+  SIXFAB_TICK_ISR() once at file scope of the sketch :
+
+    #include "Sixfab_Tick.h"
+    SIXFAB_TICK_ISR()
+
+  Without it tickAttach() fails as on other boards.
+*/
+
+#ifndef _SIXFAB_TICK_H
+#define _SIXFAB_TICK_H
+
+#include <Arduino.h>
+
+#if defined(__AVR__) && defined(TIMSK0) && defined(OCIE0A)
+  #define SIXFAB_HAS_TICK
+#endif
+
+#if defined(SIXFAB_HAS_TICK)
+  #include <avr/interrupt.h>
+  // emits tick interrupt, once in sketch
+  #define SIXFAB_TICK_ISR() \
+    ISR(TIMER0_COMPA_vect) { tickInterrupt(); } \
+    bool tickVectorLinked() { return true; }
+#else
+  #define SIXFAB_TICK_ISR()
+#endif
+
+#define TICK_HANDLER_COUNT 3 // max attached handlers
+
+// called about every ms from interrupt, must be short
+typedef void (*NBIoT_TickHandler)(void *context);
+
+/*
+Function for calling [param #1] about every ms from timer interrupt
+
+[return] : bool false if tick isn't available or all handlers are in use
+---
+[param #1] : NBIoT_TickHandler handler
+[param #2] : void* context that passed to handler
+*/
+bool tickAttach(NBIoT_TickHandler, void *);
+
+/*
+Function for removing handler attached with same context
+
+[no-return]
+---
+[param #1] : NBIoT_TickHandler handler
+[param #2] : void* context
+*/
+void tickDetach(NBIoT_TickHandler, void *);
+
+/*
+Function for calling attached handlers, called from SIXFAB_TICK_ISR()
+
+[no-return]
+---
+[no-param]
+*/
+void tickInterrupt();
+
+/*
+Function for checking if SIXFAB_TICK_ISR() is in sketch. Defined weak by
+library, the macro overrides it.
+
+[return] : bool true if tick interrupt is linked
+---
+[no-param]
+*/
+bool tickVectorLinked();
+
+#endif
@@ -0,0 +1,103 @@
+/*
+  Sixfab_Time.cpp
+  -
+  Network time service of Sixfab Arduino NBIoT Shield.
+*/
+
+#include "Sixfab_Time.h"
+
+SixfabTime::SixfabTime(SixfabNBIoT &nbiot)
+  : node(nbiot)
+{
+  slept = 0;
+  sync_epoch = sync_mono = last_try = 0;
+  zone = 0;
+  synced = updated = false;
+}
+
+bool SixfabTime::begin()
+{
+  node.setURCHandler(on_line, this);
+  node.queryLines(CMD_CTZR_ON, NULL, NULL); // not supported by older firmware, AT+CCLK? is still used
+  return sync();
+}
+
+bool SixfabTime::sync()
+{
+  last_try = monotonic();
+  updated = false;
+  return node.queryLines(CMD_CCLK_READ, on_line, this) && updated;
+}
+
+void SixfabTime::poll()
+{
+  uint32_t elapsed = monotonic() - (synced ? sync_mono : last_try);
+
+  if(elapsed >= (synced ? TIME_SYNC_INTERVAL : TIME_RETRY_INTERVAL))
+    sync();
+}
+
+void SixfabTime::set(uint32_t epoch)
+{
+  sync_epoch = epoch;
+  sync_mono = monotonic();
+  synced = true;
+}
+
+void SixfabTime::addSleep(uint32_t ms)
+{
+  slept += ms;
+}
+
+uint32_t SixfabTime::monotonic()
+{
+  return millis() + slept;
+}
+
+uint32_t SixfabTime::now()
+{
+  return toEpoch(monotonic());
+}
+
+uint32_t SixfabTime::toEpoch(uint32_t stamp)
+{
+  if(!synced)
+    return 0;
+  return sync_epoch + (int32_t)(stamp - sync_mono) / 1000;
+}
+
+uint16_t SixfabTime::toOffset(uint32_t stamp, uint32_t base)
+{
+  uint32_t epoch = toEpoch(stamp);
+
+  if(epoch < base)
+    return 0;
+  return (epoch - base > TIME_OFFSET_MAX) ? TIME_OFFSET_MAX : epoch - base;
+}
+
+bool SixfabTime::isSynced()
+{
+  return synced;
+}
+
+int8_t SixfabTime::getZone()
+{
+  return zone;
+}
+
+// +CCLK response or +CTZEU URC
+void SixfabTime::on_line(char *line, void *context)
+{
+  SixfabTime *time = (SixfabTime *)context;
+  uint32_t epoch;
+  int8_t tz;
+
+  if(!parseClock(line, &epoch, &tz) || epoch < TIME_VALID_AFTER)
+    return;
+
+  if(!time->synced)
+    LOG_INFO("TIME", "Synced");
+  time->set(epoch);
+  time->zone = tz;
+  time->updated = true;
+}
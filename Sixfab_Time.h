@@ -0,0 +1,153 @@
+/*
+  Sixfab_Time.h
+  -
+  Network time service of Sixfab Arduino NBIoT Shield.
+  UTC time is read from module with AT+CCLK? and taken from +CTZEU NITZ
+  URCs seen by command engine. Time is kept as an offset against a
+  monotonic ms tick, that is millis() plus sleep time reported with
+  addSleep(), so samples can be stamped with monotonic() when they are
+  taken and converted to epoch later, e.g. when a batch is sent.
+*/
+
+#ifndef _SIXFAB_TIME_H
+#define _SIXFAB_TIME_H
+
+#include "Sixfab_NBIoT.h"
+
+#define TIME_SYNC_INTERVAL 21600000UL // ms between readings after sync, 6 h
+#define TIME_RETRY_INTERVAL 60000UL // ms between readings until first sync
+#define TIME_VALID_AFTER 1577836800UL // 2020-01-01, older module clock isn't set by network
+#define TIME_OFFSET_MAX 0xFFFF // saturated value of toOffset()
+
+class SixfabTime
+{
+  public:
+
+    /*
+    Constructor
+
+    [no-return]
+    ---
+    [param #1] : SixfabNBIoT& initialized node
+    */
+    SixfabTime(SixfabNBIoT &);
+
+    /*
+    Function for enabling NITZ reports, taking URCs of node and reading
+    time once. Uses URC handler of node.
+
+    [return] : bool true if time is synced
+    ---
+    [no-param]
+    */
+    bool begin();
+
+    /*
+    Function for reading time of module with AT+CCLK?
+
+    [return] : bool true if a valid network time is read
+    ---
+    [no-param]
+    */
+    bool sync();
+
+    /*
+    Function for reading time again when TIME_SYNC_INTERVAL passed, or
+    TIME_RETRY_INTERVAL until first sync. Should be called from loop().
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void poll();
+
+    /*
+    Function for setting time from another source, e.g. server response
+
+    [no-return]
+    ---
+    [param #1] : uint32_t seconds since 1970-01-01 UTC
+    */
+    void set(uint32_t);
+
+    /*
+    Function for adding time that millis() didn't count, e.g. power down
+    sleep timed by watchdog.
+
+    [no-return]
+    ---
+    [param #1] : uint32_t slept ms
+    */
+    void addSleep(uint32_t);
+
+    /*
+    Function for getting monotonic tick, for stamping samples
+
+    [return] : uint32_t ms, millis() plus slept time
+    ---
+    [no-param]
+    */
+    uint32_t monotonic();
+
+    /*
+    Function for getting current time
+
+    [return] : uint32_t seconds since 1970-01-01 UTC, 0 if not synced
+    ---
+    [no-param]
+    */
+    uint32_t now();
+
+    /*
+    Function for converting a monotonic() stamp to time. Stamps taken
+    before sync are converted too, within 24 days of sync.
+
+    [return] : uint32_t seconds since 1970-01-01 UTC, 0 if not synced
+    ---
+    [param #1] : uint32_t monotonic() stamp
+    */
+    uint32_t toEpoch(uint32_t);
+
+    /*
+    Function for getting compact time of a monotonic() stamp, relative to
+    base time of a batch.
+
+    [return] : uint16_t seconds after base, TIME_OFFSET_MAX if later, 0 if earlier or not synced
+    ---
+    [param #1] : uint32_t monotonic() stamp
+    [param #2] : uint32_t base time, seconds since 1970-01-01 UTC
+    */
+    uint16_t toOffset(uint32_t, uint32_t);
+
+    /*
+    Function for checking if time is known
+
+    [return] : bool true if synced
+    ---
+    [no-param]
+    */
+    bool isSynced();
+
+    /*
+    Function for getting time zone reported by network
+
+    [return] : int8_t time zone in quarter hours
+    ---
+    [no-param]
+    */
+    int8_t getZone();
+
+  private:
+    SixfabNBIoT &node;
+    uint32_t slept;      // ms added to millis()
+    uint32_t sync_epoch; // time at sync_mono
+    uint32_t sync_mono;  // monotonic() of last sync
+    uint32_t last_try;   // monotonic() of last AT+CCLK?
+    int8_t zone;
+    bool synced;
+    bool updated;        // a valid time is parsed since last reading
+
+    static void on_line(char *line, void *context);
+};
+
+#endif
@@ -0,0 +1,214 @@
+/*
+  Sixfab_UplinkScheduler.cpp
+  -
+  Coverage-aware uplink scheduler for Sixfab Arduino NBIoT Shield.
+*/
+
+#include "Sixfab_UplinkScheduler.h"
+#include "Sixfab_Time.h"
+
+SixfabUplinkScheduler::SixfabUplinkScheduler(SixfabNBIoT &node, SixfabLinkMonitor &monitor, SixfabTime *clock)
+  : node(node), monitor(monitor), time(clock)
+{
+  memset(queue, 0, sizeof(queue));
+  next_id = 0;
+  unreported_count = 0;
+  stats_valid = false;
+  stats_time = 0;
+  refresh_interval = UPLINK_REFRESH_INTERVAL;
+  callback = NULL;
+  callback_context = NULL;
+  tx_mw_max = TX_POWER_MW_MAX;
+  tx_mw_min = TX_POWER_MW_MIN;
+  rx_mw = RX_POWER_MW;
+  bulk_snr = 50; // 5 dB
+  sent_count = deferred_count = expired_count = failed_count = energy_total = 0;
+}
+
+// queue message, urgent ones are sent immediately
+uint8_t SixfabUplinkScheduler::submit(const uint8_t *data, uint16_t len, NBIoT_Priority priority, uint32_t max_delay)
+{
+  if(len > UDP_DATA_LEN)
+    return 0;
+
+  for(uint8_t i = 0; i < UPLINK_QUEUE_LEN; i++){
+    Slot &slot = queue[i];
+    if(slot.id)
+      continue;
+
+    if(++next_id == 0)
+      next_id = 1;
+
+    slot.data = data;
+    slot.len = len;
+    slot.id = next_id;
+    slot.priority = priority;
+    slot.deferred = false;
+    slot.refused = 0;
+    slot.queued_at = now();
+    slot.max_delay = max_delay;
+
+    if(priority == PRIORITY_URGENT)
+      send(slot, false);
+    return next_id;
+  }
+  return 0;
+}
+
+// send messages whose coverage condition or deadline is met
+void SixfabUplinkScheduler::poll()
+{
+  if(!pending() && !unreported_count)
+    return;
+
+  if(!stats_valid || now() - stats_time >= refresh_interval)
+    refresh();
+
+  for(uint8_t i = 0; i < UPLINK_QUEUE_LEN; i++){
+    Slot &slot = queue[i];
+    if(!slot.id)
+      continue;
+
+    bool expired = now() - slot.queued_at >= slot.max_delay;
+    if(ready(slot) || expired){
+      send(slot, expired && !ready(slot));
+    }
+    else if(!slot.deferred){
+      slot.deferred = true;
+      deferred_count++;
+    }
+  }
+}
+
+// number of waiting messages
+uint8_t SixfabUplinkScheduler::pending()
+{
+  uint8_t count = 0;
+  for(uint8_t i = 0; i < UPLINK_QUEUE_LEN; i++)
+    if(queue[i].id)
+      count++;
+  return count;
+}
+
+void SixfabUplinkScheduler::setSentCallback(NBIoT_UplinkCallback cb, void *context)
+{
+  callback = cb;
+  callback_context = context;
+}
+
+void SixfabUplinkScheduler::setEnergyModel(uint16_t tx_max, uint16_t tx_min, uint16_t rx)
+{
+  tx_mw_max = tx_max;
+  tx_mw_min = tx_min;
+  rx_mw = rx;
+}
+
+void SixfabUplinkScheduler::setBulkSNR(int16_t snr)
+{
+  bulk_snr = snr;
+}
+
+void SixfabUplinkScheduler::setRefreshInterval(uint32_t interval)
+{
+  refresh_interval = interval;
+}
+
+// read NUESTATS, update monitor and report energy of messages sent since last reading
+void SixfabUplinkScheduler::refresh()
+{
+  NBIoT_UEStats stats;
+
+  stats_time = now();
+  if(!node.readUEStats(&stats))
+    return;
+
+  monitor.update(stats);
+
+  if(stats_valid && unreported_count && (stats.fields & last_stats.fields & UESTATS_TX_TIME)){
+    uint32_t tx_time = stats.tx_time - last_stats.tx_time;
+    uint32_t rx_time = (stats.fields & last_stats.fields & UESTATS_RX_TIME) ? stats.rx_time - last_stats.rx_time : 0;
+    uint32_t tx_mw = tx_power_mw((stats.fields & UESTATS_TX_POWER) ? stats.tx_power : TX_POWER_UNKNOWN);
+
+    for(uint8_t i = 0; i < unreported_count; i++){
+      NBIoT_UplinkReport &report = unreported[i];
+      report.tx_time = tx_time / unreported_count;
+      report.energy = report.tx_time * tx_mw + (rx_time / unreported_count) * rx_mw; // ms * mW = uJ
+      energy_total += report.energy;
+      if(callback)
+        callback(&report, callback_context);
+    }
+    unreported_count = 0;
+  }
+
+  last_stats = stats;
+  stats_valid = true;
+}
+
+// check coverage condition of message priority
+bool SixfabUplinkScheduler::ready(const Slot &slot)
+{
+  switch(slot.priority){
+    case PRIORITY_URGENT:
+      return true;
+    case PRIORITY_NORMAL:
+      return monitor.uplinkAllowed(1);
+    default:
+      return monitor.uplinkAllowed(0) && monitor.snr.count && monitor.snr.avg >= bulk_snr;
+  }
+}
+
+// send message and free its slot, refused message is kept for next poll
+bool SixfabUplinkScheduler::send(Slot &slot, bool expired)
+{
+  if(!node.sendDataUDP(slot.data, slot.len)){
+    if(slot.refused < 0xFF)
+      slot.refused++;
+    if(now() - slot.queued_at < slot.max_delay || slot.refused < UPLINK_SEND_ATTEMPTS)
+      return false;
+
+    NBIoT_UplinkReport report;
+    report.id = slot.id;
+    report.ecl = monitor.ecl;
+    report.expired = expired;
+    report.failed = true;
+    report.tx_time = 0;
+    report.energy = 0;
+    failed_count++;
+    slot.id = 0;
+    if(callback)
+      callback(&report, callback_context);
+    return false;
+  }
+
+  sent_count++;
+  if(expired)
+    expired_count++;
+
+  if(unreported_count < UPLINK_QUEUE_LEN){
+    NBIoT_UplinkReport &report = unreported[unreported_count++];
+    report.id = slot.id;
+    report.ecl = monitor.ecl;
+    report.expired = expired;
+    report.failed = false;
+    report.tx_time = 0;
+    report.energy = 0;
+  }
+  slot.id = 0;
+  return true;
+}
+
+// TX power consumption for output power in 0.1 dBm, linear between 0 and 23 dBm
+uint16_t SixfabUplinkScheduler::tx_power_mw(int16_t tx_power)
+{
+  if(tx_power == TX_POWER_UNKNOWN || tx_power >= 230)
+    return tx_mw_max;
+  if(tx_power <= 0)
+    return tx_mw_min;
+  return tx_mw_min + (uint32_t)(tx_mw_max - tx_mw_min) * tx_power / 230;
+}
+
+// clock of deadlines, counts sleep if time service is given
+uint32_t SixfabUplinkScheduler::now()
+{
+  return time ? time->monotonic() : millis();
+}
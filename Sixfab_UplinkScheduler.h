@@ -0,0 +1,185 @@
+/*
+  Sixfab_UplinkScheduler.h
+  -
+  Coverage-aware uplink scheduler for Sixfab Arduino NBIoT Shield.
+  Urgent messages are sent at once, deferrable messages wait in queue 
+  until radio conditions are good enough for their priority or their 
+  deadline expires. TX energy of sent messages is estimated from the 
+  TX time counter of AT+NUESTATS.
+
+  Waiting time of messages is measured with SixfabTime::monotonic() if a 
+  time service is given, so deadlines expire over power down sleep 
+  reported with SixfabTime::addSleep(). Without it millis() is used, 
+  which stops while MCU sleeps.
+*/
+
+#ifndef _SIXFAB_UPLINKSCHEDULER_H
+#define _SIXFAB_UPLINKSCHEDULER_H
+
+#include "Sixfab_NBIoT.h"
+
+#define UPLINK_QUEUE_LEN 4 // max number of waiting messages
+#define UPLINK_REFRESH_INTERVAL 30000 // ms between NUESTATS readings while messages wait
+#define UPLINK_SEND_ATTEMPTS 3 // refused sends before a message past its deadline is dropped
+
+// Default energy model of BC95 at 3.6 V supply, in mW
+#define TX_POWER_MW_MAX 792 // at 23 dBm output
+#define TX_POWER_MW_MIN 396 // at 0 dBm output and below
+#define RX_POWER_MW 166
+
+enum NBIoT_Priority {
+  PRIORITY_URGENT, // send at once regardless of coverage
+  PRIORITY_NORMAL, // send when ECL <= 1
+  PRIORITY_BULK    // send when ECL is 0 and SNR is good
+};
+
+// report of a sent message, passed to sent callback
+typedef struct {
+  uint8_t id;          // id given by submit()
+  uint8_t ecl;         // ECL at send time, 0xFF if unknown
+  bool expired;        // sent because deadline is expired
+  bool failed;         // module kept refusing message after deadline, message is dropped
+  uint32_t tx_time;    // ms of TX time attributed to message
+  uint32_t energy;     // estimated radio energy in uJ
+} NBIoT_UplinkReport;
+
+typedef void (*NBIoT_UplinkCallback)(const NBIoT_UplinkReport *report, void *context);
+
+class SixfabUplinkScheduler
+{
+  public:
+
+    /*
+    Constructor
+
+    [no-return]
+    ---
+    [param #1] : SixfabNBIoT& initialized node that sends messages
+    [param #2] : SixfabLinkMonitor& monitor that updated with fresh NUESTATS readings
+    [param #3] : SixfabTime* clock of deadlines, NULL for millis()
+    */
+    SixfabUplinkScheduler(SixfabNBIoT &, SixfabLinkMonitor &, SixfabTime * = NULL);
+
+    /*
+    Function for queueing a message. Data isn't copied, buffer must be kept 
+    valid until sent callback is called for message. Urgent messages are sent 
+    before function returns. A message that module refuses stays in queue and 
+    is sent again by poll(), after its deadline it is dropped once module 
+    has refused it UPLINK_SEND_ATTEMPTS times.
+
+    [return] : uint8_t message id, 0 if queue is full or data is too long
+    ---
+    [param #1] : const uint8_t* data
+    [param #2] : uint16_t data length, max UDP_DATA_LEN
+    [param #3] : NBIoT_Priority priority
+    [param #4] : uint32_t max time in ms that message can wait
+    */
+    uint8_t submit(const uint8_t *, uint16_t, NBIoT_Priority, uint32_t);
+
+    /*
+    Function for sending waiting messages when coverage allows. 
+    Should be called from loop().
+
+    [no-return]
+    ---
+    [no-param]
+    */
+    void poll();
+
+    /*
+    Function for getting number of waiting messages
+
+    [return] : uint8_t number of waiting messages
+    ---
+    [no-param]
+    */
+    uint8_t pending();
+
+    /*
+    Function for setting callback that called with energy report of sent 
+    messages. Report is given after the next NUESTATS reading, because module 
+    updates TX time after transmission is completed. Messages dropped because 
+    module refused them are reported at once with failed flag set.
+
+    [no-return]
+    ---
+    [param #1] : NBIoT_UplinkCallback callback
+    [param #2] : void* context that passed to callback
+    */
+    void setSentCallback(NBIoT_UplinkCallback, void *);
+
+    /*
+    Function for setting radio power figures used in energy estimation.
+
+    [no-return]
+    ---
+    [param #1] : uint16_t TX power consumption in mW at 23 dBm output
+    [param #2] : uint16_t TX power consumption in mW at 0 dBm output
+    [param #3] : uint16_t RX power consumption in mW
+    */
+    void setEnergyModel(uint16_t, uint16_t, uint16_t);
+
+    /*
+    Function for setting minimum average SNR (0.1 dB) for bulk messages.
+
+    [no-return]
+    ---
+    [param #1] : int16_t SNR threshold
+    */
+    void setBulkSNR(int16_t);
+
+    /*
+    Function for setting interval of NUESTATS readings while messages wait.
+
+    [no-return]
+    ---
+    [param #1] : uint32_t interval in ms
+    */
+    void setRefreshInterval(uint32_t);
+
+    uint32_t sent_count;     // total sent messages
+    uint32_t deferred_count; // messages that waited at least one poll for coverage
+    uint32_t expired_count;  // messages sent in bad coverage because of deadline
+    uint32_t failed_count;   // messages dropped because module refused them
+    uint32_t energy_total;   // estimated uJ of all reported messages
+
+  private:
+    typedef struct {
+      const uint8_t *data;
+      uint16_t len;
+      uint8_t id;  // 0 : slot is free
+      uint8_t priority;
+      bool deferred;
+      uint8_t refused; // sends refused by module
+      uint32_t queued_at; // now() at submit
+      uint32_t max_delay;
+    } Slot;
+
+    SixfabNBIoT &node;
+    SixfabLinkMonitor &monitor;
+    SixfabTime *time;
+    Slot queue[UPLINK_QUEUE_LEN];
+    uint8_t next_id;
+
+    // messages sent since last NUESTATS reading, waiting for energy report
+    NBIoT_UplinkReport unreported[UPLINK_QUEUE_LEN];
+    uint8_t unreported_count;
+
+    NBIoT_UEStats last_stats;
+    bool stats_valid;
+    uint32_t stats_time; // now() of last NUESTATS reading
+    uint32_t refresh_interval;
+
+    NBIoT_UplinkCallback callback;
+    void *callback_context;
+    uint16_t tx_mw_max, tx_mw_min, rx_mw;
+    int16_t bulk_snr;
+
+    void refresh();
+    bool ready(const Slot &);
+    bool send(Slot &, bool expired);
+    uint16_t tx_power_mw(int16_t tx_power);
+    uint32_t now();
+};
+
+#endif
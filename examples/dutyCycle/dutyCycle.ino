@@ -0,0 +1,259 @@
+/*
+  dutyCycle.ino - Measures full duty cycle of a sensor node.
+  -
+  Every cycle runs attach, sample, encode, send, receive and sleep phases
+  and prints one CSV row per phase and a summary row per cycle to DEBUG,
+  after a "# config=..." line with the settings :
+
+    phase,<config>,<cycle>,<name>,<ms>,<uart tx bytes>,<uart rx bytes>
+    cycle,<config>,<cycle>,<total ms>,<busy ms>,<uart bytes>,<payload bytes>,<radio tx ms>,<radio rx ms>,<energy uJ>
+
+  Busy time is cycle time without sleep. Energy is radio energy from TX / RX
+  time counters of AT+NUESTATS plus BENCH_AWAKE_MW during busy time. UART
+  bytes of these AT+NUESTATS readings aren't counted. First cycle includes
+  init phase. Change settings below and compare rows to see effect on
+  latency and bytes on air, rows of each setting are labelled with
+  BENCH_CONFIG. extras/test/duty_cycle.cpp runs this sketch on a PC
+  against an emulated BC95 for a matrix of settings and gives the same
+  rows on every run.
+*/
+
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+  #include <SoftwareSerial.h> // DEBUG on pins 10 / 11, see SIXFAB_DEBUG_SERIAL()
+#endif
+#include "Sixfab_NBIoT.h"
+#include "Sixfab_UplinkScheduler.h"
+#include "Sixfab_Compress.h"
+#include "Sixfab_Secure.h"
+
+// Settings, can be given as build flags
+#ifndef BENCH_CONFIG
+  #define BENCH_CONFIG "sketch" // label of rows
+#endif
+#define BENCH_CYCLES 10      // cycles measured, 0 for no limit
+#ifndef BENCH_BATCH
+  #define BENCH_BATCH 4      // samples sent in one datagram
+#endif
+#ifndef BENCH_COMPRESS
+  #define BENCH_COMPRESS 1   // 1 : delta coded samples, 0 : raw int32_t samples
+#endif
+#ifndef BENCH_SECURE
+  #define BENCH_SECURE 0     // 1 : sealed with SixfabSecure, needs a stored key
+#endif
+#define BENCH_RX_WAIT 2000   // ms waited for a downlink after send
+#define BENCH_SLEEP 10000    // ms between cycles
+#define BENCH_AWAKE_MW 60    // power of MCU and idle modem while awake
+#define BENCH_CHANNELS 6     // ax, ay, az (mg), temperature (0.01 C), humidity (0.01 %), light (adc)
+
+// counts bytes passing through modem serial port
+class CountingStream : public Stream
+{
+  public:
+    CountingStream(Stream &port) : port(port), tx(0), rx(0) {}
+
+    int available() { return port.available(); }
+    int peek() { return port.peek(); }
+    void flush() { port.flush(); }
+    int read()
+    {
+      int c = port.read();
+      if(c >= 0)
+        rx++;
+      return c;
+    }
+    size_t write(uint8_t c)
+    {
+      tx++;
+      return port.write(c);
+    }
+
+    Stream &port;
+    uint32_t tx;
+    uint32_t rx;
+};
+
+SIXFAB_DEBUG_SERIAL()
+CountingStream modem_port(BC95_AT);
+SixfabNBIoT node(modem_port, Wire, &DEBUG);
+#if BENCH_SECURE
+SixfabSecure secure;
+#endif
+
+char your_ip[] = "xx.xx.xx.xx";
+char your_port[] = "xxxx";
+
+uint8_t batch[UDP_DATA_LEN];
+#if BENCH_COMPRESS
+SixfabDeltaEncoder encoder(batch, sizeof(batch), BENCH_CHANNELS);
+#endif
+uint16_t batch_len = 0;
+uint8_t batch_count = 0;
+uint8_t datagram[UDP_DATA_LEN];
+uint8_t downlink[UDP_DATA_LEN];
+int32_t sample[BENCH_CHANNELS];
+
+uint32_t cycle = 0;
+uint32_t cycle_start, phase_start, phase_tx, phase_rx;
+uint32_t busy_ms, uart_bytes, payload_bytes;
+NBIoT_UEStats stats_start;
+
+void begin_ports(uint32_t baud)
+{
+  static bool debug_started = false;
+
+  BC95_AT.begin(baud);
+  if(!debug_started){
+    DEBUG.begin(DEBUG_BAUD);
+    debug_started = true;
+  }
+}
+
+void start_phase()
+{
+  sixfabLog.flush(); // log output isn't measured
+  phase_start = millis();
+  phase_tx = modem_port.tx;
+  phase_rx = modem_port.rx;
+}
+
+void end_phase(const __FlashStringHelper *name, bool busy = true)
+{
+  uint32_t ms = millis() - phase_start;
+
+  if(busy)
+    busy_ms += ms;
+  uart_bytes += (modem_port.tx - phase_tx) + (modem_port.rx - phase_rx);
+  DEBUG.print(F("phase," BENCH_CONFIG ",")); DEBUG.print(cycle);
+  DEBUG.print(','); DEBUG.print(name);
+  DEBUG.print(','); DEBUG.print(ms);
+  DEBUG.print(','); DEBUG.print(modem_port.tx - phase_tx);
+  DEBUG.print(','); DEBUG.println(modem_port.rx - phase_rx);
+}
+
+void read_stats(NBIoT_UEStats *stats)
+{
+  if(!node.readUEStats(stats) || !(stats->fields & UESTATS_TX_TIME) || !(stats->fields & UESTATS_RX_TIME))
+    stats->tx_time = stats->rx_time = 0;
+}
+
+// ------------------------------------------------------------------
+// ------------------------- SETUP ----------------------------------
+// ------------------------------------------------------------------
+void setup() {
+
+  node.setBaudHandler(begin_ports);
+  begin_ports(BC95_BAUD); // header goes out before first row
+
+  DEBUG.print(F("# config=" BENCH_CONFIG " batch=")); DEBUG.print(BENCH_BATCH);
+  DEBUG.print(F(" compress=")); DEBUG.print(BENCH_COMPRESS);
+  DEBUG.print(F(" secure=")); DEBUG.println(BENCH_SECURE);
+
+  cycle_start = millis();
+  busy_ms = uart_bytes = 0;
+  start_phase();
+  node.init();
+  node.setIPAddress(your_ip);
+  node.setPort(your_port);
+#if BENCH_SECURE
+  if(!secure.begin())
+    DEBUG.println(F("# no key stored, datagrams are sent in plain"));
+#endif
+  end_phase(F("init"));
+  DEBUG.print(F("# baud=")); DEBUG.println(node.getModemBaud());
+}
+// ------------------------------------------------------------------
+// --------------------------- LOOP ---------------------------------
+// ------------------------------------------------------------------
+void loop() {
+
+  if(BENCH_CYCLES && cycle == BENCH_CYCLES)
+    return;
+  if(cycle){
+    cycle_start = millis();
+    busy_ms = uart_bytes = 0;
+  }
+  payload_bytes = 0;
+
+  // attach, returns at once if still registered
+  start_phase();
+  node.connectToOperator();
+  if(cycle == 0)
+    node.startUDPService();
+  end_phase(F("attach"));
+  read_stats(&stats_start);
+
+  start_phase();
+  NBIoT_Snapshot snapshot;
+  node.sampleAll(&snapshot);
+  sample[0] = snapshot.accel[0];
+  sample[1] = snapshot.accel[1];
+  sample[2] = snapshot.accel[2];
+  sample[3] = snapshot.temperature;
+  sample[4] = snapshot.humidity;
+  sample[5] = snapshot.light;
+  end_phase(F("sample"));
+
+  start_phase();
+#if BENCH_COMPRESS
+  if(encoder.add(sample))
+    batch_count++;
+  batch_len = encoder.length();
+#else
+  if(batch_len + sizeof(sample) <= sizeof(batch)){
+    memcpy(batch + batch_len, sample, sizeof(sample));
+    batch_len += sizeof(sample);
+    batch_count++;
+  }
+#endif
+  uint16_t len = batch_len;
+  bool full = batch_count == BENCH_BATCH;
+  if(full){
+    memcpy(datagram, batch, batch_len);
+#if BENCH_SECURE
+    if(sizeof(datagram) - batch_len >= SECURE_OVERHEAD && secure.seal(batch, batch_len, datagram))
+      len = batch_len + SECURE_OVERHEAD;
+#endif
+  }
+  end_phase(F("encode"));
+
+  start_phase();
+  if(full){
+    node.sendDataUDP(datagram, len);
+    payload_bytes = len;
+#if BENCH_COMPRESS
+    encoder.reset();
+#endif
+    batch_len = batch_count = 0;
+  }
+  end_phase(F("send"));
+
+  start_phase();
+  if(full && node.waitData(0, BENCH_RX_WAIT))
+    node.receiveDataUDP(downlink, sizeof(downlink));
+  end_phase(F("receive"));
+
+  NBIoT_UEStats stats;
+  read_stats(&stats);
+
+  start_phase();
+  delay(BENCH_SLEEP);
+  end_phase(F("sleep"), false);
+
+  uint32_t tx_ms = 0, rx_ms = 0;
+  if(stats.tx_time >= stats_start.tx_time && stats.rx_time >= stats_start.rx_time){
+    tx_ms = stats.tx_time - stats_start.tx_time;
+    rx_ms = stats.rx_time - stats_start.rx_time;
+  }
+  uint32_t energy = tx_ms * TX_POWER_MW_MAX + rx_ms * RX_POWER_MW + busy_ms * BENCH_AWAKE_MW; // ms * mW = uJ
+
+  DEBUG.print(F("cycle," BENCH_CONFIG ",")); DEBUG.print(cycle);
+  DEBUG.print(','); DEBUG.print(millis() - cycle_start);
+  DEBUG.print(','); DEBUG.print(busy_ms);
+  DEBUG.print(','); DEBUG.print(uart_bytes);
+  DEBUG.print(','); DEBUG.print(payload_bytes);
+  DEBUG.print(','); DEBUG.print(tx_ms);
+  DEBUG.print(','); DEBUG.print(rx_ms);
+  DEBUG.print(','); DEBUG.println(energy);
+
+  cycle++;
+}
@@ -3,9 +3,18 @@
   Created by Yasin Kaya (selengalp), September 17, 2018.
 */
 
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+  #include <SoftwareSerial.h> // DEBUG on pins 10 / 11, see SIXFAB_DEBUG_SERIAL()
+#endif
 #include "Sixfab_NBIoT.h"
+#include "Sixfab_Actuator.h"
 
+SIXFAB_DEBUG_SERIAL()
 SixfabNBIoT node;
+SixfabActuator actuators;
+SIXFAB_TICK_ISR() // runs actuators from Timer0 while modem is busy
+
+bool actuators_ticked; // false : poll() from loop()
 
 char your_ip[] = "xx.xx.xx.xx";
 char your_port[] = "xxxx";
@@ -17,14 +26,9 @@ double ax, ay, az;
 void setup() {
   
   node.init();
-  node.turnOnUserLED();
-  delay(TIMEOUT);
-  node.turnOffUserLED();
-  delay(TIMEOUT);
-  node.turnOnRelay();
-  delay(TIMEOUT);
-  node.turnOffRelay();
-  delay(TIMEOUT);
+  actuators_ticked = actuators.begin();
+  actuators.pulse(ACTUATOR_LED, TIMEOUT);
+  actuators.schedule(ACTUATOR_RELAY, TIMEOUT, TIMEOUT); // turned off on time while modem is busy, if ticked
 
   node.readAccel(&ax, &ay, &az);
   DEBUG.print("ax: "); DEBUG.println(ax);
@@ -44,10 +48,14 @@ void setup() {
 
   node.startUDPService();
   node.sendDataUDP("Hello World from Sixfab Crew");
+
+  sixfabLog.flush(); // write buffered library log
 }
 // ------------------------------------------------------------------
 // --------------------------- LOOP ---------------------------------
 // ------------------------------------------------------------------
 void loop() {
 
+  if(!actuators_ticked)
+    actuators.poll();
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+/*
+  fuzz.h
+  -
+  Shared helpers of fuzz targets. Inputs are copied to buffers of their
+  exact size, so AddressSanitizer catches reads past the end.
+*/
+
+#ifndef _FUZZ_H
+#define _FUZZ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+// NUL terminated copy of input, free() after use
+static inline char *fuzz_line(const uint8_t *data, size_t size)
+{
+  char *line = (char *)malloc(size + 1);
+  memcpy(line, data, size);
+  line[size] = '\0';
+  return line;
+}
+
+#endif
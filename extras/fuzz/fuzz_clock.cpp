@@ -0,0 +1,20 @@
+/*
+  fuzz_clock.cpp - parseClock() of Sixfab_RadioStats.cpp
+  -
+  Lines of AT+CCLK? and +CTZEU URC. Parsed time must be a valid date.
+*/
+
+#include "fuzz.h"
+#include "Sixfab_RadioStats.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  char *line = fuzz_line(data, size);
+  uint32_t epoch = 0;
+  int8_t zone = 0;
+
+  if(parseClock(line, &epoch, &zone) && (zone < -96 || zone > 96))
+    abort();
+  free(line);
+  return 0;
+}
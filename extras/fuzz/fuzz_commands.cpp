@@ -0,0 +1,71 @@
+/*
+  fuzz_commands.cpp - SixfabCommands::dispatch() of Sixfab_Commands.cpp
+  -
+  Input is a downlink. Dispatcher starts from erased EEPROM for every
+  input, a sketch table overrides a built-in opcode and adds one, AT
+  commands of OP_PSM are answered by the BC95 emulator of extras/test.
+  Acknowledges are packed after dispatch, at most one per command.
+*/
+
+#include "fuzz.h"
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "bc95_emulator.h"
+#include "Sixfab_Commands.h"
+
+static uint8_t on_sketch(const uint8_t *args, void *context)
+{
+  (void)context;
+  return args[0] & 0x07; // any status, unknown ones included
+}
+
+static uint8_t on_bare(const uint8_t *args, void *context)
+{
+  (void)args; (void)context;
+  return ACK_OK;
+}
+
+static const NBIoT_CommandEntry sketch_table[] PROGMEM = {
+  {OP_SWITCH, 3, on_sketch},
+  {0x40, 0, on_bare},
+  {0x41, 7, on_sketch},
+};
+
+static BC95Emulator bc95;
+static SixfabNBIoT node(Serial1, Wire);
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  static bool started = false;
+  uint8_t acks[COMMAND_ACK_COUNT * COMMAND_ACK_LEN + 1];
+
+  if(!started){
+    Serial1.hostAttach(&bc95);
+    node.setTimeout(50);
+    sixfabLog.setLevel(LOG_LEVEL_NONE);
+    started = true;
+  }
+  if(size > 0xFFFF)
+    return 0;
+
+  uint8_t *downlink = (uint8_t *)malloc(size ? size : 1);
+  memcpy(downlink, data, size);
+
+  EEPROM.erase();
+  SixfabCommands commands(node);
+  commands.begin();
+  if(size && (data[0] & 1))
+    commands.setHandlers(sketch_table, sizeof(sketch_table) / sizeof(sketch_table[0]), NULL);
+
+  uint8_t run = commands.dispatch(downlink, size);
+  uint8_t len = commands.pack(acks, sizeof(acks));
+  if(run > size / 2 || len % COMMAND_ACK_LEN || len > COMMAND_ACK_COUNT * COMMAND_ACK_LEN)
+    abort();
+
+  // drop replies of PSM commands before next input
+  hostAdvance(10000000ULL);
+  while(Serial1.available())
+    Serial1.read();
+  free(downlink);
+  return 0;
+}
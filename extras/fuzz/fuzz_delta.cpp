@@ -0,0 +1,43 @@
+/*
+  fuzz_delta.cpp - deltaDecode() of Sixfab_Compress.cpp
+  -
+  First byte selects channel count, rest is the coded batch. Decoded
+  samples are coded again and must decode to the same samples.
+*/
+
+#include "fuzz.h"
+#include "Sixfab_Compress.h"
+
+#define FUZZ_SAMPLES 64
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  int32_t samples[FUZZ_SAMPLES * COMPRESS_CHANNELS];
+
+  if(size < 1 || size > 0xFFFF)
+    return 0;
+
+  uint8_t channels = data[0] % COMPRESS_CHANNELS + 1;
+  uint16_t len = size - 1;
+  uint8_t *batch = (uint8_t *)malloc(len ? len : 1);
+  memcpy(batch, data + 1, len);
+
+  uint16_t count = deltaDecode(batch, len, channels, samples, FUZZ_SAMPLES);
+  if(count > FUZZ_SAMPLES)
+    abort();
+
+  // varints may carry redundant zero groups, so only decoded values are compared
+  uint8_t coded[FUZZ_SAMPLES * COMPRESS_CHANNELS * COMPRESS_VARINT_LEN];
+  int32_t again[FUZZ_SAMPLES * COMPRESS_CHANNELS];
+  SixfabDeltaEncoder encoder(coded, sizeof(coded), channels);
+  for(uint16_t i = 0; i < count; i++){
+    if(!encoder.add(samples + i * channels))
+      abort();
+  }
+  if(deltaDecode(coded, encoder.length(), channels, again, FUZZ_SAMPLES) != count ||
+     memcmp(again, samples, count * channels * sizeof(int32_t)) != 0)
+    abort();
+
+  free(batch);
+  return 0;
+}
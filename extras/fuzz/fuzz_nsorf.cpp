@@ -0,0 +1,45 @@
+/*
+  fuzz_nsorf.cpp - hex decoder of SixfabNBIoT::receiveData()
+  -
+  Input is the raw response of the BC95 emulator of extras/test to
+  AT+NSORF, e.g. "\r\n0,1.2.3.4,5683,4,DEADBEEF,0\r\n\r\nOK\r\n". First
+  byte selects receive buffer size, so truncation is fuzzed as well.
+  Payload must not be written past the buffer.
+*/
+
+#include "fuzz.h"
+#include "Arduino.h"
+#include "bc95_emulator.h"
+#include "Sixfab_NBIoT.h"
+
+static BC95Emulator bc95;
+static SixfabNBIoT node(Serial1, Wire);
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  static bool started = false;
+
+  if(!started){
+    Serial1.hostAttach(&bc95);
+    node.setTimeout(50);
+    sixfabLog.setLevel(LOG_LEVEL_NONE);
+    started = true;
+  }
+  if(size < 1 || size > BC95_REPLY_LEN)
+    return 0;
+
+  uint16_t capacity = data[0] * 2 + 1;
+  uint8_t *buffer = (uint8_t *)malloc(capacity);
+
+  bc95.setReply("AT+NSORF", data + 1, size - 1);
+  int16_t received = node.receiveData(0, buffer, capacity);
+  if(received > (int16_t)capacity || node.pendingData(0) > 0xFFFF)
+    abort();
+
+  // rest of reply isn't left for next input
+  hostAdvance(10000000ULL);
+  while(Serial1.available())
+    Serial1.read();
+  free(buffer);
+  return 0;
+}
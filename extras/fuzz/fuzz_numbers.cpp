@@ -0,0 +1,28 @@
+/*
+  fuzz_numbers.cpp - parseNumbers() of Sixfab_RadioStats.cpp
+  -
+  URC lines of sockets, parsed with each prefix and value count used by
+  the library. Values past the reported count must stay untouched.
+*/
+
+#include "fuzz.h"
+#include "Sixfab_RadioStats.h"
+
+static const char * const prefixes[] = {"+NSONMI:", "+NSOSTR:", "+NSOCLI:"};
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  char *line = fuzz_line(data, size);
+
+  for(uint8_t p = 0; p < sizeof(prefixes) / sizeof(prefixes[0]); p++){
+    for(uint8_t count = 1; count <= 3; count++){
+      uint32_t values[4] = {0xA5A5A5A5, 0xA5A5A5A5, 0xA5A5A5A5, 0xA5A5A5A5};
+      uint8_t parsed = parseNumbers(line, prefixes[p], values, count);
+
+      if(parsed > count || values[count] != 0xA5A5A5A5)
+        abort();
+    }
+  }
+  free(line);
+  return 0;
+}
@@ -0,0 +1,35 @@
+/*
+  fuzz_radio.cpp - response parsers of Sixfab_RadioStats.cpp
+  -
+  A line goes through parsers of AT+CSQ, AT+NUESTATS, AT+NUESTATS=CELL,
+  AT+CEREG?, AT+COPS? and AT+NBAND?, as read_result() would pass it to
+  any of them.
+*/
+
+#include "fuzz.h"
+#include "Sixfab_RadioStats.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  char *line = fuzz_line(data, size);
+  NBIoT_SignalQuality quality;
+  NBIoT_UEStats stats;
+  NBIoT_CellStats cell;
+  uint8_t stat = 0xFF;
+  char plmn[PLMN_LEN];
+  uint8_t bands[4];
+
+  memset(&stats, 0, sizeof(stats));
+  parseSignalQuality(line, &quality);
+  if(parseUEStatsLine(line, &stats) && stats.fields == 0)
+    abort();
+  parseCellStatsLine(line, &cell);
+  if(parseRegistration(line, &stat) && stat > CEREG_ROAMING)
+    abort();
+  if(parseOperator(line, plmn) && strlen(plmn) >= PLMN_LEN)
+    abort();
+  if(parseBands(line, bands, sizeof(bands)) > sizeof(bands))
+    abort();
+  free(line);
+  return 0;
+}
@@ -0,0 +1,130 @@
+/*
+  replay.cpp - driver of fuzz targets for compilers without libFuzzer
+  -
+  Runs every file given, or every file of a given directory, through
+  LLVMFuzzerTestOneInput(). With -n <count>, each input is also mutated
+  count times by a fixed seed pseudo random generator (bit flips, byte
+  inserts / deletes / copies, truncation), so a sanitizer build finds
+  shallow bugs without libFuzzer and failures are repeatable.
+*/
+
+#include "fuzz.h"
+#include <stdio.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define REPLAY_MAX_LEN 4096
+
+static uint32_t rng = 2463534242UL;
+
+static uint32_t next_random()
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static size_t mutate(uint8_t *data, size_t size)
+{
+  uint8_t steps = 1 + next_random() % 4;
+
+  while(steps--){
+    size_t at = size ? next_random() % size : 0;
+    switch(next_random() % 6){
+      case 0:
+        if(size)
+          data[at] ^= 1 << (next_random() % 8);
+        break;
+      case 1:
+        if(size)
+          data[at] = "0123456789,:\"+-\r\nAFOK"[next_random() % 21];
+        break;
+      case 2:
+        if(size < REPLAY_MAX_LEN){
+          memmove(data + at + 1, data + at, size - at);
+          data[at] = next_random();
+          size++;
+        }
+        break;
+      case 3:
+        if(size){
+          memmove(data + at, data + at + 1, size - at - 1);
+          size--;
+        }
+        break;
+      case 4:
+        size = at;
+        break;
+      case 5:
+        if(size){
+          size_t from = next_random() % size;
+          size_t len = next_random() % (size - from) + 1;
+          uint8_t copy[REPLAY_MAX_LEN];
+          if(size + len <= REPLAY_MAX_LEN){
+            memcpy(copy, data + from, len);
+            memmove(data + at + len, data + at, size - at);
+            memcpy(data + at, copy, len);
+            size += len;
+          }
+        }
+        break;
+    }
+  }
+  return size;
+}
+
+static void run_file(const char *path, uint32_t mutations)
+{
+  static uint8_t input[REPLAY_MAX_LEN], work[REPLAY_MAX_LEN];
+  FILE *file = fopen(path, "rb");
+
+  if(file == NULL)
+    return;
+  size_t size = fread(input, 1, sizeof(input), file);
+  fclose(file);
+
+  LLVMFuzzerTestOneInput(input, size);
+  for(uint32_t i = 0; i < mutations; i++){
+    memcpy(work, input, size);
+    size_t len = mutate(work, size);
+    LLVMFuzzerTestOneInput(work, len);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t mutations = 0;
+  uint32_t files = 0;
+
+  for(int i = 1; i < argc; i++){
+    struct stat info;
+
+    if(strcmp(argv[i], "-n") == 0 && i + 1 < argc){
+      mutations = strtoul(argv[++i], NULL, 10);
+      continue;
+    }
+    if(stat(argv[i], &info) != 0)
+      continue;
+    if(!S_ISDIR(info.st_mode)){
+      run_file(argv[i], mutations);
+      files++;
+      continue;
+    }
+
+    DIR *dir = opendir(argv[i]);
+    struct dirent *entry;
+    char path[1024];
+    while(dir && (entry = readdir(dir)) != NULL){
+      if(entry->d_name[0] == '.')
+        continue;
+      snprintf(path, sizeof(path), "%s/%s", argv[i], entry->d_name);
+      run_file(path, mutations);
+      files++;
+    }
+    if(dir)
+      closedir(dir);
+  }
+  printf("%u inputs, %u mutations each\n", files, mutations);
+  return 0;
+}
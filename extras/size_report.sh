@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+# size_report.sh - prints flash / SRAM usage of an example sketch.
+#
+# Usage : extras/size_report.sh [git-ref] [example] [fqbn]
+#   git-ref : optional revision to compare with, e.g. HEAD~1
+#   example : example name, default localHost
+#   fqbn    : board, default arduino:avr:uno
+#
+# Requires arduino-cli with the board core installed.
+
+set -e
+
+REF=$1
+EXAMPLE=${2:-localHost}
+FQBN=${3:-arduino:avr:uno}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+
+report() {
+  # $1 : label, $2 : library directory
+  BUILD=$(mktemp -d)
+  arduino-cli compile --fqbn "$FQBN" --library "$2" --build-path "$BUILD" \
+    "$2/examples/$EXAMPLE" > "$BUILD/compile.log" 2>&1 || { cat "$BUILD/compile.log"; exit 1; }
+  printf '%-12s ' "$1"
+  grep -E "^(Sketch uses|Global variables use)" "$BUILD/compile.log" | tr '\n' ' '
+  echo
+  rm -rf "$BUILD"
+}
+
+if [ -n "$REF" ]; then
+  OLD=$(mktemp -d)
+  git -C "$ROOT" archive "$REF" | tar -x -C "$OLD"
+  report "$REF" "$OLD"
+  rm -rf "$OLD"
+fi
+report "working tree" "$ROOT"
@@ -0,0 +1,244 @@
+/*
+  compress_bench.cpp - compression ratio and speed of SixfabDeltaEncoder on host.
+  -
+  Sensor traces of the 6 channels of examples/dutyCycle (ax, ay, az in mg,
+  temperature in 0.01 C, humidity in 0.01 %, light in ADC counts) are
+  packed into datagrams of UDP_DATA_LEN bytes, once as raw int32_t
+  samples, once as int16_t samples and once delta coded. For each trace
+  the table gives bytes per sample, ratio against int32_t, datagrams and
+  bytes on air (40 bytes of IP / UDP overhead each) for the whole trace,
+  then encode and decode speed per raw byte. Every batch is decoded back
+  and compared with its samples.
+
+  Built in traces are a day at one sample per minute, generated with a
+  fixed seed :
+
+    still   : node on a wall, gravity on z, slow indoor climate
+    machine : node on a pump that runs in shifts, vibration on all axes
+    outdoor : node outside, temperature and light follow the sun, gusts
+
+  A recorded trace can be given as a CSV file instead, one sample of 6
+  integers per line.
+
+  Timing is in TSC cycles on x86, nanoseconds elsewhere. Host figures
+  compare coders, they aren't cycles of an AVR.
+
+  Build and run : make -C extras/test compress_bench && extras/test/compress_bench [trace.csv ...]
+*/
+
+#include "Arduino.h"
+#include "Sixfab_NBIoT.h"
+#include "Sixfab_Compress.h"
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define BENCH_UNIT "cycles"
+  static uint64_t ticks() { return __rdtsc(); }
+#else
+  #define BENCH_UNIT "ns"
+  static uint64_t ticks()
+  {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+  }
+#endif
+
+#define BENCH_CHANNELS 6
+#define BENCH_SAMPLES 1440 // a day at one sample per minute
+#define BENCH_ROUNDS 200
+#define BENCH_OVERHEAD 40  // IP / UDP bytes of a datagram
+
+enum { TRACE_STILL, TRACE_MACHINE, TRACE_OUTDOOR };
+
+static int32_t trace[BENCH_SAMPLES][BENCH_CHANNELS];
+static uint32_t rng;
+static bool ok = true;
+
+static uint32_t next_random()
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+// noise in -amplitude ... amplitude
+static int32_t noise(int32_t amplitude)
+{
+  return amplitude ? (int32_t)(next_random() % (2 * amplitude + 1)) - amplitude : 0;
+}
+
+static uint16_t generate(uint8_t kind)
+{
+  int32_t temperature = 2150, humidity = 4300;
+
+  rng = 2463534242UL + kind;
+  for(uint16_t i = 0; i < BENCH_SAMPLES; i++){
+    double day = sin((i - 360) * 2 * M_PI / BENCH_SAMPLES); // peak at 12:00
+    int32_t *s = trace[i];
+
+    switch(kind){
+      case TRACE_STILL:
+        s[0] = 12 + noise(2);
+        s[1] = -8 + noise(2);
+        s[2] = 1000 + noise(3);
+        temperature += noise(2) + (int32_t)(day * 1.5);
+        humidity += noise(3);
+        s[5] = 300 + (int32_t)(day > 0 ? 250 * day : 0) + noise(4);
+        break;
+      case TRACE_MACHINE: {
+        bool running = (i / 240) % 2 == 0; // 4 hour shifts
+        int32_t vibration = running ? 80 : 3;
+        s[0] = 12 + noise(vibration);
+        s[1] = -8 + noise(vibration);
+        s[2] = 1000 + noise(vibration);
+        temperature += running ? (temperature < 4200 ? 6 : 0) + noise(3) : (temperature > 2400 ? -5 : 0) + noise(2);
+        humidity += noise(4);
+        s[5] = 120 + noise(6);
+        break;
+      }
+      case TRACE_OUTDOOR:
+        s[0] = 5 + noise(next_random() % 20 == 0 ? 150 : 6); // gusts
+        s[1] = 30 + noise(next_random() % 20 == 0 ? 150 : 6);
+        s[2] = 998 + noise(8);
+        temperature = 1200 + (int32_t)(800 * day) + noise(10);
+        humidity = 6500 - (int32_t)(2000 * day) + noise(20);
+        s[5] = day > 0 ? (int32_t)(1000 * day) + noise(40) : noise(2) + 2;
+        break;
+    }
+    s[3] = temperature;
+    s[4] = humidity;
+  }
+  return BENCH_SAMPLES;
+}
+
+static uint16_t load_csv(const char *path)
+{
+  FILE *file = fopen(path, "r");
+  char line[160];
+  uint16_t len = 0;
+
+  if(file == NULL)
+    return 0;
+  while(len < BENCH_SAMPLES && fgets(line, sizeof(line), file)){
+    long v[BENCH_CHANNELS];
+    if(sscanf(line, "%ld,%ld,%ld,%ld,%ld,%ld", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != BENCH_CHANNELS)
+      continue; // header or comment
+    for(uint8_t c = 0; c < BENCH_CHANNELS; c++)
+      trace[len][c] = v[c];
+    len++;
+  }
+  fclose(file);
+  return len;
+}
+
+// datagrams of fixed size samples
+static void count_fixed(uint16_t samples, uint16_t sample_len, uint32_t *datagrams, uint32_t *air)
+{
+  uint16_t per_datagram = UDP_DATA_LEN / sample_len;
+  *datagrams = (samples + per_datagram - 1) / per_datagram;
+  *air = (uint32_t)samples * sample_len + *datagrams * BENCH_OVERHEAD;
+}
+
+// delta coded datagrams, each batch is decoded back
+static void count_delta(uint16_t samples, uint32_t *datagrams, uint32_t *air, uint32_t *coded)
+{
+  uint8_t batch[UDP_DATA_LEN];
+  int32_t decoded[UDP_DATA_LEN][BENCH_CHANNELS];
+  SixfabDeltaEncoder encoder(batch, sizeof(batch), BENCH_CHANNELS);
+  uint16_t first = 0;
+
+  *datagrams = *air = *coded = 0;
+  for(uint16_t i = 0; i <= samples; i++){
+    if(i < samples && encoder.add(trace[i]))
+      continue;
+    // batch is full or trace ended
+    uint16_t count = encoder.samples();
+    if(count == 0)
+      break;
+    if(deltaDecode(batch, encoder.length(), BENCH_CHANNELS, &decoded[0][0], UDP_DATA_LEN) != count ||
+       memcmp(decoded, trace[first], count * sizeof(trace[0])) != 0)
+      ok = false;
+    (*datagrams)++;
+    *coded += encoder.length();
+    *air += encoder.length() + BENCH_OVERHEAD;
+    first += count;
+    encoder.reset();
+    if(i < samples)
+      i--; // sample that didn't fit starts next batch
+  }
+  if(first != samples)
+    ok = false;
+}
+
+// encode and decode time per raw int32_t byte
+static void time_delta(uint16_t samples, double *encode, double *decode)
+{
+  static uint8_t coded[BENCH_SAMPLES * BENCH_CHANNELS * COMPRESS_VARINT_LEN];
+  static int32_t decoded[BENCH_SAMPLES][BENCH_CHANNELS];
+  uint64_t encode_ticks = 0, decode_ticks = 0;
+  uint16_t len = 0;
+
+  for(uint16_t r = 0; r < BENCH_ROUNDS; r++){
+    SixfabDeltaEncoder encoder(coded, sizeof(coded), BENCH_CHANNELS);
+    uint64_t t0 = ticks();
+    for(uint16_t i = 0; i < samples; i++)
+      encoder.add(trace[i]);
+    uint64_t t1 = ticks();
+    len = encoder.length();
+    uint16_t count = deltaDecode(coded, len, BENCH_CHANNELS, &decoded[0][0], BENCH_SAMPLES);
+    uint64_t t2 = ticks();
+    encode_ticks += t1 - t0;
+    decode_ticks += t2 - t1;
+    if(count != samples)
+      ok = false;
+  }
+  uint32_t raw = (uint32_t)samples * sizeof(trace[0]);
+  *encode = (double)encode_ticks / BENCH_ROUNDS / raw;
+  *decode = (double)decode_ticks / BENCH_ROUNDS / raw;
+}
+
+static void bench(const char *name, uint16_t samples)
+{
+  uint32_t datagrams32, air32, datagrams16, air16, datagrams_delta, air_delta, coded;
+  double encode, decode;
+
+  count_fixed(samples, sizeof(int32_t) * BENCH_CHANNELS, &datagrams32, &air32);
+  count_fixed(samples, sizeof(int16_t) * BENCH_CHANNELS, &datagrams16, &air16);
+  count_delta(samples, &datagrams_delta, &air_delta, &coded);
+  time_delta(samples, &encode, &decode);
+
+  printf("%s,%u,%.2f,%.2f,%.2f,%.2f,%lu,%lu,%lu,%lu,%lu,%lu,%.1f,%.1f\n",
+    name, samples,
+    (double)sizeof(int32_t) * BENCH_CHANNELS, (double)sizeof(int16_t) * BENCH_CHANNELS, (double)coded / samples,
+    (double)samples * sizeof(int32_t) * BENCH_CHANNELS / coded,
+    (unsigned long)datagrams32, (unsigned long)datagrams16, (unsigned long)datagrams_delta,
+    (unsigned long)air32, (unsigned long)air16, (unsigned long)air_delta,
+    encode, decode);
+}
+
+int main(int argc, char **argv)
+{
+  static const char * const names[] = {"still", "machine", "outdoor"};
+
+  printf("# channels=%u datagram=%u unit=%s\n", BENCH_CHANNELS, UDP_DATA_LEN, BENCH_UNIT);
+  printf("trace,samples,bytes_int32,bytes_int16,bytes_delta,ratio,datagrams_int32,datagrams_int16,datagrams_delta,air_int32,air_int16,air_delta,encode_per_byte,decode_per_byte\n");
+
+  if(argc > 1){
+    for(int i = 1; i < argc; i++){
+      uint16_t samples = load_csv(argv[i]);
+      if(samples)
+        bench(argv[i], samples);
+      else
+        printf("# %s : no samples\n", argv[i]);
+    }
+  }
+  else{
+    for(uint8_t kind = TRACE_STILL; kind <= TRACE_OUTDOOR; kind++)
+      bench(names[kind], generate(kind));
+  }
+  printf("# round trip %s\n", ok ? "pass" : "FAIL");
+  return ok ? 0 : 1;
+}
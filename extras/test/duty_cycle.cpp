@@ -0,0 +1,85 @@
+/*
+  duty_cycle.cpp - runs examples/dutyCycle on host.
+  -
+  The sketch is compiled unchanged against the host core of host/ : BC95
+  is the scripted emulator on Serial1, MMA8452Q and HDC1080 are register
+  models on Wire and time is virtual, so the CSV rows of the sketch are
+  identical on every run and can be compared between revisions. Log
+  output of the library is off unless -v is given.
+
+  Sensors drift slowly and coverage worsens from ECL 0 to ECL 2 over the
+  run. A server answers every second datagram with an 8 byte downlink.
+
+  Settings of the sketch are given by the Makefile, one program per
+  configuration, and rows are labelled with its name :
+
+    duty_cycle_raw1    : every sample in its own datagram, raw int32_t
+    duty_cycle_raw4    : 4 raw samples per datagram
+    duty_cycle_delta4  : 4 delta coded samples per datagram
+    duty_cycle_sealed4 : same, sealed with SixfabSecure and a test key
+
+  Build and run : make -C extras/test duty_cycle && extras/test/duty_cycle_delta4
+*/
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "host_sensors.h"
+#include "bc95_emulator.h"
+#include "../../examples/dutyCycle/dutyCycle.ino"
+
+BC95Emulator bc95;
+HostMMA8452Q mma;
+HostHDC1080 hdc;
+
+// answers every second datagram
+static void server(BC95Emulator &modem, uint8_t socket, const uint8_t *data, uint16_t len, void *context)
+{
+  static const uint8_t reply[8] = {0x01, 0x10, 0x00, 0x00, 0x01, 0x2C, 0x00, 0x00};
+  (void)data; (void)len; (void)context;
+
+  if(modem.uplinks % 2 == 0)
+    modem.queueDownlink(socket, reply, sizeof(reply), BC95_NETWORK_RTT);
+}
+
+// conditions of cycle, same for every run
+static void set_scene(uint32_t n)
+{
+  static const int16_t rsrp[3] = {-850, -1100, -1250};
+  static const int16_t snr[3] = {150, 20, -60};
+  uint8_t ecl = (n * 3) / (BENCH_CYCLES ? BENCH_CYCLES : 10);
+
+  if(ecl > 2)
+    ecl = 2;
+  bc95.setLink(rsrp[ecl], snr[ecl], ecl);
+  mma.setAccel(12 + n % 3, -8 - (int16_t)(n % 5), 1000 - (int16_t)(n % 2));
+  hdc.setClimate(2150 + 5 * n, 4300 - 10 * n);
+  hostSetAnalog(ALS_PT19_PIN, 400 + 7 * n);
+}
+
+int main(int argc, char **argv)
+{
+  bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+
+  Serial1.hostAttach(&bc95);
+  Wire.hostAttach(MMA8452Q_ADDRESS, &mma);
+  Wire.hostAttach(HDC1080_ADDRESS, &hdc);
+  bc95.setUplinkHandler(server, NULL);
+  if(!verbose)
+    sixfabLog.setLevel(LOG_LEVEL_NONE);
+#if BENCH_SECURE
+  static const uint8_t key[SECURE_KEY_LEN] = {
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f};
+  secure.setKey(key); // test key of RFC 8439, EEPROM of host starts erased
+#endif
+
+  set_scene(0);
+  setup();
+  while(cycle < (BENCH_CYCLES ? BENCH_CYCLES : 10)){
+    set_scene(cycle);
+    loop();
+  }
+  sixfabLog.flush();
+  fflush(stdout);
+  return 0;
+}
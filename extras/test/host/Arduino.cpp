@@ -0,0 +1,266 @@
+/*
+  Arduino.cpp
+  -
+  Host replacement of Arduino core, see Arduino.h.
+*/
+
+#include "Arduino.h"
+#include "EEPROM.h"
+
+static uint64_t now_us = 0;
+static uint8_t pin_level[HOST_PIN_COUNT];
+static uint16_t pin_analog[HOST_PIN_COUNT];
+static bool pins_ready = false;
+
+HardwareSerial Serial(stdout);
+HardwareSerial Serial1;
+EEPROMClass EEPROM;
+
+/******************************************************************************************
+ *** Virtual clock ************************************************************************
+ ******************************************************************************************/
+
+uint64_t hostMicros()
+{
+  return now_us;
+}
+
+void hostAdvance(uint64_t us)
+{
+  now_us += us;
+}
+
+unsigned long millis()
+{
+  now_us += HOST_POLL_US;
+  return (unsigned long)(now_us / 1000);
+}
+
+unsigned long micros()
+{
+  now_us += HOST_POLL_US;
+  return (unsigned long)now_us;
+}
+
+void delay(unsigned long ms)
+{
+  now_us += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  now_us += us;
+}
+
+/******************************************************************************************
+ *** Pins *********************************************************************************
+ ******************************************************************************************/
+
+static void init_pins()
+{
+  if(pins_ready)
+    return;
+  memset(pin_level, HIGH, sizeof(pin_level));
+  for(uint8_t i = 0; i < HOST_PIN_COUNT; i++)
+    pin_analog[i] = 512;
+  pins_ready = true;
+}
+
+void hostSetPin(uint8_t pin, uint8_t level)
+{
+  init_pins();
+  if(pin < HOST_PIN_COUNT)
+    pin_level[pin] = level;
+}
+
+void hostSetAnalog(uint8_t pin, uint16_t value)
+{
+  init_pins();
+  if(pin < HOST_PIN_COUNT)
+    pin_analog[pin] = value;
+}
+
+uint8_t hostGetPin(uint8_t pin)
+{
+  init_pins();
+  return (pin < HOST_PIN_COUNT) ? pin_level[pin] : LOW;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  init_pins();
+  if(pin < HOST_PIN_COUNT && mode == INPUT_PULLUP)
+    pin_level[pin] = HIGH; // released open drain line
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  init_pins();
+  if(pin < HOST_PIN_COUNT)
+    pin_level[pin] = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin)
+{
+  return hostGetPin(pin);
+}
+
+int analogRead(uint8_t pin)
+{
+  init_pins();
+  now_us += 112; // 13 ADC clocks at 125 kHz
+  if(pin < A0)
+    pin += A0;
+  return (pin < HOST_PIN_COUNT) ? pin_analog[pin] : 0;
+}
+
+void analogReference(uint8_t mode)
+{
+  (void)mode;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode)
+{
+  (void)interrupt; (void)handler; (void)mode;
+}
+
+void detachInterrupt(uint8_t interrupt)
+{
+  (void)interrupt;
+}
+
+void noInterrupts() {}
+void interrupts() {}
+
+/******************************************************************************************
+ *** Print & Stream ***********************************************************************
+ ******************************************************************************************/
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while(size--)
+    n += write(*buffer++);
+  return n;
+}
+
+size_t Print::print_number(unsigned long n, uint8_t base)
+{
+  char buf[8 * sizeof(long) + 1];
+  char *p = &buf[sizeof(buf) - 1];
+
+  if(base < 2)
+    base = 10;
+  *p = '\0';
+  do{
+    uint8_t digit = n % base;
+    n /= base;
+    *--p = (digit < 10) ? '0' + digit : 'A' + digit - 10;
+  } while(n);
+  return write(p);
+}
+
+size_t Print::print(const __FlashStringHelper *s) { return write((const char *)s); }
+size_t Print::print(const char *s) { return write(s); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(unsigned char n, int base) { return print_number(n, base); }
+size_t Print::print(int n, int base) { return print((long)n, base); }
+size_t Print::print(unsigned int n, int base) { return print_number(n, base); }
+size_t Print::print(unsigned long n, int base) { return print_number(n, base); }
+
+size_t Print::print(long n, int base)
+{
+  if(base == 10 && n < 0)
+    return write('-') + print_number(-(unsigned long)n, 10);
+  return print_number(n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+size_t Print::println() { return write("\r\n"); }
+size_t Print::println(const __FlashStringHelper *s) { return print(s) + println(); }
+size_t Print::println(const char *s) { return print(s) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(unsigned char n, int base) { return print(n, base) + println(); }
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned int n, int base) { return print(n, base) + println(); }
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+size_t Print::println(unsigned long n, int base) { return print(n, base) + println(); }
+size_t Print::println(double n, int digits) { return print(n, digits) + println(); }
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+  size_t count = 0;
+  unsigned long start = millis();
+
+  while(count < length && millis() - start < timeout){
+    int c = read();
+    if(c >= 0)
+      buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+/******************************************************************************************
+ *** Serial ports *************************************************************************
+ ******************************************************************************************/
+
+void HardwareSerial::begin(unsigned long rate)
+{
+  baud = rate ? rate : 9600;
+  if(device)
+    device->hostBegin(baud);
+}
+
+int HardwareSerial::available()
+{
+  now_us += HOST_POLL_US;
+  return device ? device->hostAvailable() : 0;
+}
+
+int HardwareSerial::read()
+{
+  return device ? device->hostRead() : -1;
+}
+
+int HardwareSerial::peek()
+{
+  return device ? device->hostPeek() : -1;
+}
+
+// byte leaves after bytes still in transmit buffer, write blocks while buffer is full
+size_t HardwareSerial::write(uint8_t c)
+{
+  uint64_t full = (uint64_t)HOST_TX_BUFFER * byte_time();
+
+  if(tx_done < now_us)
+    tx_done = now_us;
+  if(tx_done - now_us > full)
+    now_us = tx_done - full;
+  tx_done += byte_time();
+
+  if(device)
+    device->hostWrite(c, tx_done);
+  else if(out && c != '\r')
+    fputc(c, out); // CRLF of println() as LF
+  return 1;
+}
+
+int HardwareSerial::availableForWrite()
+{
+  if(tx_done <= now_us)
+    return HOST_TX_BUFFER;
+  uint32_t queued = (tx_done - now_us + byte_time() - 1) / byte_time();
+  return (queued >= HOST_TX_BUFFER) ? 0 : HOST_TX_BUFFER - queued;
+}
+
+void HardwareSerial::flush()
+{
+  if(tx_done > now_us)
+    now_us = tx_done;
+}
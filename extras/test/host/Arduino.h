@@ -0,0 +1,198 @@
+/*
+  Arduino.h
+  -
+  Host replacement of Arduino core for running the library on a PC.
+  Time is virtual : it only moves when the sketch waits (delay, polling
+  millis() / micros()) or when bytes are clocked out of serial ports and
+  I2C, so runs are repeatable to the microsecond.
+
+  Serial writes to stdout, Serial1 is wired to a device, e.g. the BC95
+  emulator of bc95_emulator.h, with hostAttach().
+*/
+
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <avr/pgmspace.h>
+
+#ifndef F_CPU
+  #define F_CPU 16000000L
+#endif
+
+#define ARDUINO_HOST
+
+#define HOST_POLL_US 4 // us spent by each call of millis(), micros() or available()
+#define HOST_PIN_COUNT 20
+#define HOST_TX_BUFFER 64 // bytes of transmit buffer of serial ports
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define NOT_A_PIN 0
+#define NOT_AN_INTERRUPT -1
+#define DEFAULT 1
+#define HEX 16
+#define DEC 10
+#define BIN 2
+
+#define digitalPinToPort(p) ((uint8_t)(p))
+#define digitalPinToBitMask(p) ((uint8_t)(1 << ((p) & 7)))
+#define portOutputRegister(p) ((volatile uint8_t *)0)
+#define portInputRegister(p) ((volatile uint8_t *)0)
+#define portModeRegister(p) ((volatile uint8_t *)0)
+#define digitalPinToPCICR(p) ((volatile uint8_t *)0)
+#define digitalPinToPCICRbit(p) 0
+#define digitalPinToPCMSK(p) ((volatile uint8_t *)0)
+#define digitalPinToPCMSKbit(p) 0
+#define digitalPinToInterrupt(p) (p)
+#define analogPinToChannel(p) (p)
+
+#define bit(b) (1UL << (b))
+#define bitRead(v, b) (((v) >> (b)) & 1)
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t interrupt);
+void noInterrupts();
+void interrupts();
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper *);
+    size_t print(const char *);
+    size_t print(char);
+    size_t print(unsigned char, int = DEC);
+    size_t print(int, int = DEC);
+    size_t print(unsigned int, int = DEC);
+    size_t print(long, int = DEC);
+    size_t print(unsigned long, int = DEC);
+    size_t print(double, int = 2);
+
+    size_t println(const __FlashStringHelper *);
+    size_t println(const char *);
+    size_t println(char);
+    size_t println(unsigned char, int = DEC);
+    size_t println(int, int = DEC);
+    size_t println(unsigned int, int = DEC);
+    size_t println(long, int = DEC);
+    size_t println(unsigned long, int = DEC);
+    size_t println(double, int = 2);
+    size_t println();
+
+  private:
+    size_t print_number(unsigned long, uint8_t);
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { timeout = ms; }
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+
+  protected:
+    unsigned long timeout = 1000;
+};
+
+// device on the other side of a host serial port
+class HostDevice
+{
+  public:
+    virtual ~HostDevice() {}
+    virtual void hostBegin(uint32_t baud) { (void)baud; }
+    virtual void hostWrite(uint8_t c, uint64_t arrival) = 0; // arrival : us of virtual clock
+    virtual int hostAvailable() = 0;
+    virtual int hostRead() = 0;
+    virtual int hostPeek() = 0;
+};
+
+class HardwareSerial : public Stream
+{
+  public:
+    HardwareSerial(FILE *out = NULL) : out(out) {}
+
+    void begin(unsigned long rate);
+    void end() {}
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t);
+    int availableForWrite();
+    void flush();
+    operator bool() { return true; }
+    using Print::write;
+
+    void hostAttach(HostDevice *peer) { device = peer; }
+    uint32_t hostBaud() { return baud; }
+
+  private:
+    FILE *out;
+    HostDevice *device = NULL;
+    uint32_t baud = 9600;
+    uint64_t tx_done = 0; // us when last written byte leaves the port
+
+    uint32_t byte_time() { return 10000000UL / baud; }
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+// virtual clock
+uint64_t hostMicros();
+void hostAdvance(uint64_t us);
+
+// pin levels seen by digitalRead() / analogRead(), inputs are high by default
+void hostSetPin(uint8_t pin, uint8_t level);
+void hostSetAnalog(uint8_t pin, uint16_t value);
+uint8_t hostGetPin(uint8_t pin);
+
+#endif
@@ -0,0 +1,55 @@
+/*
+  EEPROM.h
+  -
+  Host replacement of AVR EEPROM library, erased (0xFF) at start.
+*/
+
+#ifndef _HOST_EEPROM_H
+#define _HOST_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define HOST_EEPROM_SIZE 1024
+
+struct EEPROMClass
+{
+  uint8_t data[HOST_EEPROM_SIZE];
+  uint32_t writes; // cells written, wear of a run
+
+  EEPROMClass() : writes(0) { erase(); }
+
+  uint8_t read(int address) { return (address >= 0 && address < HOST_EEPROM_SIZE) ? data[address] : 0xFF; }
+  void write(int address, uint8_t value)
+  {
+    if(address >= 0 && address < HOST_EEPROM_SIZE){
+      data[address] = value;
+      writes++;
+    }
+  }
+  void update(int address, uint8_t value)
+  {
+    if(read(address) != value)
+      write(address, value);
+  }
+  uint16_t length() { return HOST_EEPROM_SIZE; }
+
+  template<typename T> T &get(int address, T &t)
+  {
+    for(size_t i = 0; i < sizeof(T); i++)
+      ((uint8_t *)&t)[i] = read(address + i);
+    return t;
+  }
+  template<typename T> const T &put(int address, const T &t)
+  {
+    for(size_t i = 0; i < sizeof(T); i++)
+      update(address + i, ((const uint8_t *)&t)[i]);
+    return t;
+  }
+
+  void erase() { memset(data, 0xFF, sizeof(data)); }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,77 @@
+/*
+  Wire.cpp
+  -
+  Host replacement of Wire library, see Wire.h.
+*/
+
+#include "Wire.h"
+
+TwoWire Wire;
+
+void TwoWire::hostAttach(uint8_t address, HostI2CDevice *device)
+{
+  for(uint8_t i = 0; i < HOST_WIRE_DEVICES; i++){
+    if(devices[i] == NULL || addresses[i] == address){
+      devices[i] = device;
+      addresses[i] = address;
+      return;
+    }
+  }
+}
+
+HostI2CDevice *TwoWire::find(uint8_t address)
+{
+  for(uint8_t i = 0; i < HOST_WIRE_DEVICES && devices[i]; i++){
+    if(addresses[i] == address)
+      return devices[i];
+  }
+  return NULL;
+}
+
+// address byte and data bytes, 9 clocks each
+void TwoWire::clock_bytes(uint8_t count)
+{
+  hostAdvance((uint64_t)(count + 1) * 9 * 1000000UL / clock);
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+  target = address;
+  tx_len = 0;
+}
+
+size_t TwoWire::write(uint8_t c)
+{
+  if(tx_len == HOST_WIRE_BUFFER)
+    return 0;
+  tx_buffer[tx_len++] = c;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+  HostI2CDevice *device = find(target);
+  (void)stop;
+
+  clock_bytes(tx_len);
+  if(device == NULL)
+    return 2; // address NACK
+  return device->i2cWrite(tx_buffer, tx_len) ? 0 : 3;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t len, uint8_t stop)
+{
+  HostI2CDevice *device = find(address);
+  (void)stop;
+
+  rx_len = rx_index = 0;
+  if(len > HOST_WIRE_BUFFER)
+    len = HOST_WIRE_BUFFER;
+  if(device == NULL){
+    clock_bytes(0);
+    return 0;
+  }
+  rx_len = device->i2cRead(rx_buffer, len);
+  clock_bytes(rx_len);
+  return rx_len;
+}
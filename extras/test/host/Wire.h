@@ -0,0 +1,70 @@
+/*
+  Wire.h
+  -
+  Host replacement of Wire library. Transfers go to devices attached
+  with hostAttach(), e.g. sensor models of host_sensors.h, and take
+  their bus time on the virtual clock.
+*/
+
+#ifndef _HOST_WIRE_H
+#define _HOST_WIRE_H
+
+#include "Arduino.h"
+
+#define WIRE_HAS_TIMEOUT 1
+#define HOST_WIRE_BUFFER 32
+#define HOST_WIRE_DEVICES 8
+
+#define SDA 18
+#define SCL 19
+
+// device on host I2C bus
+class HostI2CDevice
+{
+  public:
+    virtual ~HostI2CDevice() {}
+    virtual bool i2cWrite(const uint8_t *data, uint8_t len) = 0; // false : NACK
+    virtual uint8_t i2cRead(uint8_t *data, uint8_t len) = 0;     // 0 : NACK
+};
+
+class TwoWire : public Stream
+{
+  public:
+    void begin() {}
+    void end() {}
+    void setClock(uint32_t rate) { clock = rate ? rate : 100000; }
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool stop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t len, uint8_t stop = 1);
+    size_t write(uint8_t);
+    size_t write(int n) { return write((uint8_t)n); }
+    size_t write(unsigned int n) { return write((uint8_t)n); }
+    int available() { return rx_len - rx_index; }
+    int read() { return (rx_index < rx_len) ? rx_buffer[rx_index++] : -1; }
+    int peek() { return (rx_index < rx_len) ? rx_buffer[rx_index] : -1; }
+    using Print::write;
+
+    void setWireTimeout(uint32_t timeout = 25000, bool reset = false) { (void)timeout; (void)reset; }
+    bool getWireTimeoutFlag() { return false; }
+    void clearWireTimeoutFlag() {}
+
+    void hostAttach(uint8_t address, HostI2CDevice *device);
+
+  private:
+    uint32_t clock = 100000;
+    HostI2CDevice *devices[HOST_WIRE_DEVICES] = {NULL};
+    uint8_t addresses[HOST_WIRE_DEVICES];
+    uint8_t target;
+    uint8_t tx_buffer[HOST_WIRE_BUFFER];
+    uint8_t tx_len = 0;
+    uint8_t rx_buffer[HOST_WIRE_BUFFER];
+    uint8_t rx_len = 0;
+    uint8_t rx_index = 0;
+
+    HostI2CDevice *find(uint8_t address);
+    void clock_bytes(uint8_t count);
+};
+
+extern TwoWire Wire;
+
+#endif
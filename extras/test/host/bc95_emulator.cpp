@@ -0,0 +1,794 @@
+/*
+  bc95_emulator.cpp
+  -
+  Scripted BC95 responder for host tests, see bc95_emulator.h.
+*/
+
+#include "bc95_emulator.h"
+#include <time.h>
+
+static const uint32_t rates[] = {4800, 9600, 57600, 115200, 230400};
+
+static int8_t hex_value(char c)
+{
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// split comma separated arguments in place, quotes are removed
+static uint8_t split(char *args, char **fields, uint8_t max)
+{
+  uint8_t count = 0;
+
+  if(args == NULL || *args == '\0')
+    return 0;
+  while(count < max){
+    if(*args == '"'){
+      fields[count++] = ++args;
+      while(*args && *args != '"')
+        args++;
+      if(*args)
+        *args++ = '\0';
+    }
+    else
+      fields[count++] = args;
+    while(*args && *args != ',')
+      args++;
+    if(*args == '\0')
+      break;
+    *args++ = '\0';
+  }
+  return count;
+}
+
+// decode hex string of len bytes, false on bad digits or length
+static bool decode_hex(const char *hex, uint16_t len, uint8_t *out)
+{
+  if(strlen(hex) != (size_t)len * 2)
+    return false;
+  for(uint16_t i = 0; i < len; i++){
+    int8_t high = hex_value(hex[2 * i]);
+    int8_t low = hex_value(hex[2 * i + 1]);
+    if(high < 0 || low < 0)
+      return false;
+    out[i] = high << 4 | low;
+  }
+  return true;
+}
+
+BC95Emulator::BC95Emulator()
+{
+  baud = host_baud = 9600;
+  out_head = out_count = 0;
+  line_free = 0;
+  attach_delay = BC95_ATTACH_DELAY;
+  rsrp = -900;
+  snr = 100;
+  ecl = 0;
+  ack_loss = 0;
+  segments = 0;
+  send_reject = 0;
+  sent_datagrams = 0;
+  uplink_handler = NULL;
+  uplink_context = NULL;
+  raw_armed = false;
+  now = 0;
+  autoconnect = true;
+  scrambling = true;
+  band = 8;
+  uart_rx = uart_tx = 0;
+  tx_time = rx_time = 0;
+  uplinks = uplink_bytes = downlinks = commands = rejects = 0;
+  reset_state();
+}
+
+// state after power on or AT+NRB
+void BC95Emulator::reset_state()
+{
+  line_len = 0;
+  echo = true;
+  cfun = true;
+  registered = false;
+  attaching = false;
+  cereg_urc = false;
+  memset(sockets, 0, sizeof(sockets));
+  for(uint8_t i = 0; i < BC95_EVENTS; i++)
+    events[i].type = EV_FREE;
+  if(autoconnect)
+    start_attach(hostMicros());
+}
+
+void BC95Emulator::setLink(int16_t new_rsrp, int16_t new_snr, uint8_t new_ecl)
+{
+  rsrp = new_rsrp;
+  snr = new_snr;
+  ecl = (new_ecl > 2) ? 2 : new_ecl;
+}
+
+void BC95Emulator::setAttachDelay(uint32_t ms)
+{
+  for(uint8_t i = 0; i < BC95_EVENTS; i++){
+    if(events[i].type == EV_REGISTER)
+      events[i].time += ((int64_t)ms - attach_delay) * 1000;
+  }
+  attach_delay = ms;
+}
+
+void BC95Emulator::setUplinkHandler(BC95UplinkHandler handler, void *context)
+{
+  uplink_handler = handler;
+  uplink_context = context;
+}
+
+void BC95Emulator::setAckLoss(uint16_t every)
+{
+  ack_loss = every;
+}
+
+void BC95Emulator::setSendReject(uint16_t every)
+{
+  send_reject = every;
+}
+
+void BC95Emulator::setReply(const char *prefix, const uint8_t *data, uint16_t len)
+{
+  strncpy(raw_prefix, prefix, sizeof(raw_prefix) - 1);
+  raw_prefix[sizeof(raw_prefix) - 1] = '\0';
+  raw_len = (len < sizeof(raw)) ? len : sizeof(raw);
+  memcpy(raw, data, raw_len);
+  raw_armed = true;
+}
+
+bool BC95Emulator::queueDownlink(uint8_t socket, const uint8_t *data, uint16_t len, uint32_t delay)
+{
+  if(socket >= BC95_SOCKETS || len > BC95_EVENT_DATA)
+    return false;
+  // radio time of downlink is counted when it arrives
+  uint64_t from = (now > hostMicros()) ? now : hostMicros();
+  return schedule(EV_DOWNLINK, from + (uint64_t)delay * 1000, socket, data, len);
+}
+
+/******************************************************************************************
+ *** Serial line **************************************************************************
+ ******************************************************************************************/
+
+void BC95Emulator::hostBegin(uint32_t rate)
+{
+  host_baud = rate;
+}
+
+void BC95Emulator::hostWrite(uint8_t c, uint64_t arrival)
+{
+  uart_rx++;
+  if(host_baud != baud)
+    return; // framing errors, module sees no command
+
+  pump(arrival);
+  if(c == '\r'){
+    line[line_len] = '\0';
+    now = arrival;
+    if(echo){
+      emit(now, line, line_len);
+      emit(now, "\r", 1);
+    }
+    if(line_len)
+      process(line);
+    line_len = 0;
+    return;
+  }
+  if(c == '\n')
+    return;
+  if(line_len < BC95_LINE_LEN - 1)
+    line[line_len++] = c;
+}
+
+int BC95Emulator::hostAvailable()
+{
+  uint64_t t = hostMicros();
+  int count = 0;
+
+  pump(t);
+  for(uint16_t i = 0; i < out_count; i++){
+    if(output[(out_head + i) % BC95_OUTPUT_LEN].time > t)
+      break;
+    count++;
+  }
+  return count;
+}
+
+int BC95Emulator::hostPeek()
+{
+  pump(hostMicros());
+  if(out_count == 0 || output[out_head].time > hostMicros())
+    return -1;
+  return output[out_head].c;
+}
+
+int BC95Emulator::hostRead()
+{
+  int c = hostPeek();
+  if(c >= 0){
+    out_head = (out_head + 1) % BC95_OUTPUT_LEN;
+    out_count--;
+    uart_tx++;
+  }
+  return c;
+}
+
+// queue bytes on module TX line, starting when line is idle
+void BC95Emulator::emit(uint64_t at, const char *text, uint16_t len)
+{
+  uint32_t byte_time = 10000000UL / baud;
+
+  if(line_free < at)
+    line_free = at;
+  for(uint16_t i = 0; i < len; i++){
+    if(out_count == BC95_OUTPUT_LEN)
+      return; // overrun, host didn't read in time
+    line_free += byte_time;
+    Output &out = output[(out_head + out_count++) % BC95_OUTPUT_LEN];
+    out.c = (host_baud == baud) ? text[i] : (text[i] ^ 0x5A) | 0x80;
+    out.time = line_free;
+  }
+}
+
+bool BC95Emulator::schedule(uint8_t type, uint64_t at, uint8_t socket, const void *data, uint16_t len)
+{
+  for(uint8_t i = 0; i < BC95_EVENTS; i++){
+    Event &event = events[i];
+    if(event.type != EV_FREE)
+      continue;
+    event.type = type;
+    event.time = at;
+    event.socket = socket;
+    event.len = len;
+    if(len)
+      memcpy(event.data, data, len);
+    return true;
+  }
+  return false;
+}
+
+// run events that are due, in order of time
+void BC95Emulator::pump(uint64_t until)
+{
+  while(true){
+    Event *next = NULL;
+    for(uint8_t i = 0; i < BC95_EVENTS; i++){
+      if(events[i].type != EV_FREE && events[i].time <= until && (next == NULL || events[i].time < next->time))
+        next = &events[i];
+    }
+    if(next == NULL)
+      return;
+    run(*next);
+    next->type = EV_FREE;
+  }
+}
+
+void BC95Emulator::run(Event &event)
+{
+  char text[40];
+
+  switch(event.type){
+    case EV_REGISTER:
+      attaching = false;
+      if(!cfun)
+        return;
+      registered = true;
+      if(cereg_urc)
+        emit(event.time, "\r\n+CEREG:1\r\n", 12);
+      break;
+
+    case EV_DOWNLINK: {
+      Socket &socket = sockets[event.socket];
+      if(!socket.open || socket.rx_len + event.len > BC95_SOCKET_BUFFER)
+        return; // dropped by module
+      if(!socket.stream){
+        if(socket.datagram_count == BC95_DATAGRAMS)
+          return;
+        socket.datagrams[socket.datagram_count++] = event.len;
+      }
+      memcpy(socket.rx + socket.rx_len, event.data, event.len);
+      socket.rx_len += event.len;
+      rx_time += airtime(event.len);
+      downlinks++;
+      sprintf(text, "\r\n+NSONMI:%u,%u\r\n", event.socket, event.len);
+      emit(event.time, text, strlen(text));
+      break;
+    }
+
+    case EV_TEXT:
+      emit(event.time, (const char *)event.data, event.len);
+      break;
+  }
+}
+
+/******************************************************************************************
+ *** Radio model **************************************************************************
+ ******************************************************************************************/
+
+void BC95Emulator::start_attach(uint64_t at)
+{
+  if(registered || attaching)
+    return;
+  attaching = schedule(EV_REGISTER, at + (uint64_t)attach_delay * 1000, 0, NULL, 0);
+}
+
+// transmissions of each block, coverage enhancement of ECL 0-2
+uint8_t BC95Emulator::repetitions()
+{
+  static const uint8_t table[3] = {1, 8, 32};
+  return table[ecl];
+}
+
+// ms on air of a packet with 40 bytes of IP / UDP / PDCP overhead at 20 kbit/s
+uint32_t BC95Emulator::airtime(uint16_t len)
+{
+  return ((uint32_t)len + 40) * 8 * repetitions() / 20;
+}
+
+void BC95Emulator::radio_uplink(uint8_t socket, const uint8_t *data, uint16_t len)
+{
+  tx_time += airtime(len);
+  rx_time += 40 * repetitions(); // scheduling grants and acknowledge
+  uplinks++;
+  uplink_bytes += len;
+  if(uplink_handler)
+    uplink_handler(*this, socket, data, len, uplink_context);
+}
+
+/******************************************************************************************
+ *** Commands *****************************************************************************
+ ******************************************************************************************/
+
+void BC95Emulator::append(const char *text)
+{
+  uint16_t len = strlen(text);
+  if(reply_len + len >= BC95_REPLY_LEN)
+    len = BC95_REPLY_LEN - 1 - reply_len;
+  memcpy(reply + reply_len, text, len);
+  reply_len += len;
+  reply[reply_len] = '\0';
+}
+
+// information line framed by CRLF, empty format gives the CRLF before final result
+void BC95Emulator::info(const char *format, ...)
+{
+  char text[BC95_REPLY_LEN];
+  va_list args;
+
+  append("\r\n");
+  if(format == NULL)
+    return;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  append(text);
+  append("\r\n");
+}
+
+void BC95Emulator::cme_error(uint16_t code)
+{
+  char text[24];
+  sprintf(text, "+CME ERROR: %u", code);
+  info(NULL);
+  append(text);
+  append("\r\n");
+}
+
+void BC95Emulator::process(char *command)
+{
+  char *args = strchr(command, '=');
+
+  commands++;
+  reply_len = 0;
+  reply[0] = '\0';
+  latency = BC95_LATENCY;
+
+  if(raw_armed && strncmp(command, raw_prefix, strlen(raw_prefix)) == 0){
+    raw_armed = false;
+    emit(now + latency * 1000UL, (const char *)raw, raw_len);
+    return;
+  }
+  if(args)
+    args++;
+
+  if(strcmp(command, "AT") == 0 || strcmp(command, "AT&W") == 0 || strncmp(command, "AT+CPSMS=", 9) == 0 ||
+     strcmp(command, "AT+CTZR=3") == 0 || strcmp(command, "AT+COPS=0") == 0)
+    ok();
+  else if(strcmp(command, "ATE0") == 0 || strcmp(command, "ATE1") == 0){
+    echo = (command[3] == '1');
+    ok();
+  }
+  else if(strcmp(command, "AT+CGSN") == 0){
+    info("863703030000001");
+    ok();
+  }
+  else if(strcmp(command, "AT+CGMR") == 0){
+    info("SECURITY,V100R100C10B657SP2");
+    info("PROTOCOL,V100R100C10B657SP2");
+    info("APPLICATION,V100R100C10B657SP2");
+    info("RADIO,BC95HB-02-STD_850");
+    ok();
+  }
+  else if(strcmp(command, "AT+CGMM") == 0){
+    info("Hi15RM1-HLB-20");
+    ok();
+  }
+  else if(strcmp(command, "AT+NCONFIG?") == 0 || strncmp(command, "AT+NCONFIG=", 11) == 0)
+    cmd_nconfig(args);
+  else if(strcmp(command, "AT+CSQ") == 0){
+    int16_t rssi = registered ? (rsrp / 10 + 20 + 113) / 2 : 99;
+    info("+CSQ:%d,99", (rssi == 99) ? 99 : constrain(rssi, 0, 31));
+    ok();
+  }
+  else if(strcmp(command, "AT+NUESTATS") == 0)
+    cmd_nuestats();
+  else if(strcmp(command, "AT+NUESTATS=CELL") == 0){
+    latency = 30;
+    if(registered)
+      info("NUESTATS:CELL,2506,105,1,%d,-108,%d,%d", rsrp, rsrp + 70, snr);
+    ok();
+  }
+  else if(strcmp(command, "AT+CEREG=1") == 0 || strcmp(command, "AT+CEREG=0") == 0){
+    cereg_urc = (command[9] == '1');
+    ok();
+  }
+  else if(strcmp(command, "AT+CEREG?") == 0){
+    info("+CEREG:%d,%d", cereg_urc, registered ? 1 : (attaching ? 2 : 0));
+    ok();
+  }
+  else if(strcmp(command, "AT+COPS?") == 0){
+    if(registered)
+      info("+COPS:0,2,\"" BC95_PLMN "\"");
+    else
+      info("+COPS:0");
+    ok();
+  }
+  else if(strncmp(command, "AT+COPS=1,2,", 12) == 0){
+    char *fields[3];
+    if(split(args, fields, 3) == 3 && strcmp(fields[2], BC95_PLMN) == 0){
+      latency = registered ? 50 : 1500; // search only if not on this operator already
+      start_attach(now);
+      ok();
+    }
+    else{
+      latency = 8000; // searched all bands
+      cme_error(3);
+    }
+  }
+  else if(strcmp(command, "AT+CGATT=1") == 0){
+    if(cfun){
+      start_attach(now);
+      ok();
+    }
+    else
+      error();
+  }
+  else if(strcmp(command, "AT+NBAND?") == 0){
+    info("+NBAND:%u", band);
+    ok();
+  }
+  else if(strncmp(command, "AT+NBAND=", 9) == 0){
+    if(cfun)
+      cme_error(4); // radio must be off
+    else{
+      band = atoi(args);
+      ok();
+    }
+  }
+  else if(strcmp(command, "AT+CFUN=0") == 0){
+    latency = 1000;
+    cfun = registered = false;
+    ok();
+  }
+  else if(strcmp(command, "AT+CFUN=1") == 0){
+    latency = 500;
+    cfun = true;
+    if(autoconnect)
+      start_attach(now);
+    ok();
+  }
+  else if(strcmp(command, "AT+NSOCR=?") == 0){
+    info("+NSOCR:(DGRAM,STREAM),(17,6),(0-65535),(0,1)");
+    ok();
+  }
+  else if(strcmp(command, "AT+NSOSTF=?") == 0){
+    info("+NSOSTF:(0-6),,(0-65535),(0x000,0x200,0x400),(0-512),");
+    ok();
+  }
+  else if(strcmp(command, "AT+NATSPEED=?") == 0){
+    info("+NATSPEED:(4800,9600,57600,115200,230400),(0-30),(0,1),(0-3),(0,1)");
+    ok();
+  }
+  else if(strcmp(command, "AT+NPSMR=?") == 0){
+    info("+NPSMR:(0,1)");
+    ok();
+  }
+  else if(strncmp(command, "AT+NATSPEED=", 12) == 0){
+    uint32_t rate = strtoul(args, NULL, 10);
+    bool valid = false;
+    for(uint8_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+      valid = valid || rates[i] == rate;
+    if(valid){
+      ok();
+      emit(now + latency * 1000UL, reply, reply_len);
+      baud = rate; // rate changes after OK
+      return;
+    }
+    error();
+  }
+  else if(strcmp(command, "AT+NRB") == 0){
+    info("REBOOTING");
+    emit(now + latency * 1000UL, reply, reply_len);
+    uint64_t booted = now + 3000000ULL;
+    reset_state();
+    const char *banner = "\r\nREBOOT_CAUSE_APPLICATION_AT\r\nNeul \r\nOK\r\n";
+    schedule(EV_TEXT, booted, 0, banner, strlen(banner));
+    return;
+  }
+  else if(strcmp(command, "AT+CCLK?") == 0)
+    cmd_cclk();
+  else if(strncmp(command, "AT+NSOCR=", 9) == 0)
+    cmd_nsocr(args);
+  else if(strncmp(command, "AT+NSOST=", 9) == 0)
+    cmd_nsost(args);
+  else if(strncmp(command, "AT+NSOCO=", 9) == 0)
+    cmd_nsoco(args);
+  else if(strncmp(command, "AT+NSOSD=", 9) == 0)
+    cmd_nsosd(args);
+  else if(strncmp(command, "AT+NSORF=", 9) == 0)
+    cmd_nsorf(args);
+  else if(strncmp(command, "AT+NSOCL=", 9) == 0)
+    cmd_nsocl(args);
+  else
+    error();
+
+  emit(now + latency * 1000UL, reply, reply_len);
+}
+
+void BC95Emulator::cmd_nconfig(char *args)
+{
+  char *fields[2];
+
+  if(args == NULL){
+    info("+NCONFIG:AUTOCONNECT,%s", autoconnect ? "TRUE" : "FALSE");
+    info("+NCONFIG:CR_0354_0338_SCRAMBLING,%s", scrambling ? "TRUE" : "FALSE");
+    info("+NCONFIG:CR_0859_SI_AVOID,TRUE");
+    ok();
+    return;
+  }
+  if(split(args, fields, 2) != 2 || (strcmp(fields[1], "TRUE") != 0 && strcmp(fields[1], "FALSE") != 0)){
+    error();
+    return;
+  }
+  bool value = (fields[1][0] == 'T');
+  if(strcmp(fields[0], "AUTOCONNECT") == 0)
+    autoconnect = value;
+  else if(strcmp(fields[0], "CR_0354_0338_SCRAMBLING") == 0)
+    scrambling = value;
+  else{
+    error();
+    return;
+  }
+  ok();
+}
+
+void BC95Emulator::cmd_nuestats()
+{
+  latency = 30;
+  info("Signal power:%d", registered ? rsrp : -32768);
+  info("Total power:%d", registered ? rsrp + 70 : -32768);
+  info("TX power:%d", uplinks ? (ecl ? 230 : 100) : -32768);
+  info("TX time:%lu", (unsigned long)tx_time);
+  info("RX time:%lu", (unsigned long)rx_time);
+  info("Cell ID:21229824");
+  info("ECL:%u", ecl);
+  info("SNR:%d", snr);
+  info("EARFCN:2506");
+  info("PCI:105");
+  info("RSRQ:-108");
+  ok();
+}
+
+void BC95Emulator::cmd_cclk()
+{
+  time_t t = BC95_EPOCH + now / 1000000;
+  struct tm utc;
+
+  gmtime_r(&t, &utc);
+  if(registered)
+    info("+CCLK:%02d/%02d/%02d,%02d:%02d:%02d+00", utc.tm_year % 100, utc.tm_mon + 1, utc.tm_mday,
+         utc.tm_hour, utc.tm_min, utc.tm_sec);
+  else
+    info("+CCLK:70/01/01,00:00:00+00"); // network time isn't received yet
+  ok();
+}
+
+// AT+NSOCR=<type>,<protocol>,<listen port>[,<receive control>]
+void BC95Emulator::cmd_nsocr(char *args)
+{
+  char *fields[4];
+
+  if(split(args, fields, 4) < 3){
+    error();
+    return;
+  }
+  bool stream = strcmp(fields[0], "STREAM") == 0;
+  if(!stream && strcmp(fields[0], "DGRAM") != 0){
+    error();
+    return;
+  }
+  uint16_t port = atoi(fields[2]);
+  for(uint8_t i = 0; i < BC95_SOCKETS; i++){
+    if(sockets[i].open && sockets[i].local_port == port){
+      error();
+      return;
+    }
+  }
+  for(uint8_t i = 0; i < BC95_SOCKETS; i++){
+    if(!sockets[i].open){
+      memset(&sockets[i], 0, sizeof(Socket));
+      sockets[i].open = true;
+      sockets[i].stream = stream;
+      sockets[i].local_port = port;
+      info("%u", i);
+      ok();
+      return;
+    }
+  }
+  error();
+}
+
+// AT+NSOST=<socket>,<remote addr>,<remote port>,<length>,<data>
+void BC95Emulator::cmd_nsost(char *args)
+{
+  char *fields[5];
+  uint8_t data[BC95_EVENT_DATA];
+
+  latency = 20;
+  if(split(args, fields, 5) != 5){
+    error();
+    return;
+  }
+  uint8_t s = atoi(fields[0]);
+  uint16_t len = atoi(fields[3]);
+  if(s >= BC95_SOCKETS || !sockets[s].open || sockets[s].stream || len > BC95_EVENT_DATA || !decode_hex(fields[4], len, data)){
+    error();
+    return;
+  }
+  if(!registered){
+    cme_error(159); // uplink busy / not attached
+    return;
+  }
+  sent_datagrams++;
+  if(send_reject && sent_datagrams % send_reject == 0){
+    rejects++;
+    cme_error(159);
+    return;
+  }
+  strncpy(sockets[s].ip, fields[1], sizeof(sockets[s].ip) - 1);
+  sockets[s].port = atoi(fields[2]);
+  info("%u,%u", s, len);
+  ok();
+  radio_uplink(s, data, len);
+}
+
+// AT+NSOCO=<socket>,<remote addr>,<remote port>
+void BC95Emulator::cmd_nsoco(char *args)
+{
+  char *fields[3];
+
+  if(split(args, fields, 3) != 3){
+    error();
+    return;
+  }
+  uint8_t s = atoi(fields[0]);
+  if(s >= BC95_SOCKETS || !sockets[s].open || !sockets[s].stream || sockets[s].connected || !registered){
+    error();
+    return;
+  }
+  latency = BC95_NETWORK_RTT * repetitions(); // SYN, SYN-ACK
+  tx_time += airtime(0);
+  rx_time += airtime(0);
+  strncpy(sockets[s].ip, fields[1], sizeof(sockets[s].ip) - 1);
+  sockets[s].port = atoi(fields[2]);
+  sockets[s].connected = true;
+  ok();
+}
+
+// AT+NSOSD=<socket>,<length>,<data>[,<flag>[,<sequence>]]
+void BC95Emulator::cmd_nsosd(char *args)
+{
+  char *fields[5];
+  uint8_t data[BC95_EVENT_DATA];
+  uint8_t count = split(args, fields, 5);
+
+  latency = 20;
+  if(count < 3){
+    error();
+    return;
+  }
+  uint8_t s = atoi(fields[0]);
+  uint16_t len = atoi(fields[1]);
+  if(s >= BC95_SOCKETS || !sockets[s].connected || len > BC95_EVENT_DATA || !decode_hex(fields[2], len, data)){
+    error();
+    return;
+  }
+  info("%u,%u", s, len);
+  ok();
+
+  segments++;
+  if(count == 5){
+    char text[40];
+    bool lost = ack_loss && segments % ack_loss == 0;
+    sprintf(text, "\r\n+NSOSTR:%u,%s,%u\r\n", s, fields[4], lost ? 0 : 1);
+    schedule(EV_TEXT, now + (uint64_t)(BC95_NETWORK_RTT * repetitions() + airtime(len)) * 1000, s, text, strlen(text));
+    if(lost)
+      return; // server doesn't see segment
+  }
+  radio_uplink(s, data, len);
+}
+
+// AT+NSORF=<socket>,<req_length>
+void BC95Emulator::cmd_nsorf(char *args)
+{
+  char *fields[2];
+
+  if(split(args, fields, 2) != 2){
+    error();
+    return;
+  }
+  uint8_t s = atoi(fields[0]);
+  uint16_t len = atoi(fields[1]);
+  if(s >= BC95_SOCKETS || !sockets[s].open){
+    error();
+    return;
+  }
+  Socket &socket = sockets[s];
+  if(len > socket.rx_len)
+    len = socket.rx_len;
+  // datagrams are read one at a time, remaining length is the rest of datagram
+  uint16_t remaining = 0;
+  if(!socket.stream && socket.datagram_count){
+    if(len > socket.datagrams[0])
+      len = socket.datagrams[0];
+    socket.datagrams[0] -= len;
+    remaining = socket.datagrams[0];
+    if(!remaining){
+      socket.datagram_count--;
+      memmove(socket.datagrams, socket.datagrams + 1, socket.datagram_count * sizeof(socket.datagrams[0]));
+    }
+  }
+  if(len){
+    static const char digits[] = "0123456789ABCDEF";
+    char hex[2 * BC95_SOCKET_BUFFER + 1];
+    for(uint16_t i = 0; i < len; i++){
+      hex[2 * i] = digits[socket.rx[i] >> 4];
+      hex[2 * i + 1] = digits[socket.rx[i] & 0x0F];
+    }
+    hex[2 * len] = '\0';
+    memmove(socket.rx, socket.rx + len, socket.rx_len - len);
+    socket.rx_len -= len;
+    info("%u,%s,%u,%u,%s,%u", s, socket.ip[0] ? socket.ip : "0.0.0.0", socket.port, len, hex, socket.stream ? socket.rx_len : remaining);
+  }
+  ok();
+}
+
+void BC95Emulator::cmd_nsocl(char *args)
+{
+  uint8_t s = atoi(args);
+
+  if(s >= BC95_SOCKETS || !sockets[s].open){
+    error();
+    return;
+  }
+  sockets[s].open = sockets[s].connected = false;
+  for(uint8_t i = 0; i < BC95_EVENTS; i++){
+    if(events[i].type == EV_DOWNLINK && events[i].socket == s)
+      events[i].type = EV_FREE;
+  }
+  ok();
+}
@@ -0,0 +1,187 @@
+/*
+  bc95_emulator.h
+  -
+  Scripted BC95 responder for host tests. Attach it to a host serial
+  port with Serial1.hostAttach(&modem). Commands used by the library are
+  answered in BC95 B657 format, bytes are clocked at module baud rate on
+  the virtual clock and arrive garbled if host and module rates differ.
+
+  Radio is modelled coarsely : registration completes BC95_ATTACH_DELAY
+  after AT+CGATT=1 (or power on with AUTOCONNECT), airtime of each
+  datagram / segment grows with ECL repetitions and is added to the
+  TX / RX time counters of AT+NUESTATS. AT+NSORF reads DGRAM sockets
+  one datagram at a time, as the module does, STREAM sockets as bytes.
+
+  Scenario hooks :
+    setLink()         radio conditions reported by AT+CSQ / AT+NUESTATS
+    setUplinkHandler  called for every datagram / segment, e.g. a server
+                      that answers with queueDownlink()
+    setAckLoss()      AT+NSOSD segments reported as failed by +NSOSTR
+    setSendReject()   AT+NSOST datagrams refused with +CME ERROR
+    setReply()        raw bytes answered to next matching command, for
+                      fuzzing of response parsers
+*/
+
+#ifndef _BC95_EMULATOR_H
+#define _BC95_EMULATOR_H
+
+#include "Arduino.h"
+
+#define BC95_SOCKETS 7
+#define BC95_SOCKET_BUFFER 1024 // received bytes kept per socket
+#define BC95_DATAGRAMS 16       // received datagrams kept per DGRAM socket
+#define BC95_LINE_LEN 1200      // longest command, AT+NSOSD with 512 bytes
+#define BC95_OUTPUT_LEN 4096    // bytes queued on module TX line
+#define BC95_REPLY_LEN 1200
+#define BC95_EVENTS 32
+#define BC95_EVENT_DATA 512
+
+#define BC95_ATTACH_DELAY 4000 // ms from AT+CGATT=1 to registration
+#define BC95_LATENCY 10        // ms from command to response
+#define BC95_NETWORK_RTT 600   // ms from uplink to +NSOSTR, downlinks of a server come later
+#define BC95_PLMN "28601"
+#define BC95_EPOCH 1537185600UL // 2018-09-17 12:00:00 UTC at virtual time 0
+
+class BC95Emulator;
+
+typedef void (*BC95UplinkHandler)(BC95Emulator &modem, uint8_t socket, const uint8_t *data, uint16_t len, void *context);
+
+class BC95Emulator : public HostDevice
+{
+  public:
+    BC95Emulator();
+
+    void setLink(int16_t rsrp, int16_t snr, uint8_t ecl); // 0.1 dBm, 0.1 dB, 0-2
+    void setAttachDelay(uint32_t ms);
+    void setUplinkHandler(BC95UplinkHandler handler, void *context);
+    void setAckLoss(uint16_t every); // every n-th segment fails, 0 : none
+    void setSendReject(uint16_t every); // every n-th datagram is refused, 0 : none
+    void setReply(const char *prefix, const uint8_t *raw, uint16_t len);
+
+    // data that arrives to socket after delay ms, notified with +NSONMI
+    bool queueDownlink(uint8_t socket, const uint8_t *data, uint16_t len, uint32_t delay);
+
+    bool isRegistered() { return registered; }
+    uint32_t getBaud() { return baud; }
+
+    // counters
+    uint32_t uart_rx;      // bytes received from host
+    uint32_t uart_tx;      // bytes read by host
+    uint32_t tx_time;      // ms, AT+NUESTATS "TX time"
+    uint32_t rx_time;      // ms, AT+NUESTATS "RX time"
+    uint32_t uplinks;      // datagrams and segments sent
+    uint32_t uplink_bytes;
+    uint32_t downlinks;
+    uint32_t rejects;      // datagrams refused by setSendReject()
+    uint32_t commands;
+
+    // HostDevice
+    void hostBegin(uint32_t rate);
+    void hostWrite(uint8_t c, uint64_t arrival);
+    int hostAvailable();
+    int hostRead();
+    int hostPeek();
+
+  private:
+    enum { EV_FREE, EV_REGISTER, EV_DOWNLINK, EV_TEXT };
+
+    struct Event {
+      uint8_t type;
+      uint8_t socket;
+      uint16_t len;
+      uint64_t time;
+      uint8_t data[BC95_EVENT_DATA]; // payload or text
+    };
+
+    struct Socket {
+      bool open;
+      bool stream;
+      bool connected;
+      uint16_t local_port;
+      char ip[32];
+      uint16_t port;
+      uint8_t rx[BC95_SOCKET_BUFFER];
+      uint16_t rx_len;
+      uint16_t datagrams[BC95_DATAGRAMS]; // lengths of received datagrams, first one partly read
+      uint8_t datagram_count;
+    };
+
+    struct Output {
+      uint8_t c;
+      uint64_t time;
+    };
+
+    // serial line
+    uint32_t baud;
+    uint32_t host_baud;
+    char line[BC95_LINE_LEN];
+    uint16_t line_len;
+    Output output[BC95_OUTPUT_LEN];
+    uint16_t out_head;
+    uint16_t out_count;
+    uint64_t line_free; // us when module TX line is idle
+    bool echo;
+
+    // command being processed
+    uint64_t now;
+    char reply[BC95_REPLY_LEN];
+    uint16_t reply_len;
+    uint32_t latency;
+
+    // scripted raw reply
+    char raw_prefix[32];
+    uint8_t raw[BC95_REPLY_LEN];
+    uint16_t raw_len;
+    bool raw_armed;
+
+    // modem state
+    bool cfun;
+    bool registered;
+    bool attaching;
+    bool cereg_urc;
+    bool autoconnect;
+    bool scrambling;
+    uint8_t band;
+    int16_t rsrp;
+    int16_t snr;
+    uint8_t ecl;
+    uint32_t attach_delay;
+    Socket sockets[BC95_SOCKETS];
+    Event events[BC95_EVENTS];
+    uint16_t ack_loss;
+    uint16_t segments;
+    uint16_t send_reject;
+    uint16_t sent_datagrams;
+    BC95UplinkHandler uplink_handler;
+    void *uplink_context;
+
+    void reset_state();
+    void pump(uint64_t until);
+    void emit(uint64_t at, const char *text, uint16_t len);
+    bool schedule(uint8_t type, uint64_t at, uint8_t socket, const void *data, uint16_t len);
+    void run(Event &event);
+
+    void process(char *command);
+    void info(const char *format, ...);
+    void ok() { info(NULL); append("OK\r\n"); }
+    void error() { info(NULL); append("ERROR\r\n"); }
+    void cme_error(uint16_t code);
+    void append(const char *text);
+
+    void start_attach(uint64_t at);
+    uint8_t repetitions();
+    uint32_t airtime(uint16_t len);
+    void radio_uplink(uint8_t socket, const uint8_t *data, uint16_t len);
+
+    void cmd_nconfig(char *args);
+    void cmd_nsocr(char *args);
+    void cmd_nsost(char *args);
+    void cmd_nsoco(char *args);
+    void cmd_nsosd(char *args);
+    void cmd_nsorf(char *args);
+    void cmd_nsocl(char *args);
+    void cmd_nuestats();
+    void cmd_cclk();
+};
+
+#endif
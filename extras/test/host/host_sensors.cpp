@@ -0,0 +1,128 @@
+/*
+  host_sensors.cpp
+  -
+  Register models of shield sensors, see host_sensors.h.
+*/
+
+#include "host_sensors.h"
+
+#define MMA_STATUS 0x00
+#define MMA_OUT_X_MSB 0x01
+#define MMA_WHO_AM_I 0x0D
+#define MMA_XYZ_DATA_CFG 0x0E
+
+#define HDC_TEMPERATURE 0x00
+#define HDC_HUMIDITY 0x01
+#define HDC_CONFIGURATION 0x02
+#define HDC_MANUFACTURER_ID 0xFE
+#define HDC_DEVICE_ID 0xFF
+#define HDC_MODE_BOTH 0x1000
+
+HostMMA8452Q::HostMMA8452Q()
+{
+  memset(registers, 0, sizeof(registers));
+  registers[MMA_WHO_AM_I] = 0x2A;
+  pointer = 0;
+  setAccel(0, 0, 1000);
+}
+
+void HostMMA8452Q::setAccel(int16_t x, int16_t y, int16_t z)
+{
+  mg[0] = x;
+  mg[1] = y;
+  mg[2] = z;
+  update_output();
+}
+
+// 12 bit counts, left aligned, 1 g is 1024 counts at 2 g range
+void HostMMA8452Q::update_output()
+{
+  uint8_t range = 2 << (registers[MMA_XYZ_DATA_CFG] & 0x03);
+
+  for(uint8_t i = 0; i < 3; i++){
+    int32_t counts = (int32_t)mg[i] * 2048 / (range * 1000);
+    counts = constrain(counts, -2048, 2047);
+    uint16_t left = (uint16_t)(counts << 4);
+    registers[MMA_OUT_X_MSB + 2 * i] = left >> 8;
+    registers[MMA_OUT_X_MSB + 2 * i + 1] = left & 0xF0;
+  }
+  registers[MMA_STATUS] = 0x0F; // new data on all axes
+}
+
+bool HostMMA8452Q::i2cWrite(const uint8_t *data, uint8_t len)
+{
+  if(len == 0)
+    return true;
+  pointer = data[0];
+  for(uint8_t i = 1; i < len; i++){
+    if(pointer < HOST_MMA8452Q_REGISTERS && pointer != MMA_WHO_AM_I && pointer > MMA_OUT_X_MSB + 5)
+      registers[pointer] = data[i];
+    pointer++;
+  }
+  update_output();
+  return true;
+}
+
+uint8_t HostMMA8452Q::i2cRead(uint8_t *data, uint8_t len)
+{
+  for(uint8_t i = 0; i < len; i++){
+    data[i] = (pointer < HOST_MMA8452Q_REGISTERS) ? registers[pointer] : 0;
+    pointer++;
+  }
+  return len;
+}
+
+HostHDC1080::HostHDC1080()
+{
+  pointer = 0;
+  config = 0x1000;
+  ready = 0;
+  setClimate(2500, 4000);
+}
+
+void HostHDC1080::setClimate(int32_t temperature, uint32_t humidity)
+{
+  raw_t = (uint16_t)constrain(((temperature + 4000) << 16) / 16500, 0, 0xFFFF);
+  raw_h = (uint16_t)constrain(((int32_t)humidity << 16) / 10000, 0, 0xFFFF);
+}
+
+bool HostHDC1080::i2cWrite(const uint8_t *data, uint8_t len)
+{
+  if(len == 0)
+    return true;
+  pointer = data[0];
+  if(pointer == HDC_CONFIGURATION && len >= 3)
+    config = data[1] << 8 | data[2];
+  if(len == 1 && (pointer == HDC_TEMPERATURE || pointer == HDC_HUMIDITY))
+    ready = hostMicros() + HOST_HDC1080_CONVERSION * 1000UL;
+  return true;
+}
+
+uint8_t HostHDC1080::i2cRead(uint8_t *data, uint8_t len)
+{
+  uint16_t words[2];
+  uint8_t count = 1;
+
+  switch(pointer){
+    case HDC_TEMPERATURE:
+    case HDC_HUMIDITY:
+      if(hostMicros() < ready)
+        return 0; // NACK until conversion ends
+      if(pointer == HDC_TEMPERATURE && (config & HDC_MODE_BOTH)){
+        words[0] = raw_t;
+        words[1] = raw_h;
+        count = 2;
+      }
+      else
+        words[0] = (pointer == HDC_TEMPERATURE) ? raw_t : raw_h;
+      break;
+    case HDC_CONFIGURATION: words[0] = config; break;
+    case HDC_MANUFACTURER_ID: words[0] = 0x5449; break;
+    case HDC_DEVICE_ID: words[0] = 0x1050; break;
+    default: words[0] = 0; break;
+  }
+
+  for(uint8_t i = 0; i < len; i++)
+    data[i] = (i / 2 < count) ? ((i & 1) ? words[i / 2] & 0xFF : words[i / 2] >> 8) : 0xFF;
+  return len;
+}
@@ -0,0 +1,57 @@
+/*
+  host_sensors.h
+  -
+  Register models of shield sensors for host Wire : MMA8452Q
+  accelerometer and HDC1080 temperature / humidity sensor.
+*/
+
+#ifndef _HOST_SENSORS_H
+#define _HOST_SENSORS_H
+
+#include "Wire.h"
+
+#define HOST_MMA8452Q_REGISTERS 0x32
+#define HOST_HDC1080_CONVERSION 13 // ms, 14 bit temperature and humidity in sequence
+
+// MMA8452Q, auto incremented register pointer
+class HostMMA8452Q : public HostI2CDevice
+{
+  public:
+    HostMMA8452Q();
+
+    // acceleration in mg, converted with current full scale range
+    void setAccel(int16_t x, int16_t y, int16_t z);
+
+    bool i2cWrite(const uint8_t *data, uint8_t len);
+    uint8_t i2cRead(uint8_t *data, uint8_t len);
+
+    uint8_t registers[HOST_MMA8452Q_REGISTERS];
+
+  private:
+    uint8_t pointer;
+    int16_t mg[3];
+
+    void update_output();
+};
+
+// HDC1080, 16 bit registers, a pointer write to 0x00 starts conversion
+class HostHDC1080 : public HostI2CDevice
+{
+  public:
+    HostHDC1080();
+
+    // temperature in 0.01 C, humidity in 0.01 %
+    void setClimate(int32_t temperature, uint32_t humidity);
+
+    bool i2cWrite(const uint8_t *data, uint8_t len);
+    uint8_t i2cRead(uint8_t *data, uint8_t len);
+
+  private:
+    uint8_t pointer;
+    uint16_t config;
+    uint16_t raw_t;
+    uint16_t raw_h;
+    uint64_t ready; // us when conversion ends
+};
+
+#endif
@@ -0,0 +1,473 @@
+/*
+  link_traces.h
+  -
+  24 hour link quality traces of scheduler_sim.cpp, one sample per 10
+  minutes as AT+NUESTATS reports them : RSRP in 0.1 dBm, SNR in 0.1 dB
+  and ECL. Traces are synthetic, a daily load cycle plus random fading
+  and blocking periods of three installs :
+
+    window   : indoor near a window, mostly ECL 0, ECL 1 in busy hours
+    basement : deep indoor, ECL 1 at night and ECL 2 during the day
+    parking  : vehicle in and out of a garage, all levels
+
+  A trace recorded on a node can be given to scheduler_sim as a CSV file
+  of the same columns instead.
+*/
+
+#ifndef _LINK_TRACES_H
+#define _LINK_TRACES_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t time; // s from start of trace
+  int16_t rsrp;
+  int16_t snr;
+  uint8_t ecl;
+} LinkSample;
+
+// window, ECL 0 / 1 / 2 : 91 / 51 / 2 samples
+static const LinkSample trace_window[] = {
+  {0, -1016, 227, 0},
+  {600, -1019, 193, 0},
+  {1200, -1051, 188, 0},
+  {1800, -1074, 154, 0},
+  {2400, -1062, 185, 0},
+  {3000, -1044, 180, 0},
+  {3600, -1042, 194, 0},
+  {4200, -1079, 184, 0},
+  {4800, -1062, 221, 0},
+  {5400, -1052, 189, 0},
+  {6000, -1017, 214, 0},
+  {6600, -998, 217, 0},
+  {7200, -1000, 237, 0},
+  {7800, -989, 230, 0},
+  {8400, -1025, 215, 0},
+  {9000, -1025, 219, 0},
+  {9600, -1022, 227, 0},
+  {10200, -1025, 212, 0},
+  {10800, -1011, 200, 0},
+  {11400, -1026, 201, 0},
+  {12000, -978, 233, 0},
+  {12600, -973, 246, 0},
+  {13200, -993, 203, 0},
+  {13800, -978, 228, 0},
+  {14400, -972, 217, 0},
+  {15000, -996, 242, 0},
+  {15600, -969, 218, 0},
+  {16200, -1017, 210, 0},
+  {16800, -1004, 220, 0},
+  {17400, -1004, 202, 0},
+  {18000, -998, 236, 0},
+  {18600, -1018, 186, 0},
+  {19200, -1043, 205, 0},
+  {19800, -1088, 167, 0},
+  {20400, -1105, 156, 1},
+  {21000, -1100, 160, 1},
+  {21600, -1054, 190, 0},
+  {22200, -1021, 199, 0},
+  {22800, -1040, 195, 0},
+  {23400, -1115, 147, 1},
+  {24000, -1100, 136, 1},
+  {24600, -1081, 156, 0},
+  {25200, -1139, 128, 1},
+  {25800, -1149, 117, 1},
+  {26400, -1136, 149, 1},
+  {27000, -1181, 104, 1},
+  {27600, -1161, 87, 1},
+  {28200, -1125, 117, 1},
+  {28800, -1116, 120, 1},
+  {29400, -1145, 113, 1},
+  {30000, -1096, 155, 0},
+  {30600, -1121, 126, 1},
+  {31200, -1154, 110, 1},
+  {31800, -1167, 113, 1},
+  {32400, -1137, 112, 1},
+  {33000, -1149, 98, 1},
+  {33600, -1119, 126, 1},
+  {34200, -1100, 151, 1},
+  {34800, -1070, 128, 0},
+  {35400, -1062, 125, 0},
+  {36000, -1071, 174, 0},
+  {36600, -1082, 133, 0},
+  {37200, -1082, 137, 0},
+  {37800, -1086, 122, 0},
+  {38400, -1063, 159, 0},
+  {39000, -1077, 141, 0},
+  {39600, -1067, 156, 0},
+  {40200, -1066, 151, 0},
+  {40800, -1082, 114, 0},
+  {41400, -1101, 134, 1},
+  {42000, -1079, 132, 0},
+  {42600, -1101, 121, 1},
+  {43200, -1062, 158, 0},
+  {43800, -1091, 120, 0},
+  {44400, -1133, 79, 1},
+  {45000, -1126, 100, 1},
+  {45600, -1101, 131, 1},
+  {46200, -1084, 141, 0},
+  {46800, -1106, 91, 1},
+  {47400, -1097, 153, 0},
+  {48000, -1093, 97, 0},
+  {48600, -1094, 134, 0},
+  {49200, -1126, 107, 1},
+  {49800, -1141, 105, 1},
+  {50400, -1118, 103, 1},
+  {51000, -1070, 119, 0},
+  {51600, -1098, 137, 0},
+  {52200, -1126, 126, 1},
+  {52800, -1127, 77, 1},
+  {53400, -1126, 95, 1},
+  {54000, -1121, 93, 1},
+  {54600, -1095, 75, 0},
+  {55200, -1115, 95, 1},
+  {55800, -1071, 94, 0},
+  {56400, -1090, 96, 0},
+  {57000, -1113, 111, 1},
+  {57600, -1104, 128, 1},
+  {58200, -1123, 100, 1},
+  {58800, -1093, 127, 0},
+  {59400, -1106, 123, 1},
+  {60000, -1132, 120, 1},
+  {60600, -1125, 95, 1},
+  {61200, -1186, 77, 1},
+  {61800, -1142, 87, 1},
+  {62400, -1159, 89, 1},
+  {63000, -1186, 41, 1},
+  {63600, -1163, 74, 1},
+  {64200, -1138, 79, 1},
+  {64800, -1218, 56, 2},
+  {65400, -1206, 83, 2},
+  {66000, -1186, 76, 1},
+  {66600, -1168, 76, 1},
+  {67200, -1167, 63, 1},
+  {67800, -1154, 80, 1},
+  {68400, -1167, 96, 1},
+  {69000, -1144, 84, 1},
+  {69600, -1097, 118, 0},
+  {70200, -1019, 185, 0},
+  {70800, -1027, 170, 0},
+  {71400, -994, 200, 0},
+  {72000, -1001, 157, 0},
+  {72600, -1036, 184, 0},
+  {73200, -1040, 151, 0},
+  {73800, -1064, 149, 0},
+  {74400, -1049, 169, 0},
+  {75000, -1029, 163, 0},
+  {75600, -1013, 178, 0},
+  {76200, -1032, 202, 0},
+  {76800, -1037, 173, 0},
+  {77400, -1048, 164, 0},
+  {78000, -1013, 211, 0},
+  {78600, -1005, 199, 0},
+  {79200, -990, 205, 0},
+  {79800, -992, 212, 0},
+  {80400, -1003, 226, 0},
+  {81000, -970, 240, 0},
+  {81600, -1034, 214, 0},
+  {82200, -1020, 189, 0},
+  {82800, -1027, 210, 0},
+  {83400, -1002, 220, 0},
+  {84000, -1008, 206, 0},
+  {84600, -995, 212, 0},
+  {85200, -1027, 188, 0},
+  {85800, -1034, 199, 0},
+};
+
+// basement, ECL 0 / 1 / 2 : 0 / 74 / 70 samples
+static const LinkSample trace_basement[] = {
+  {0, -1120, 138, 1},
+  {600, -1120, 151, 1},
+  {1200, -1111, 133, 1},
+  {1800, -1129, 134, 1},
+  {2400, -1156, 119, 1},
+  {3000, -1167, 122, 1},
+  {3600, -1183, 124, 1},
+  {4200, -1189, 67, 1},
+  {4800, -1158, 127, 1},
+  {5400, -1172, 130, 1},
+  {6000, -1164, 131, 1},
+  {6600, -1179, 126, 1},
+  {7200, -1205, 130, 2},
+  {7800, -1220, 98, 2},
+  {8400, -1207, 111, 2},
+  {9000, -1201, 119, 2},
+  {9600, -1265, 73, 2},
+  {10200, -1248, 78, 2},
+  {10800, -1202, 95, 2},
+  {11400, -1197, 82, 1},
+  {12000, -1186, 94, 1},
+  {12600, -1214, 138, 2},
+  {13200, -1191, 115, 1},
+  {13800, -1183, 97, 1},
+  {14400, -1202, 115, 2},
+  {15000, -1239, 92, 2},
+  {15600, -1261, 77, 2},
+  {16200, -1266, 99, 2},
+  {16800, -1227, 85, 2},
+  {17400, -1255, 65, 2},
+  {18000, -1241, 69, 2},
+  {18600, -1222, 109, 2},
+  {19200, -1215, 90, 2},
+  {19800, -1192, 104, 1},
+  {20400, -1173, 114, 1},
+  {21000, -1142, 130, 1},
+  {21600, -1172, 119, 1},
+  {22200, -1188, 93, 1},
+  {22800, -1190, 117, 1},
+  {23400, -1234, 79, 2},
+  {24000, -1228, 80, 2},
+  {24600, -1205, 74, 2},
+  {25200, -1189, 98, 1},
+  {25800, -1188, 98, 1},
+  {26400, -1196, 88, 1},
+  {27000, -1188, 131, 1},
+  {27600, -1169, 121, 1},
+  {28200, -1164, 102, 1},
+  {28800, -1159, 143, 1},
+  {29400, -1194, 103, 1},
+  {30000, -1176, 104, 1},
+  {30600, -1166, 125, 1},
+  {31200, -1129, 143, 1},
+  {31800, -1112, 136, 1},
+  {32400, -1114, 131, 1},
+  {33000, -1128, 113, 1},
+  {33600, -1131, 139, 1},
+  {34200, -1151, 108, 1},
+  {34800, -1151, 104, 1},
+  {35400, -1145, 109, 1},
+  {36000, -1183, 68, 1},
+  {36600, -1175, 96, 1},
+  {37200, -1162, 96, 1},
+  {37800, -1170, 63, 1},
+  {38400, -1152, 82, 1},
+  {39000, -1145, 81, 1},
+  {39600, -1174, 84, 1},
+  {40200, -1193, 59, 1},
+  {40800, -1182, 85, 1},
+  {41400, -1183, 68, 1},
+  {42000, -1209, 51, 2},
+  {42600, -1224, 48, 2},
+  {43200, -1260, 25, 2},
+  {43800, -1280, 7, 2},
+  {44400, -1255, 31, 2},
+  {45000, -1256, 32, 2},
+  {45600, -1249, 33, 2},
+  {46200, -1233, 51, 2},
+  {46800, -1300, -1, 2},
+  {47400, -1238, 16, 2},
+  {48000, -1245, 47, 2},
+  {48600, -1253, 46, 2},
+  {49200, -1285, -11, 2},
+  {49800, -1289, -6, 2},
+  {50400, -1310, 2, 2},
+  {51000, -1300, -2, 2},
+  {51600, -1305, -1, 2},
+  {52200, -1304, -15, 2},
+  {52800, -1290, 9, 2},
+  {53400, -1287, 15, 2},
+  {54000, -1259, 18, 2},
+  {54600, -1265, 37, 2},
+  {55200, -1248, 58, 2},
+  {55800, -1214, 39, 2},
+  {56400, -1240, 38, 2},
+  {57000, -1244, 27, 2},
+  {57600, -1263, 28, 2},
+  {58200, -1253, 31, 2},
+  {58800, -1242, 18, 2},
+  {59400, -1284, 5, 2},
+  {60000, -1286, 0, 2},
+  {60600, -1255, 24, 2},
+  {61200, -1219, 49, 2},
+  {61800, -1207, 61, 2},
+  {62400, -1194, 42, 1},
+  {63000, -1178, 72, 1},
+  {63600, -1206, 65, 2},
+  {64200, -1202, 79, 2},
+  {64800, -1191, 72, 1},
+  {65400, -1229, 71, 2},
+  {66000, -1196, 77, 1},
+  {66600, -1190, 88, 1},
+  {67200, -1212, 69, 2},
+  {67800, -1211, 45, 2},
+  {68400, -1204, 71, 2},
+  {69000, -1170, 99, 1},
+  {69600, -1209, 35, 2},
+  {70200, -1210, 62, 2},
+  {70800, -1227, 36, 2},
+  {71400, -1226, 42, 2},
+  {72000, -1234, 69, 2},
+  {72600, -1222, 53, 2},
+  {73200, -1239, 53, 2},
+  {73800, -1195, 74, 1},
+  {74400, -1160, 90, 1},
+  {75000, -1170, 108, 1},
+  {75600, -1189, 89, 1},
+  {76200, -1216, 85, 2},
+  {76800, -1186, 83, 1},
+  {77400, -1182, 90, 1},
+  {78000, -1225, 115, 2},
+  {78600, -1203, 100, 2},
+  {79200, -1190, 98, 1},
+  {79800, -1140, 97, 1},
+  {80400, -1153, 112, 1},
+  {81000, -1161, 126, 1},
+  {81600, -1178, 87, 1},
+  {82200, -1199, 104, 1},
+  {82800, -1174, 124, 1},
+  {83400, -1141, 123, 1},
+  {84000, -1126, 151, 1},
+  {84600, -1137, 124, 1},
+  {85200, -1125, 133, 1},
+  {85800, -1138, 122, 1},
+};
+
+// parking, ECL 0 / 1 / 2 : 36 / 47 / 61 samples
+static const LinkSample trace_parking[] = {
+  {0, -1094, 181, 0},
+  {600, -1145, 150, 1},
+  {1200, -1149, 130, 1},
+  {1800, -1033, 201, 0},
+  {2400, -1047, 202, 0},
+  {3000, -994, 221, 0},
+  {3600, -981, 214, 0},
+  {4200, -1023, 200, 0},
+  {4800, -1110, 137, 1},
+  {5400, -1196, 109, 1},
+  {6000, -1184, 115, 1},
+  {6600, -1161, 113, 1},
+  {7200, -1151, 142, 1},
+  {7800, -1098, 155, 0},
+  {8400, -1118, 127, 1},
+  {9000, -1140, 112, 1},
+  {9600, -1208, 125, 2},
+  {10200, -1305, 67, 2},
+  {10800, -1244, 84, 2},
+  {11400, -1188, 127, 1},
+  {12000, -1111, 158, 1},
+  {12600, -1140, 136, 1},
+  {13200, -1184, 120, 1},
+  {13800, -1209, 123, 2},
+  {14400, -1288, 47, 2},
+  {15000, -1302, 24, 2},
+  {15600, -1155, 99, 1},
+  {16200, -1159, 125, 1},
+  {16800, -1055, 160, 0},
+  {17400, -1004, 206, 0},
+  {18000, -1031, 191, 0},
+  {18600, -1009, 196, 0},
+  {19200, -1031, 205, 0},
+  {19800, -944, 211, 0},
+  {20400, -891, 290, 0},
+  {21000, -960, 241, 0},
+  {21600, -1014, 231, 0},
+  {22200, -1020, 199, 0},
+  {22800, -1050, 181, 0},
+  {23400, -1071, 159, 0},
+  {24000, -965, 200, 0},
+  {24600, -1192, 101, 1},
+  {25200, -1183, 112, 1},
+  {25800, -1180, 105, 1},
+  {26400, -1148, 138, 1},
+  {27000, -1166, 107, 1},
+  {27600, -1049, 184, 0},
+  {28200, -1116, 173, 1},
+  {28800, -1194, 85, 1},
+  {29400, -1267, 57, 2},
+  {30000, -1308, 12, 2},
+  {30600, -1366, -12, 2},
+  {31200, -1280, 35, 2},
+  {31800, -1353, 10, 2},
+  {32400, -1328, 25, 2},
+  {33000, -1245, 54, 2},
+  {33600, -1254, 50, 2},
+  {34200, -1315, 25, 2},
+  {34800, -1227, 65, 2},
+  {35400, -1245, 47, 2},
+  {36000, -1169, 80, 1},
+  {36600, -1184, 70, 1},
+  {37200, -1199, 49, 1},
+  {37800, -1167, 90, 1},
+  {38400, -1224, 22, 2},
+  {39000, -1208, 81, 2},
+  {39600, -1234, 42, 2},
+  {40200, -1247, 50, 2},
+  {40800, -1276, 38, 2},
+  {41400, -1266, 42, 2},
+  {42000, -1240, 38, 2},
+  {42600, -1302, -4, 2},
+  {43200, -1285, 24, 2},
+  {43800, -1244, 26, 2},
+  {44400, -1202, 73, 2},
+  {45000, -1199, 53, 1},
+  {45600, -1210, 65, 2},
+  {46200, -1168, 61, 1},
+  {46800, -1144, 80, 1},
+  {47400, -1186, 82, 1},
+  {48000, -1134, 81, 1},
+  {48600, -1133, 99, 1},
+  {49200, -1171, 68, 1},
+  {49800, -1130, 66, 1},
+  {50400, -1116, 111, 1},
+  {51000, -1095, 91, 0},
+  {51600, -1089, 101, 0},
+  {52200, -1070, 133, 0},
+  {52800, -1074, 110, 0},
+  {53400, -1122, 108, 1},
+  {54000, -1177, 73, 1},
+  {54600, -1143, 80, 1},
+  {55200, -1013, 157, 0},
+  {55800, -922, 175, 0},
+  {56400, -1091, 128, 0},
+  {57000, -1067, 122, 0},
+  {57600, -1086, 88, 0},
+  {58200, -1133, 75, 1},
+  {58800, -1148, 96, 1},
+  {59400, -1145, 91, 1},
+  {60000, -1183, 58, 1},
+  {60600, -1169, 69, 1},
+  {61200, -1094, 102, 0},
+  {61800, -1000, 152, 0},
+  {62400, -970, 173, 0},
+  {63000, -914, 218, 0},
+  {63600, -937, 215, 0},
+  {64200, -1012, 148, 0},
+  {64800, -1289, 31, 2},
+  {65400, -1325, -15, 2},
+  {66000, -1316, 29, 2},
+  {66600, -1403, -44, 2},
+  {67200, -1399, -36, 2},
+  {67800, -1472, -89, 2},
+  {68400, -1386, -11, 2},
+  {69000, -1275, 15, 2},
+  {69600, -1270, 30, 2},
+  {70200, -1345, -30, 2},
+  {70800, -1288, 28, 2},
+  {71400, -1291, 42, 2},
+  {72000, -1340, 6, 2},
+  {72600, -1324, 7, 2},
+  {73200, -1284, 34, 2},
+  {73800, -1264, 47, 2},
+  {74400, -1156, 99, 1},
+  {75000, -1121, 134, 1},
+  {75600, -1167, 113, 1},
+  {76200, -1231, 84, 2},
+  {76800, -1280, 34, 2},
+  {77400, -1256, 68, 2},
+  {78000, -1205, 98, 2},
+  {78600, -1225, 61, 2},
+  {79200, -1199, 95, 1},
+  {79800, -1261, 73, 2},
+  {80400, -1247, 53, 2},
+  {81000, -1222, 62, 2},
+  {81600, -1274, 61, 2},
+  {82200, -1353, 13, 2},
+  {82800, -1265, 73, 2},
+  {83400, -1272, 62, 2},
+  {84000, -1320, 29, 2},
+  {84600, -1223, 95, 2},
+  {85200, -1299, 61, 2},
+  {85800, -1209, 92, 2},
+};
+
+#endif
@@ -0,0 +1,257 @@
+/*
+  nuestats_fuzz.cpp - checks radio parsers of Sixfab_RadioStats.cpp on host.
+  -
+  Response lines quoted in the library are parsed first and compared with
+  their expected values. Then malformed lines are generated : every
+  prefix of a valid line, single byte mutations, overlong numbers and
+  lines of random characters of the AT+NUESTATS alphabet. Each line is
+  copied to a buffer of its exact size, so a build with
+  CXXFLAGS="-g -O1 -fsanitize=address,undefined" catches reads past the
+  terminator. A parser that rejects a line must leave its output
+  untouched, an accepted one must give values in range.
+
+  Last, mutated AT+NUESTATS responses are answered by the BC95 emulator
+  and read through SixfabNBIoT::readUEStats() into SixfabLinkMonitor,
+  whose min / avg / max must stay ordered.
+
+  The generator has a fixed seed, so failures are repeatable.
+
+  Build and run : make -C extras/test nuestats_fuzz && extras/test/nuestats_fuzz
+*/
+
+#include "Arduino.h"
+#include "bc95_emulator.h"
+#include "Sixfab_NBIoT.h"
+
+#define FUZZ_ROUNDS 200000
+#define FUZZ_RESPONSES 2000
+#define FUZZ_LINE_LEN 96
+
+BC95Emulator bc95;
+SixfabNBIoT node(Serial1, Wire);
+
+static uint32_t rng = 2463534242UL;
+static uint32_t failures = 0;
+
+static uint32_t next_random()
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void fail(const char *what, const char *line)
+{
+  if(failures++ < 10)
+    printf("FAIL %s : \"%s\"\n", what, line);
+}
+
+static const char * const valid[] = {
+  "+CSQ:22,99",
+  "+CSQ:99,99",
+  "Signal power:-907",
+  "Total power:-837",
+  "TX power:-32768",
+  "TX time:1234",
+  "RX time:56789",
+  "Cell ID:21229824",
+  "ECL:1",
+  "SNR:36",
+  "EARFCN:2506",
+  "PCI:105",
+  "RSRQ:-108",
+  "CURRENT BAND:8",
+  "NUESTATS:RADIO,Signal power,-907",
+  "NUESTATS:RADIO,RSRQ,-108",
+  "NUESTATS:CELL,2506,105,1,-907,-108,-837,36",
+  "+NUESTATS:CELL,3734,42,0,-1250,-140,-1180,-60",
+};
+
+static const char alphabet[] = "+CSQ:NUESTATS,RADIOCELL0123456789- :SignalpowerTXtimeECLSNRPCI";
+
+static void check_known()
+{
+  NBIoT_SignalQuality quality;
+  NBIoT_UEStats stats;
+  NBIoT_CellStats cell;
+
+  memset(&stats, 0, sizeof(stats));
+  if(!parseSignalQuality("+CSQ:22,99", &quality) || quality.rssi != 22 || quality.ber != CSQ_UNKNOWN || quality.rssi_dbm != -69)
+    fail("csq", "+CSQ:22,99");
+  if(parseSignalQuality("+CSQ:32,99", &quality))
+    fail("csq range", "+CSQ:32,99");
+  for(uint8_t i = 2; i < 16; i++){
+    if(!parseUEStatsLine(valid[i], &stats))
+      fail("nuestats", valid[i]);
+  }
+  if(stats.rsrp != -907 || stats.total_power != -837 || stats.tx_power != TX_POWER_UNKNOWN ||
+     stats.tx_time != 1234 || stats.rx_time != 56789 || stats.cell_id != 21229824UL ||
+     stats.ecl != 1 || stats.snr != 36 || stats.earfcn != 2506 || stats.pci != 105 ||
+     stats.rsrq != -108 || stats.band != 8 || stats.fields != 0x0FFF)
+    fail("nuestats values", "");
+  if(parseUEStatsLine("ECL:3", &stats) || parseUEStatsLine("PCI:5x", &stats) || parseUEStatsLine("SNR:40000", &stats))
+    fail("nuestats range", "ECL:3 / PCI:5x / SNR:40000");
+  if(!parseCellStatsLine(valid[16], &cell) || cell.earfcn != 2506 || cell.pci != 105 || cell.primary != 1 ||
+     cell.rsrp != -907 || cell.rsrq != -108 || cell.rssi != -837 || cell.snr != 36)
+    fail("cell", valid[16]);
+}
+
+// runs one line through every parser, line is an exact size heap copy
+static void check_line(const char *text, uint16_t len)
+{
+  char *line = (char *)malloc(len + 1);
+  NBIoT_SignalQuality quality, quality_before;
+  NBIoT_UEStats stats, stats_before;
+  NBIoT_CellStats cell, cell_before;
+
+  memcpy(line, text, len);
+  line[len] = '\0';
+  memset(&quality, 0xA5, sizeof(quality));
+  memset(&stats, 0xA5, sizeof(stats));
+  memset(&cell, 0xA5, sizeof(cell));
+  stats.fields = 0;
+  quality_before = quality;
+  stats_before = stats;
+  cell_before = cell;
+
+  if(parseSignalQuality(line, &quality)){
+    if((quality.rssi > 31 && quality.rssi != CSQ_UNKNOWN) || (quality.ber > 7 && quality.ber != CSQ_UNKNOWN))
+      fail("csq out of range", line);
+  }
+  else if(memcmp(&quality, &quality_before, sizeof(quality)) != 0)
+    fail("csq written on reject", line);
+
+  if(parseUEStatsLine(line, &stats)){
+    if(stats.fields == 0 || (stats.fields & (stats.fields - 1)) != 0)
+      fail("nuestats sets one field", line);
+    if((stats.fields & UESTATS_ECL) && stats.ecl > 2)
+      fail("ecl out of range", line);
+    if((stats.fields & UESTATS_PCI) && stats.pci > 503)
+      fail("pci out of range", line);
+  }
+  else if(memcmp(&stats, &stats_before, sizeof(stats)) != 0)
+    fail("nuestats written on reject", line);
+
+  if(parseCellStatsLine(line, &cell)){
+    if(cell.pci > 503 || cell.primary > 1)
+      fail("cell out of range", line);
+  }
+  else if(memcmp(&cell, &cell_before, sizeof(cell)) != 0)
+    fail("cell written on reject", line);
+
+  free(line);
+}
+
+static void check_malformed()
+{
+  char line[FUZZ_LINE_LEN];
+
+  // truncated lines
+  for(uint8_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++){
+    for(uint16_t len = 0; len <= strlen(valid[i]); len++)
+      check_line(valid[i], len);
+  }
+
+  // overlong and signed numbers
+  static const char * const numbers[] = {"-", "--1", "+1", "-32769", "32768", "4294967296", "99999999999999999999", "0x10", " 1", "1 ", ""};
+  for(uint8_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++){
+    static const char * const names[] = {"Signal power:", "TX time:", "ECL:", "PCI:", "CURRENT BAND:", "NUESTATS:RADIO,SNR,", "NUESTATS:CELL,", "+CSQ:"};
+    for(uint8_t n = 0; n < sizeof(names) / sizeof(names[0]); n++){
+      snprintf(line, sizeof(line), "%s%s", names[n], numbers[i]);
+      check_line(line, strlen(line));
+    }
+  }
+
+  for(uint32_t round = 0; round < FUZZ_ROUNDS; round++){
+    uint16_t len;
+
+    if(round & 1){
+      // mutated valid line
+      const char *base = valid[next_random() % (sizeof(valid) / sizeof(valid[0]))];
+      len = strlen(base);
+      memcpy(line, base, len);
+      for(uint8_t m = 1 + next_random() % 3; m > 0 && len; m--){
+        uint16_t at = next_random() % len;
+        switch(next_random() % 3){
+          case 0: line[at] = alphabet[next_random() % (sizeof(alphabet) - 1)]; break;
+          case 1: memmove(line + at, line + at + 1, len - at - 1); len--; break;
+          case 2:
+            if(len < sizeof(line) - 1){
+              memmove(line + at + 1, line + at, len - at);
+              line[at] = (next_random() & 1) ? ',' : (char)('0' + next_random() % 10);
+              len++;
+            }
+            break;
+        }
+      }
+    }
+    else{
+      // random characters of response alphabet
+      len = next_random() % (sizeof(line) - 1);
+      for(uint16_t i = 0; i < len; i++)
+        line[i] = alphabet[next_random() % (sizeof(alphabet) - 1)];
+    }
+    check_line(line, len);
+  }
+}
+
+// mutated AT+NUESTATS responses through readUEStats() and SixfabLinkMonitor
+static void check_responses()
+{
+  static const char response[] =
+    "\r\nSignal power:-907\r\nTotal power:-837\r\nTX power:100\r\nTX time:1234\r\n"
+    "RX time:5678\r\nCell ID:21229824\r\nECL:1\r\nSNR:36\r\nEARFCN:2506\r\n"
+    "PCI:105\r\nRSRQ:-108\r\n\r\nOK\r\n";
+  uint8_t raw[sizeof(response)];
+  SixfabLinkMonitor monitor;
+  uint32_t accepted = 0;
+
+  Serial1.hostAttach(&bc95);
+  node.setTimeout(100);
+
+  for(uint32_t round = 0; round < FUZZ_RESPONSES; round++){
+    NBIoT_UEStats stats;
+    uint16_t len = sizeof(response) - 1;
+
+    memcpy(raw, response, len);
+    for(uint8_t m = next_random() % 4; m > 0 && len; m--){
+      uint16_t at = next_random() % len;
+      if(next_random() % 4 == 0)
+        len = at; // cut short
+      else
+        raw[at] = alphabet[next_random() % (sizeof(alphabet) - 1)];
+    }
+
+    bc95.setReply("AT+NUESTATS", raw, len);
+    if(node.readUEStats(&stats)){
+      monitor.update(stats);
+      accepted++;
+    }
+    // timed out replies don't leak into next round
+    hostAdvance(1000000ULL);
+    while(Serial1.available())
+      Serial1.read();
+
+    if(monitor.rsrp.count && (monitor.rsrp.min > monitor.rsrp.avg || monitor.rsrp.avg > monitor.rsrp.max))
+      fail("rsrp rolling order", "");
+    if(monitor.snr.count && (monitor.snr.min > monitor.snr.avg || monitor.snr.avg > monitor.snr.max))
+      fail("snr rolling order", "");
+    if(monitor.ecl != 0xFF && monitor.ecl > 2)
+      fail("monitor ecl", "");
+  }
+  printf("responses %u accepted %u updates %lu\n", FUZZ_RESPONSES, accepted, (unsigned long)monitor.updates);
+}
+
+int main()
+{
+  sixfabLog.setLevel(LOG_LEVEL_NONE);
+
+  check_known();
+  check_malformed();
+  check_responses();
+
+  printf("lines %u failures %lu\n", FUZZ_ROUNDS, (unsigned long)failures);
+  fflush(stdout);
+  return failures ? 1 : 0;
+}
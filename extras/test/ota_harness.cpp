@@ -0,0 +1,302 @@
+/*
+  ota_harness.cpp - runs SixfabOTA against a lossy server on the BC95 emulator.
+  -
+  Server is the uplink handler of the emulator. It answers manifest and
+  chunk requests of Sixfab_OTA.h with downlinks whose delay has random
+  jitter, so chunks of a window arrive out of order. Per scenario, chunks
+  are also dropped, duplicated, corrupted (CRC-16 fails) or the server
+  stops answering after a number of chunks, like a coverage loss.
+  Interrupted downloads are resumed by a new SixfabOTA object, as after
+  a reboot, from the state kept in EEPROM.
+
+  Each scenario must end with a verified image equal to the served one
+  and must never request a chunk that is already written, since every
+  served chunk is paid for. Served / needed chunks gives the data
+  overhead of the loss pattern.
+
+  The generator has a fixed seed, so output is identical on every run.
+
+  Build and run : make -C extras/test ota_harness && extras/test/ota_harness
+*/
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "bc95_emulator.h"
+#include "Sixfab_OTA.h"
+
+#define HARNESS_IMAGE_LEN 4000
+#define HARNESS_VERSION 7
+#define HARNESS_CHUNKS ((HARNESS_IMAGE_LEN + OTA_CHUNK_LEN - 1) / OTA_CHUNK_LEN)
+
+typedef struct {
+  const char *name;
+  uint8_t loss;      // % of chunks dropped
+  uint8_t duplicate; // % of chunks sent twice
+  uint8_t corrupt;   // % of chunks with a flipped bit
+  uint16_t jitter;   // ms, max extra delay of a chunk
+  uint16_t budget;   // chunks served per session before server stops answering, 0 : no limit
+} Scenario;
+
+static const Scenario scenarios[] = {
+  {"clean",       0,  0, 0,    0,  0},
+  {"reorder",     0,  0, 0, 1500,  0},
+  {"lossy",      10,  5, 1, 1500,  0},
+  {"heavy",      30, 10, 2, 3000,  0},
+  {"interrupted", 5,  0, 0, 1000, 20},
+};
+
+BC95Emulator bc95;
+SixfabNBIoT node(Serial1, Wire);
+
+static char ip[] = "10.0.0.1";
+static char port[] = "5683";
+static uint8_t image[HARNESS_IMAGE_LEN];  // served by server
+static uint8_t storage[HARNESS_IMAGE_LEN]; // written by client
+static uint32_t failures = 0;
+static uint32_t rng = 2463534242UL;
+
+// server state of a scenario
+static struct {
+  const Scenario *scenario;
+  bool written[HARNESS_CHUNKS]; // chunk is in storage of client
+  uint32_t served;              // chunks sent, lost ones included
+  uint32_t session_served;      // chunks sent since last resume
+  uint32_t served_bytes;        // downlink bytes of chunks
+  uint32_t refetched;           // requests of chunks already written
+  uint32_t queue_full;          // downlinks the emulator couldn't take
+  bool stopped;
+} server;
+
+static uint32_t next_random()
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void check(bool ok, const char *scenario, const char *what)
+{
+  if(!ok){
+    failures++;
+    printf("FAIL %s : %s\n", scenario, what);
+  }
+}
+
+static void put_u16(uint8_t *p, uint16_t value)
+{
+  p[0] = value >> 8;
+  p[1] = value;
+}
+
+static void put_u32(uint8_t *p, uint32_t value)
+{
+  put_u16(p, value >> 16);
+  put_u16(p + 2, value);
+}
+
+// same checks as Sixfab_OTA.cpp, server side
+static uint16_t crc16(const uint8_t *data, uint16_t len)
+{
+  uint16_t crc = 0xFFFF;
+
+  while(len--){
+    crc ^= (uint16_t)*data++ << 8;
+    for(uint8_t i = 0; i < 8; i++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+static uint32_t crc32(const uint8_t *data, uint32_t len)
+{
+  uint32_t crc = 0xFFFFFFFFUL;
+
+  while(len--){
+    crc ^= *data++;
+    for(uint8_t i = 0; i < 8; i++)
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+static void send(BC95Emulator &modem, uint8_t socket, const uint8_t *data, uint16_t len, uint32_t delay)
+{
+  if(!modem.queueDownlink(socket, data, len, delay))
+    server.queue_full++;
+}
+
+static void serve_chunk(BC95Emulator &modem, uint8_t socket, uint16_t index)
+{
+  const Scenario &scenario = *server.scenario;
+  uint8_t packet[OTA_HEADER_LEN + OTA_CHUNK_LEN];
+  uint32_t offset = (uint32_t)index * OTA_CHUNK_LEN;
+  uint16_t len = (HARNESS_IMAGE_LEN - offset < OTA_CHUNK_LEN) ? HARNESS_IMAGE_LEN - offset : OTA_CHUNK_LEN;
+
+  if(scenario.budget && server.session_served >= scenario.budget){
+    server.stopped = true;
+    return;
+  }
+  server.served++;
+  server.session_served++;
+  server.served_bytes += OTA_HEADER_LEN + len;
+
+  packet[0] = 'D';
+  put_u32(packet + 1, HARNESS_VERSION);
+  put_u16(packet + 5, index);
+  put_u16(packet + 7, crc16(image + offset, len));
+  memcpy(packet + OTA_HEADER_LEN, image + offset, len);
+
+  if(next_random() % 100 < scenario.corrupt)
+    packet[OTA_HEADER_LEN + next_random() % len] ^= 1 << (next_random() % 8);
+  if(next_random() % 100 < scenario.loss)
+    return;
+
+  uint32_t jitter = scenario.jitter ? next_random() % scenario.jitter : 0;
+  send(modem, socket, packet, OTA_HEADER_LEN + len, BC95_NETWORK_RTT + jitter);
+  if(next_random() % 100 < scenario.duplicate)
+    send(modem, socket, packet, OTA_HEADER_LEN + len, BC95_NETWORK_RTT + jitter + next_random() % 500);
+}
+
+static void on_request(BC95Emulator &modem, uint8_t socket, const uint8_t *data, uint16_t len, void *context)
+{
+  (void)context;
+
+  if(len == 5 && data[0] == 'M'){
+    uint8_t manifest[13];
+    manifest[0] = 'M';
+    put_u32(manifest + 1, HARNESS_VERSION);
+    put_u32(manifest + 5, HARNESS_IMAGE_LEN);
+    put_u32(manifest + 9, crc32(image, HARNESS_IMAGE_LEN));
+    send(modem, socket, manifest, sizeof(manifest), BC95_NETWORK_RTT);
+  }
+  else if(len == 8 && data[0] == 'C'){
+    uint16_t first = ((uint16_t)data[5] << 8) | data[6];
+    for(uint8_t i = 0; i < OTA_WINDOW; i++){
+      if(!(data[7] & (1 << i)) || first + i >= HARNESS_CHUNKS)
+        continue;
+      if(server.written[first + i])
+        server.refetched++;
+      serve_chunk(modem, socket, first + i);
+    }
+  }
+}
+
+static bool write_image(uint32_t offset, const uint8_t *data, uint16_t len, void *context)
+{
+  (void)context;
+  if(offset + len > sizeof(storage))
+    return false;
+  memcpy(storage + offset, data, len);
+  server.written[offset / OTA_CHUNK_LEN] = true;
+  return true;
+}
+
+static bool read_image(uint32_t offset, uint8_t *data, uint16_t len, void *context)
+{
+  (void)context;
+  if(offset + len > sizeof(storage))
+    return false;
+  memcpy(data, storage + offset, len);
+  return true;
+}
+
+static void begin_ports(uint32_t baud)
+{
+  Serial1.begin(baud);
+}
+
+// drops downlinks of previous scenario
+static void drain()
+{
+  uint8_t buffer[UDP_DATA_LEN];
+
+  delay(10000);
+  while(node.receiveDataUDP(buffer, sizeof(buffer)) > 0)
+    ;
+}
+
+static void run(const Scenario &scenario)
+{
+  uint32_t start = millis();
+  uint32_t requests = 0, received = 0, duplicates = 0, corrupt = 0;
+  uint32_t resumed_at = 0;
+  uint8_t sessions = 1;
+  NBIoT_OTAStatus status;
+
+  memset(&server, 0, sizeof(server));
+  memset(storage, 0, sizeof(storage));
+  server.scenario = &scenario;
+  EEPROM.erase();
+
+  {
+    SixfabOTA ota(node, write_image, read_image, NULL);
+    check(ota.checkUpdate(HARNESS_VERSION - 1), scenario.name, "manifest");
+    status = ota.download();
+    requests += ota.requests_sent;
+    received += ota.chunks_received;
+    duplicates += ota.chunks_duplicate;
+    corrupt += ota.chunks_corrupt;
+    resumed_at = ota.getProgress();
+  }
+
+  // reboot and resume from EEPROM, coverage is back until budget is used again
+  while(status == OTA_INTERRUPTED && sessions < 8){
+    check(server.stopped, scenario.name, "interrupted only when server stopped");
+    server.stopped = false;
+    server.session_served = 0;
+    sessions++;
+
+    SixfabOTA ota(node, write_image, read_image, NULL);
+    status = ota.download();
+    requests += ota.requests_sent;
+    received += ota.chunks_received;
+    duplicates += ota.chunks_duplicate;
+    corrupt += ota.chunks_corrupt;
+  }
+
+  check(status == OTA_DONE, scenario.name, "download completes");
+  check(memcmp(storage, image, HARNESS_IMAGE_LEN) == 0, scenario.name, "stored image equals served image");
+  check(server.refetched == 0, scenario.name, "written chunks are never requested again");
+  check(received == HARNESS_CHUNKS, scenario.name, "every chunk written once");
+  if(scenario.budget)
+    check(sessions > 1 && resumed_at > 0, scenario.name, "download resumed after interruption");
+
+  printf("%s,%u,%u,%u,%u,%u,%lu,%lu,%.2f,%lu,%lu,%lu,%lu,%lu\n",
+    scenario.name, scenario.loss, scenario.duplicate, scenario.corrupt, scenario.jitter, sessions,
+    (unsigned long)requests, (unsigned long)server.served, (double)server.served / HARNESS_CHUNKS,
+    (unsigned long)server.served_bytes, (unsigned long)duplicates, (unsigned long)corrupt,
+    (unsigned long)server.queue_full, (unsigned long)((millis() - start) / 1000));
+
+  drain();
+}
+
+int main(int argc, char **argv)
+{
+  bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+
+  for(uint16_t i = 0; i < HARNESS_IMAGE_LEN; i++)
+    image[i] = next_random();
+
+  Serial1.hostAttach(&bc95);
+  bc95.setUplinkHandler(on_request, NULL);
+  if(!verbose)
+    sixfabLog.setLevel(LOG_LEVEL_NONE);
+
+  node.setBaudHandler(begin_ports);
+  node.init();
+  node.setIPAddress(ip);
+  node.setPort(port);
+  node.connectToOperator();
+  node.startUDPService();
+
+  printf("# image %u bytes, %u chunks of %u\n", HARNESS_IMAGE_LEN, HARNESS_CHUNKS, OTA_CHUNK_LEN);
+  printf("scenario,loss_pct,dup_pct,corrupt_pct,jitter_ms,sessions,requests,served,served_per_chunk,served_bytes,duplicates,corrupt,queue_full,seconds\n");
+  for(uint8_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+    run(scenarios[i]);
+
+  printf("%lu failures\n", (unsigned long)failures);
+  sixfabLog.flush();
+  fflush(stdout);
+  return failures ? 1 : 0;
+}
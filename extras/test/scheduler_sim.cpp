@@ -0,0 +1,350 @@
+/*
+  scheduler_sim.cpp - trace driven simulation of SixfabUplinkScheduler.
+  -
+  A day of link quality of link_traces.h (or of CSV files given on the
+  command line, "seconds,rsrp,snr,ecl" per line) drives the radio of the
+  BC95 emulator on virtual time. The same message load is sent twice :
+  once with every message sent at submit time, once through the
+  scheduler. Load is a normal priority reading every 30 minutes (may
+  wait 55 minutes), a bulk log every 4 hours (may wait 3 h 55 min) and
+  an urgent alarm every 5 h 17 min.
+
+  Energy is taken from the emulator : airtime of each datagram at the
+  TX power of its ECL plus RX time of grants, with the power figures of
+  Sixfab_UplinkScheduler.h. Estimate of the scheduler itself, from TX
+  time counters of AT+NUESTATS, is printed next to it. Awake time of
+  MCU is left out, it is the same for both runs except NUESTATS
+  readings of the scheduler.
+
+  Each trace is run a third time through the scheduler with the emulator
+  refusing every SIM_REJECT_EVERY-th AT+NSOST. Refused messages must be
+  sent again before their deadline, or be reported as failed, never
+  lost. Last, with every AT+NSOST refused, a message must be reported
+  failed after UPLINK_SEND_ATTEMPTS refusals past its deadline, and a
+  message held in bad coverage must expire over power down sleep that
+  millis() doesn't count but SixfabTime::addSleep() does.
+
+  Output is one CSV row per trace and mode and the saving of each trace,
+  identical on every run.
+
+  Build and run : make -C extras/test scheduler_sim && extras/test/scheduler_sim [trace.csv ...]
+*/
+
+#include "Arduino.h"
+#include "bc95_emulator.h"
+#include "link_traces.h"
+#include "Sixfab_UplinkScheduler.h"
+#include "Sixfab_Time.h"
+
+#define SIM_STEP 10000UL          // ms between polls of scheduler
+#define SIM_NORMAL_PERIOD 1800UL  // s
+#define SIM_NORMAL_DELAY 3300000UL
+#define SIM_BULK_PERIOD 14400UL
+#define SIM_BULK_DELAY 14100000UL
+#define SIM_URGENT_PERIOD 19020UL
+#define SIM_MESSAGES 128
+#define SIM_TRACE_LEN 1024
+#define SIM_REJECT_EVERY 3 // every n-th AT+NSOST is refused in MODE_REJECTED
+
+enum { MODE_IMMEDIATE, MODE_SCHEDULED, MODE_REJECTED };
+
+typedef struct {
+  uint32_t submitted;
+  uint32_t sent;
+  uint32_t rejected;     // queue of scheduler was full
+  uint32_t per_ecl[3];   // datagrams sent at each ECL
+  uint64_t energy;       // uJ, from emulator airtime
+  uint64_t delay;        // ms, sum of submit to air
+  uint32_t max_delay;    // ms
+  uint32_t last_tx_time; // emulator TX time at previous datagram
+  uint32_t submit_time[SIM_MESSAGES];
+  uint8_t ecl;           // ECL of current trace sample
+} SimStats;
+
+static uint8_t payloads[SIM_MESSAGES][UDP_DATA_LEN];
+static char ip[] = "10.0.0.1";
+static char port[] = "5683";
+static uint32_t failures = 0;
+
+static void begin_ports(uint32_t baud)
+{
+  Serial1.begin(baud);
+}
+
+// TX power consumption at output power the emulator reports for ECL
+static uint32_t tx_mw(uint8_t ecl)
+{
+  if(ecl)
+    return TX_POWER_MW_MAX;
+  return TX_POWER_MW_MIN + (uint32_t)(TX_POWER_MW_MAX - TX_POWER_MW_MIN) * 100 / 230;
+}
+
+// every datagram reaches here when it goes on air
+static void on_air(BC95Emulator &modem, uint8_t socket, const uint8_t *data, uint16_t len, void *context)
+{
+  SimStats *stats = (SimStats *)context;
+  uint16_t seq = ((uint16_t)data[1] << 8) | data[2];
+  uint32_t delay = millis() - stats->submit_time[seq];
+  (void)socket; (void)len;
+
+  stats->energy += (uint64_t)(modem.tx_time - stats->last_tx_time) * tx_mw(stats->ecl);
+  stats->last_tx_time = modem.tx_time;
+  stats->per_ecl[stats->ecl]++;
+  stats->sent++;
+  stats->delay += delay;
+  if(delay > stats->max_delay)
+    stats->max_delay = delay;
+}
+
+static uint16_t load_csv(const char *path, LinkSample *trace, uint16_t size)
+{
+  FILE *file = fopen(path, "r");
+  char line[128];
+  uint16_t len = 0;
+
+  if(file == NULL)
+    return 0;
+  while(len < size && fgets(line, sizeof(line), file)){
+    unsigned long time;
+    int rsrp, snr, ecl;
+    if(sscanf(line, "%lu,%d,%d,%d", &time, &rsrp, &snr, &ecl) != 4 || ecl < 0 || ecl > 2)
+      continue; // header or comment
+    trace[len].time = time;
+    trace[len].rsrp = rsrp;
+    trace[len].snr = snr;
+    trace[len].ecl = ecl;
+    len++;
+  }
+  fclose(file);
+  return len;
+}
+
+// runs trace in mode, returns radio energy in uJ
+static uint64_t run(const char *name, const LinkSample *trace, uint16_t len, uint8_t mode)
+{
+  static BC95Emulator bc95; // assigned fresh below, too large for stack
+  static SimStats stats;
+  SixfabNBIoT node(Serial1, Wire);
+  SixfabLinkMonitor monitor;
+  SixfabUplinkScheduler scheduler(node, monitor);
+  uint32_t end = (trace[len - 1].time + 600) * 1000UL;
+  uint16_t seq = 0;
+  uint16_t sample = 0;
+
+  bc95 = BC95Emulator();
+  memset(&stats, 0, sizeof(stats));
+  Serial1.hostAttach(&bc95);
+  bc95.setUplinkHandler(on_air, &stats);
+  bc95.setLink(trace[0].rsrp, trace[0].snr, trace[0].ecl);
+  stats.ecl = trace[0].ecl;
+  if(mode == MODE_REJECTED)
+    bc95.setSendReject(SIM_REJECT_EVERY);
+
+  node.setBaudHandler(begin_ports);
+  node.init();
+  node.setIPAddress(ip);
+  node.setPort(port);
+  node.connectToOperator();
+  node.startUDPService();
+
+  uint32_t start = millis();
+  for(uint32_t t = 0; t < end; t += SIM_STEP){
+    uint32_t s = t / 1000;
+
+    while(sample + 1 < len && trace[sample + 1].time <= s)
+      sample++;
+    bc95.setLink(trace[sample].rsrp, trace[sample].snr, trace[sample].ecl);
+    stats.ecl = trace[sample].ecl;
+
+    // load of the node, sequence number in bytes 1-2
+    NBIoT_Priority priority = PRIORITY_NORMAL;
+    uint32_t max_delay = 0;
+    uint16_t size = 0;
+    if(t % (SIM_URGENT_PERIOD * 1000) == 0 && t){
+      priority = PRIORITY_URGENT;
+      size = 8;
+    }
+    else if(t % (SIM_BULK_PERIOD * 1000) == 0){
+      priority = PRIORITY_BULK;
+      max_delay = SIM_BULK_DELAY;
+      size = UDP_DATA_LEN;
+    }
+    else if(t % (SIM_NORMAL_PERIOD * 1000) == 0){
+      max_delay = SIM_NORMAL_DELAY;
+      size = 24;
+    }
+
+    if(size && seq < SIM_MESSAGES){
+      uint8_t *data = payloads[seq];
+      memset(data, seq, size);
+      data[0] = priority;
+      data[1] = seq >> 8;
+      data[2] = seq;
+      stats.submit_time[seq] = millis();
+      stats.submitted++;
+      if(mode == MODE_IMMEDIATE)
+        node.sendDataUDP(data, size);
+      else if(!scheduler.submit(data, size, priority, max_delay))
+        stats.rejected++;
+      seq++;
+    }
+
+    if(mode != MODE_IMMEDIATE)
+      scheduler.poll();
+    uint32_t elapsed = millis() - start;
+    if(elapsed < t + SIM_STEP)
+      delay(t + SIM_STEP - elapsed);
+  }
+
+  // waiting messages go at end of trace, last reports need one more reading
+  while(mode != MODE_IMMEDIATE && scheduler.pending()){
+    delay(SIM_STEP);
+    scheduler.poll();
+  }
+  if(mode != MODE_IMMEDIATE){
+    scheduler.setRefreshInterval(0);
+    scheduler.poll();
+  }
+
+  static const char * const modes[] = {"immediate", "scheduled", "rejected"};
+  uint32_t failed = (mode == MODE_IMMEDIATE) ? bc95.rejects : scheduler.failed_count;
+  uint64_t energy = stats.energy + (uint64_t)bc95.rx_time * RX_POWER_MW;
+  printf("%s,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.1f,%.1f,%lu,%lu,%.1f\n",
+    name, modes[mode],
+    (unsigned long)stats.submitted, (unsigned long)stats.sent, (unsigned long)stats.rejected,
+    (unsigned long)bc95.rejects, (unsigned long)failed,
+    (unsigned long)stats.per_ecl[0], (unsigned long)stats.per_ecl[1], (unsigned long)stats.per_ecl[2],
+    energy / 1000.0,
+    mode != MODE_IMMEDIATE ? scheduler.energy_total / 1000.0 : 0.0,
+    (unsigned long)(stats.sent ? stats.delay / stats.sent / 1000 : 0),
+    (unsigned long)(stats.max_delay / 1000),
+    mode != MODE_IMMEDIATE ? scheduler.expired_count * 100.0 / (scheduler.sent_count ? scheduler.sent_count : 1) : 0.0);
+
+  // every accepted message goes on air or is reported as failed
+  if(mode != MODE_IMMEDIATE && stats.sent + scheduler.failed_count != stats.submitted - stats.rejected){
+    failures++;
+    printf("FAIL %s %s : %lu messages lost\n", name, modes[mode],
+      (unsigned long)(stats.submitted - stats.rejected - stats.sent - scheduler.failed_count));
+  }
+  if(mode == MODE_REJECTED && (bc95.rejects == 0 || scheduler.failed_count * 2 > bc95.rejects)){
+    failures++;
+    printf("FAIL %s rejected : refused messages aren't sent again\n", name);
+  }
+  return energy;
+}
+
+static void on_report(const NBIoT_UplinkReport *report, void *context)
+{
+  *(NBIoT_UplinkReport *)context = *report;
+}
+
+// module refuses every datagram, message is reported failed, not lost
+static void check_refused()
+{
+  static BC95Emulator bc95;
+  SixfabNBIoT node(Serial1, Wire);
+  SixfabLinkMonitor monitor;
+  SixfabUplinkScheduler scheduler(node, monitor);
+  NBIoT_UplinkReport report;
+  uint8_t data[8] = {PRIORITY_NORMAL};
+  uint8_t polls = 0;
+
+  bc95 = BC95Emulator();
+  Serial1.hostAttach(&bc95);
+  node.setBaudHandler(begin_ports);
+  node.init();
+  node.setIPAddress(ip);
+  node.setPort(port);
+  node.connectToOperator();
+  node.startUDPService();
+
+  memset(&report, 0, sizeof(report));
+  bc95.setSendReject(1);
+  scheduler.setSentCallback(on_report, &report);
+  uint8_t id = scheduler.submit(data, sizeof(data), PRIORITY_NORMAL, 60000);
+  while(scheduler.pending() && polls++ < 100){
+    scheduler.poll();
+    delay(SIM_STEP);
+  }
+
+  bool ok = !scheduler.pending() && scheduler.sent_count == 0 && scheduler.failed_count == 1 &&
+            report.id == id && report.failed && bc95.rejects >= UPLINK_SEND_ATTEMPTS;
+  if(!ok)
+    failures++;
+  printf("# refused : %s, %lu sends refused\n", ok ? "reported failed" : "FAIL", (unsigned long)bc95.rejects);
+}
+
+// deadline of a held message runs on SixfabTime, sleep included
+static void check_sleep()
+{
+  static BC95Emulator bc95;
+  SixfabNBIoT node(Serial1, Wire);
+  SixfabLinkMonitor monitor;
+  SixfabTime clock(node);
+  SixfabUplinkScheduler scheduler(node, monitor, &clock);
+  uint8_t data[8] = {PRIORITY_NORMAL};
+
+  bc95 = BC95Emulator();
+  Serial1.hostAttach(&bc95);
+  bc95.setLink(-1300, -50, 2); // held until deadline
+  node.setBaudHandler(begin_ports);
+  node.init();
+  node.setIPAddress(ip);
+  node.setPort(port);
+  node.connectToOperator();
+  node.startUDPService();
+
+  scheduler.submit(data, sizeof(data), PRIORITY_NORMAL, 600000);
+  scheduler.poll();
+  bool held = scheduler.pending() == 1;
+  clock.addSleep(900000); // 15 min power down, millis() stands still
+  scheduler.poll();
+
+  bool ok = held && !scheduler.pending() && scheduler.sent_count == 1 && scheduler.expired_count == 1;
+  if(!ok)
+    failures++;
+  printf("# sleep : %s\n", ok ? "deadline expired over sleep" : "FAIL");
+}
+
+static void compare(const char *name, const LinkSample *trace, uint16_t len)
+{
+  uint64_t immediate = run(name, trace, len, MODE_IMMEDIATE);
+  uint64_t scheduled = run(name, trace, len, MODE_SCHEDULED);
+  run(name, trace, len, MODE_REJECTED);
+
+  printf("# %s : scheduler saves %.1f %% of radio energy\n", name, 100.0 - scheduled * 100.0 / (immediate ? immediate : 1));
+}
+
+int main(int argc, char **argv)
+{
+  static LinkSample loaded[SIM_TRACE_LEN];
+
+  sixfabLog.setLevel(LOG_LEVEL_NONE);
+  printf("trace,mode,submitted,sent,rejected,refused,failed,ecl0,ecl1,ecl2,energy_mj,estimate_mj,avg_delay_s,max_delay_s,expired_pct\n");
+
+  if(argc > 1){
+    for(int i = 1; i < argc; i++){
+      uint16_t len = load_csv(argv[i], loaded, SIM_TRACE_LEN);
+      if(!len){
+        printf("# %s : no samples\n", argv[i]);
+        continue;
+      }
+      compare(argv[i], loaded, len);
+    }
+  }
+  else{
+    static const struct { const char *name; const LinkSample *trace; uint16_t len; } traces[] = {
+      {"window", trace_window, sizeof(trace_window) / sizeof(trace_window[0])},
+      {"basement", trace_basement, sizeof(trace_basement) / sizeof(trace_basement[0])},
+      {"parking", trace_parking, sizeof(trace_parking) / sizeof(trace_parking[0])},
+    };
+    for(uint8_t i = 0; i < sizeof(traces) / sizeof(traces[0]); i++){
+      compare(traces[i].name, traces[i].trace, traces[i].len);
+    }
+  }
+  check_refused();
+  check_sleep();
+  printf("%lu failures\n", (unsigned long)failures);
+  fflush(stdout);
+  return failures ? 1 : 0;
+}
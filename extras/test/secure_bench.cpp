@@ -0,0 +1,127 @@
+/*
+  secure_bench.cpp - checks and times SixfabSecure on host.
+  -
+  ChaCha20-Poly1305 core of Sixfab_Secure.cpp is checked against the AEAD
+  test vector of RFC 8439 2.8.2, then seal() and open() are timed for
+  datagram sizes of the library. Built twice, with SECURE_UNROLL 0 (round
+  loop, smaller code) and 1 (unrolled rounds), so the speed side of the
+  size / speed setting can be compared; extras/size_report.sh gives the
+  flash side on a board.
+
+  Timing is in TSC cycles on x86, nanoseconds elsewhere. Host figures
+  compare the two settings, they aren't cycles of an AVR.
+
+  Build and run : make -C extras/test secure_bench_0 secure_bench_1 && extras/test/secure_bench_0 && extras/test/secure_bench_1
+*/
+
+#include "Arduino.h"
+#include "../../Sixfab_Secure.cpp"
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define BENCH_UNIT "cycles"
+  static uint64_t ticks() { return __rdtsc(); }
+#else
+  #define BENCH_UNIT "ns"
+  static uint64_t ticks()
+  {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+  }
+#endif
+
+#define BENCH_ROUNDS 20000
+
+static void unhex(const char *s, uint8_t *out)
+{
+  while(*s){
+    unsigned v;
+    sscanf(s, "%2x", &v);
+    *out++ = v;
+    s += 2;
+  }
+}
+
+// RFC 8439 2.8.2, built from chacha_block() and poly_block() of the library
+static bool check_rfc8439()
+{
+  static const char plain[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+  uint8_t key[32], nonce[12], aad[12], expect_ct[16], expect_tag[16];
+  uint8_t cipher[sizeof(plain)], block[64], tag[16];
+  uint32_t input[16];
+  Poly1305 poly;
+  uint16_t len = sizeof(plain) - 1;
+
+  unhex("808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f", key);
+  unhex("070000004041424344454647", nonce);
+  unhex("50515253c0c1c2c3c4c5c6c7", aad);
+  unhex("d31a8d34648e60db7b86afbc53ef7ec2", expect_ct);
+  unhex("1ae10b594f09e26a7e902ecbd0600691", expect_tag);
+
+  chacha_init(input, key, 0, 0);
+  for(uint8_t i = 0; i < 3; i++)
+    input[13 + i] = load_le32(nonce + 4 * i);
+
+  chacha_block(input, block);
+  poly_init(&poly, block);
+  poly_block(&poly, aad, sizeof(aad)); // aad padded to 16
+  for(uint16_t offset = 0; offset < len; offset += 64){
+    uint16_t n = (len - offset < 64) ? len - offset : 64;
+    input[12]++;
+    chacha_block(input, block);
+    for(uint16_t i = 0; i < n; i++)
+      cipher[offset + i] = plain[offset + i] ^ block[i];
+    for(uint16_t i = 0; i < n; i += 16)
+      poly_block(&poly, cipher + offset + i, (n - i < 16) ? n - i : 16);
+  }
+  memset(block, 0, 16);
+  block[0] = sizeof(aad);
+  block[8] = len;
+  poly_block(&poly, block, 16);
+  poly_finish(&poly, tag);
+
+  return memcmp(cipher, expect_ct, 16) == 0 && memcmp(tag, expect_tag, 16) == 0;
+}
+
+int main()
+{
+  static const uint16_t sizes[] = {16, 64, UDP_DATA_LEN - SECURE_OVERHEAD};
+  uint8_t key[SECURE_KEY_LEN];
+  uint8_t payload[UDP_DATA_LEN], datagram[UDP_DATA_LEN], opened[UDP_DATA_LEN];
+  SixfabSecure secure;
+  bool ok = check_rfc8439();
+
+  printf("# SECURE_UNROLL=%d rfc8439=%s unit=%s\n", SECURE_UNROLL, ok ? "pass" : "FAIL", BENCH_UNIT);
+  printf("size,seal_per_byte,open_per_byte\n");
+
+  for(uint8_t i = 0; i < SECURE_KEY_LEN; i++)
+    key[i] = i * 7 + 1;
+  for(uint8_t i = 0; i < sizeof(payload); i++)
+    payload[i] = i;
+  if(!secure.rotateKey(key) || !secure.begin()){
+    printf("# key couldn't be stored\n");
+    return 1;
+  }
+
+  for(uint8_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+    uint16_t len = sizes[s];
+    uint64_t seal_ticks = 0, open_ticks = 0;
+
+    for(uint32_t r = 0; r < BENCH_ROUNDS; r++){
+      uint64_t t0 = ticks();
+      uint16_t sealed = secure.seal(payload, len, datagram);
+      uint64_t t1 = ticks();
+      // uplink nonce is opened as a downlink of the other side, so only the tag path is timed
+      int16_t n = secure.open(datagram, sealed, opened);
+      uint64_t t2 = ticks();
+      seal_ticks += t1 - t0;
+      open_ticks += t2 - t1;
+      if(sealed != len + SECURE_OVERHEAD)
+        ok = false;
+      (void)n;
+    }
+    printf("%u,%.1f,%.1f\n", len, (double)seal_ticks / BENCH_ROUNDS / len, (double)open_ticks / BENCH_ROUNDS / len);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+/*
+  tcp_emulator.cpp - checks TCP client of SixfabNBIoT against the BC95 emulator.
+  -
+  Covers connect / segment / acknowledge cycle of a STREAM socket :
+
+    connect  : AT+NSOCR=STREAM and AT+NSOCO, a refused socket fails cleanly
+    stream   : sendDataTCP() from a data source, TCP_CHUNK_LEN bytes per
+               AT+NSOSD, at most TCP_WINDOW segments waiting for +NSOSTR
+    echo     : server echoes every segment, data is read back with
+               receiveDataTCP() in pieces smaller than a segment
+    ack loss : a segment reported as failed by +NSOSTR fails send and
+               flush, a new connection works again
+    close    : no sends after closeTCP()
+
+  Server side is the uplink handler of the emulator, it keeps every byte
+  it gets and the virtual time of each segment, so the window can be
+  checked from segment times : a segment can't leave before acknowledge
+  of the segment TCP_WINDOW places before it.
+
+  Build and run : make -C extras/test tcp_emulator && extras/test/tcp_emulator
+*/
+
+#include "Arduino.h"
+#include "bc95_emulator.h"
+#include "Sixfab_NBIoT.h"
+
+#define TCP_TEST_LEN 1000
+#define TCP_TEST_SEGMENTS 64
+#define TCP_TEST_RTT (BC95_NETWORK_RTT * 8) // ms, emulator repeats 8 times at ECL 1
+
+BC95Emulator bc95;
+SixfabNBIoT node(Serial1, Wire);
+
+static char ip[] = "10.0.0.1";
+static char port[] = "5000";
+static uint32_t failures = 0;
+
+// what the server got
+static struct {
+  uint8_t data[2 * TCP_TEST_LEN];
+  uint16_t len;
+  uint32_t segment_time[TCP_TEST_SEGMENTS]; // ms
+  uint16_t segments;
+  uint8_t socket;
+  bool echo;
+} server;
+
+// data source state, payload is generated, never buffered as a whole
+typedef struct {
+  uint16_t offset;
+  uint16_t len;
+  uint16_t calls;
+  uint16_t max_request;
+} Generator;
+
+static void check(bool ok, const char *what)
+{
+  if(!ok)
+    failures++;
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+}
+
+static uint8_t pattern(uint16_t i)
+{
+  return (uint8_t)(i * 7 + (i >> 8));
+}
+
+static uint16_t generate(uint8_t *buffer, uint16_t max, void *context)
+{
+  Generator *source = (Generator *)context;
+  uint16_t len = source->len - source->offset;
+
+  if(len > max)
+    len = max;
+  for(uint16_t i = 0; i < len; i++)
+    buffer[i] = pattern(source->offset + i);
+  source->offset += len;
+  source->calls++;
+  if(max > source->max_request)
+    source->max_request = max;
+  return len;
+}
+
+static void on_segment(BC95Emulator &modem, uint8_t socket, const uint8_t *data, uint16_t len, void *context)
+{
+  (void)context;
+  server.socket = socket;
+  if(server.len + len <= sizeof(server.data)){
+    memcpy(server.data + server.len, data, len);
+    server.len += len;
+  }
+  if(server.segments < TCP_TEST_SEGMENTS)
+    server.segment_time[server.segments] = millis();
+  server.segments++;
+  if(server.echo)
+    modem.queueDownlink(socket, data, len, BC95_NETWORK_RTT);
+}
+
+static void begin_ports(uint32_t baud)
+{
+  Serial1.begin(baud);
+}
+
+static void reset_server(bool echo)
+{
+  memset(&server, 0, sizeof(server));
+  server.echo = echo;
+}
+
+static bool received_pattern(uint16_t len)
+{
+  if(server.len != len)
+    return false;
+  for(uint16_t i = 0; i < len; i++){
+    if(server.data[i] != pattern(i))
+      return false;
+  }
+  return true;
+}
+
+static void test_connect()
+{
+  static const uint8_t refused[] = "\r\nERROR\r\n";
+
+  bc95.setReply("AT+NSOCR=STREAM", refused, sizeof(refused) - 1);
+  check(!node.connectTCP(), "connect fails when module refuses STREAM socket");
+  check(node.sendDataTCP((const uint8_t *)"x", 1) == false, "send fails without connection");
+
+  check(node.connectTCP(), "connect");
+}
+
+static void test_stream()
+{
+  Generator source = {0, TCP_TEST_LEN, 0, 0};
+  uint16_t expected = (TCP_TEST_LEN + TCP_CHUNK_LEN - 1) / TCP_CHUNK_LEN;
+  bool window = true;
+  bool pipelined;
+
+  // acknowledges take longer than a window of AT+NSOSD commands at ECL 1
+  reset_server(false);
+  bc95.setLink(-1150, 20, 1);
+  uint32_t start = millis();
+  bool sent = node.sendDataTCP(generate, &source);
+  check(sent && node.flushTCP(), "stream and flush");
+  bc95.setLink(-900, 150, 0);
+  check(received_pattern(TCP_TEST_LEN), "server got every byte in order");
+  check(server.segments == expected && source.max_request == TCP_CHUNK_LEN, "one AT+NSOSD per TCP_CHUNK_LEN bytes");
+
+  // segment i waits acknowledge of segment i - TCP_WINDOW, which takes a round trip
+  for(uint16_t i = TCP_WINDOW; i < server.segments && i < TCP_TEST_SEGMENTS; i++){
+    if(server.segment_time[i] - server.segment_time[i - TCP_WINDOW] < TCP_TEST_RTT)
+      window = false;
+  }
+  pipelined = server.segment_time[TCP_WINDOW - 1] - server.segment_time[0] < TCP_TEST_RTT;
+  check(window, "no more than TCP_WINDOW segments unacknowledged");
+  check(pipelined, "first TCP_WINDOW segments don't wait acknowledges");
+  printf("     %u bytes in %u segments, %lu ms\n", TCP_TEST_LEN, server.segments, (unsigned long)(millis() - start));
+}
+
+static void test_echo()
+{
+  static uint8_t payload[TCP_TEST_LEN], echoed[TCP_TEST_LEN];
+  uint8_t piece[TCP_CHUNK_LEN / 2 + 3]; // reads don't line up with segments
+  uint16_t len = 0;
+  uint16_t reads = 0;
+
+  for(uint16_t i = 0; i < TCP_TEST_LEN; i++)
+    payload[i] = pattern(i);
+  reset_server(true);
+  check(node.sendDataTCP(payload, TCP_TEST_LEN) && node.flushTCP(), "send buffer");
+
+  while(len < TCP_TEST_LEN && node.waitData(server.socket, 5000)){
+    int16_t n = node.receiveDataTCP(piece, sizeof(piece));
+    if(n <= 0)
+      break;
+    if(len + n > TCP_TEST_LEN)
+      n = TCP_TEST_LEN - len;
+    memcpy(echoed + len, piece, n);
+    len += n;
+    reads++;
+  }
+  check(len == TCP_TEST_LEN && memcmp(echoed, payload, TCP_TEST_LEN) == 0, "echo read back with receiveDataTCP");
+  check(node.pendingData(server.socket) == 0, "nothing left in module");
+  printf("     %u bytes in %u reads\n", len, reads);
+}
+
+static void test_ack_loss()
+{
+  Generator source = {0, 8 * TCP_CHUNK_LEN, 0, 0};
+
+  reset_server(false);
+  bc95.setAckLoss(5);
+  bool sent = node.sendDataTCP(generate, &source);
+  bool flushed = sent && node.flushTCP();
+  check(!flushed, "failed +NSOSTR fails send or flush");
+  check(source.offset < source.len || !flushed, "sending stops after failure");
+
+  bc95.setAckLoss(0);
+  node.closeTCP();
+  check(node.connectTCP(), "reconnect after failure");
+  source.offset = 0;
+  reset_server(false);
+  check(node.sendDataTCP(generate, &source) && node.flushTCP(), "send on new connection");
+  check(received_pattern(source.len), "new connection delivers every byte");
+}
+
+static void test_close()
+{
+  uint32_t segments = server.segments;
+
+  node.closeTCP();
+  check(!node.sendDataTCP((const uint8_t *)"late", 4), "no send after close");
+  check(server.segments == segments, "nothing reaches server after close");
+  check(node.receiveDataTCP((uint8_t *)server.data, 4) < 0, "no receive after close");
+}
+
+int main(int argc, char **argv)
+{
+  bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+
+  Serial1.hostAttach(&bc95);
+  bc95.setUplinkHandler(on_segment, NULL);
+  if(!verbose)
+    sixfabLog.setLevel(LOG_LEVEL_NONE);
+
+  node.setBaudHandler(begin_ports);
+  node.init();
+  node.setIPAddress(ip);
+  node.setPort(port);
+  node.connectToOperator();
+
+  test_connect();
+  test_stream();
+  test_echo();
+  test_ack_loss();
+  test_close();
+
+  printf("%lu failures\n", (unsigned long)failures);
+  sixfabLog.flush();
+  fflush(stdout);
+  return failures ? 1 : 0;
+}